@@ -0,0 +1,1300 @@
+/******************************************************************************
+ *
+ * File:    JBench.c
+ * Short:   Benchmarks the Parson JSON parser and the JGet pipeline
+ * Author:  Philippe CARPENTIER, aka flype.
+ * Date:    March 2025
+ *
+ * JBench generates deterministic synthetic JSON corpora, runs every parson
+ * operation on them and writes the measures as a JSON report, so that two
+ * runs (two builds, two machines) can be compared by a script.
+ *
+ * Usage: JBench [SIZE=<bytes>] [ITERATIONS=<n>] [SEED=<n>]
+ *               [CORPUS=<name>] [OUTPUT=<file>] [SAVE=<dir>]
+ *               [STREAM=<bytes>]
+ *
+ * The report is only written with OUTPUT, the measures are printed either way.
+ *
+ * STREAM also round-trips a generated document of that many bytes through
+ * the streaming reader and writer, e.g. STREAM=5e9 for more than 4 GB on a
+ * 64-bit host. The document is never held in memory.
+ *
+ * Build:  smake bench (SAS/C), or on a POSIX host :
+ *         cc -O2 -o JBench JBench.c JTimer.c parson.c -lm
+ *
+ ******************************************************************************/
+
+#if !defined(__SASC) && !defined(AMIGA) && !defined(__amigaos__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L /* getrusage() */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "parson.h"
+#include "JTimer.h"
+
+#ifndef JTIMER_AMIGA
+#include <sys/resource.h>
+#endif
+
+/******************************************************************************
+ *
+ * DEFINES
+ *
+ ******************************************************************************/
+
+#define APP_VERSTRING "$VER: JBench 1.0 (16.3.2025) Philippe CARPENTIER"
+
+#define DEFAULT_SIZE       (256L * 1024L)
+#define DEFAULT_ITERATIONS 5
+#define DEFAULT_SEED       1234567
+
+#define DEEP_DEPTH   512
+#define NEST_DEPTH   2000 /* parson refuses more than 2048 levels */
+#define MAX_LOOKUPS  4096
+#define MAX_PATHLEN  (DEEP_DEPTH * 2 + 64)
+
+#ifdef JTIMER_AMIGA
+#define TMP_FILE "T:JBench.tmp"
+#else
+#define TMP_FILE "JBench.tmp"
+#endif
+
+/******************************************************************************
+ *
+ * TYPES
+ *
+ ******************************************************************************/
+
+typedef struct {
+	char * data;
+	size_t length;
+	size_t capacity;
+} JBench_Buffer;
+
+typedef struct {
+	const char * name;
+	void (*generate)(JBench_Buffer * buf, size_t size);
+	const char * query; /* JGet path used by the end-to-end test */
+} JBench_Corpus;
+
+typedef struct {
+	unsigned long count;     /* allocations */
+	unsigned long bytes;     /* bytes allocated */
+	unsigned long live;      /* bytes currently allocated */
+	unsigned long peak;      /* peak of live bytes */
+} JBench_Allocs;
+
+typedef struct {
+	size_t        target;    /* bytes to generate, the last record may exceed it */
+	size_t        produced;
+	size_t        position;  /* in the pending text */
+	size_t        length;
+	unsigned long records;
+	unsigned long hash;
+	char          text[128]; /* the record being read */
+} JBench_Generator;
+
+typedef union {
+	size_t size;
+	double align_d;
+	void * align_p;
+} JBench_Header;
+
+/******************************************************************************
+ *
+ * GLOBALS
+ *
+ ******************************************************************************/
+
+#ifdef __SASC
+long __stack = 262144; /* parson does not recurse, the JGet walk and node count do */
+#endif
+
+static const char * verstring = APP_VERSTRING;
+
+static unsigned long  seed = DEFAULT_SEED;
+static JBench_Allocs  allocs;
+static char         * lookups[MAX_LOOKUPS];
+static size_t         lookupCount = 0;
+static size_t         sinkBytes = 0;
+static size_t         sourcePosition = 0;
+static unsigned long  sinkHash = 0;
+static char           tokens[DEEP_DEPTH + 2][64];
+static char           tmpPath[(DEEP_DEPTH + 1) * 64]; /* "." and a token per level */
+
+/******************************************************************************
+ *
+ * Counting allocator
+ *
+ ******************************************************************************/
+
+static void * JBench_Malloc(size_t size)
+{
+	JBench_Header * header = (JBench_Header *)malloc(sizeof(JBench_Header) + size);
+
+	if (header == NULL)
+		return NULL;
+
+	header->size = size;
+	allocs.count++;
+	allocs.bytes += size;
+	allocs.live  += size;
+
+	if (allocs.live > allocs.peak)
+		allocs.peak = allocs.live;
+
+	return header + 1;
+}
+
+static void JBench_Free(void * ptr)
+{
+	JBench_Header * header;
+
+	if (ptr == NULL)
+		return;
+
+	header = (JBench_Header *)ptr - 1;
+	allocs.live -= header->size;
+	free(header);
+}
+
+static void JBench_ResetAllocs(void)
+{
+	allocs.count = 0;
+	allocs.bytes = 0;
+	allocs.peak  = allocs.live;
+}
+
+static long JBench_PeakRSS(void)
+{
+#ifndef JTIMER_AMIGA
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return (long)usage.ru_maxrss; /* KB on Linux */
+#endif
+	return -1;
+}
+
+/******************************************************************************
+ *
+ * Corpus generators
+ *
+ ******************************************************************************/
+
+static unsigned long JBench_Random(void)
+{
+	/* xorshift32, deterministic for a given SEED */
+	seed ^= (seed << 13) & 0xFFFFFFFFUL;
+	seed ^= (seed >> 17);
+	seed ^= (seed << 5) & 0xFFFFFFFFUL;
+	return seed & 0xFFFFFFFFUL;
+}
+
+static void JBench_Append(JBench_Buffer * buf, const char * string, size_t length)
+{
+	if (buf->length + length + 1 > buf->capacity)
+	{
+		size_t capacity = buf->capacity ? buf->capacity : 4096;
+		char * data;
+
+		while (buf->length + length + 1 > capacity)
+			capacity *= 2;
+
+		if ((data = (char *)realloc(buf->data, capacity)) == NULL)
+		{
+			fprintf(stderr, "JBench: out of memory\n");
+			exit(20);
+		}
+
+		buf->data = data;
+		buf->capacity = capacity;
+	}
+
+	memcpy(buf->data + buf->length, string, length);
+	buf->length += length;
+	buf->data[buf->length] = '\0';
+}
+
+static void JBench_Puts(JBench_Buffer * buf, const char * string)
+{
+	JBench_Append(buf, string, strlen(string));
+}
+
+static void JBench_Word(JBench_Buffer * buf)
+{
+	static const char * words[] = {
+		"amiga", "paula", "denise", "agnus", "copper", "blitter", "chip",
+		"fast", "kickstart", "workbench", "intuition", "exec", "dos", "ram",
+		"vampire", "apollo", "gold", "core", "sana", "device"
+	};
+
+	JBench_Puts(buf, words[JBench_Random() % (sizeof(words) / sizeof(words[0]))]);
+}
+
+static void JBench_AddLookup(const char * path)
+{
+	size_t length;
+
+	if (lookupCount >= MAX_LOOKUPS)
+		return;
+
+	length = strlen(path);
+
+	if ((lookups[lookupCount] = (char *)malloc(length + 1)) != NULL)
+	{
+		memcpy(lookups[lookupCount], path, length + 1);
+		lookupCount++;
+	}
+}
+
+/* {"d0":{"n":{"n":...{"v":0}}},"d1":...} */
+static void JBench_GenerateDeep(JBench_Buffer * buf, size_t size)
+{
+	char key[32], path[MAX_PATHLEN];
+	unsigned long i, d, depth;
+
+	JBench_Puts(buf, "{");
+
+	for (i = 0; buf->length < size; i++)
+	{
+		depth = DEEP_DEPTH / 2 + JBench_Random() % (DEEP_DEPTH / 2);
+
+		sprintf(key, "%s\"d%lu\":", i ? "," : "", i);
+		JBench_Puts(buf, key);
+		sprintf(path, "d%lu", i);
+
+		for (d = 0; d < depth; d++)
+		{
+			JBench_Puts(buf, "{\"n\":");
+			strcat(path, ".n");
+		}
+
+		sprintf(key, "{\"v\":%lu}", i);
+		JBench_Puts(buf, key);
+		strcat(path, ".v");
+		JBench_AddLookup(path);
+
+		for (d = 0; d < depth; d++)
+			JBench_Puts(buf, "}");
+	}
+
+	JBench_Puts(buf, "}");
+}
+
+/* {"v":[1,2,...],"n":[{"n":[...[0]...]}]}, a single chain as its
+   pretty form grows with the square of the depth */
+static void JBench_GenerateNested(JBench_Buffer * buf, size_t size)
+{
+	char number[32];
+	unsigned long i, d;
+
+	JBench_Puts(buf, "{\"v\":[");
+
+	for (i = 0; buf->length + NEST_DEPTH * 4 < size || i == 0; i++)
+	{
+		sprintf(number, "%s%lu", i ? "," : "", JBench_Random() % 100000);
+		JBench_Puts(buf, number);
+	}
+
+	JBench_Puts(buf, "],\"n\":");
+
+	for (d = 1; d < NEST_DEPTH; d++)
+		JBench_Puts(buf, (d & 1) ? "[" : "{\"n\":");
+
+	JBench_Puts(buf, "0");
+
+	for (d = NEST_DEPTH - 1; d > 0; d--)
+		JBench_Puts(buf, (d & 1) ? "]" : "}");
+
+	JBench_Puts(buf, "}");
+	JBench_AddLookup("v");
+	JBench_AddLookup("n");
+}
+
+/* {"k000000":1,"k000001":"text",...} */
+static void JBench_GenerateWide(JBench_Buffer * buf, size_t size)
+{
+	char key[64];
+	unsigned long i;
+
+	JBench_Puts(buf, "{");
+
+	for (i = 0; buf->length < size; i++)
+	{
+		sprintf(key, "%s\"k%06lu\":", i ? "," : "", i);
+		JBench_Puts(buf, key);
+
+		if (i & 1)
+		{
+			JBench_Puts(buf, "\"");
+			JBench_Word(buf);
+			JBench_Puts(buf, "\"");
+		}
+		else
+		{
+			sprintf(key, "%lu", JBench_Random() % 100000);
+			JBench_Puts(buf, key);
+		}
+
+		if ((i % 97) == 0)
+		{
+			sprintf(key, "k%06lu", i);
+			JBench_AddLookup(key);
+		}
+	}
+
+	JBench_Puts(buf, "}");
+}
+
+/* {"strings":["amiga paula ...", ...]} */
+static void JBench_GenerateStrings(JBench_Buffer * buf, size_t size)
+{
+	unsigned long i, w, words;
+
+	JBench_Puts(buf, "{\"strings\":[");
+
+	for (i = 0; buf->length < size; i++)
+	{
+		JBench_Puts(buf, i ? ",\"" : "\"");
+		words = 100 + JBench_Random() % 400;
+
+		for (w = 0; w < words; w++)
+		{
+			if (w) JBench_Puts(buf, " ");
+			JBench_Word(buf);
+		}
+
+		JBench_Puts(buf, "\"");
+	}
+
+	JBench_Puts(buf, "]}");
+	JBench_AddLookup("strings");
+}
+
+/* {"escapes":["a\"b\\c\/d\né...", ...]} */
+static void JBench_GenerateEscapes(JBench_Buffer * buf, size_t size)
+{
+	static const char * escapes[] = {
+		"\\\"", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t",
+		"\\u0001", "\\u001f", "\\u00e9", "\\u20ac", "\\ud83d\\ude00", "http://", "</tag>",
+		"\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80" /* raw UTF-8 */
+	};
+	unsigned long i, w, words;
+
+	JBench_Puts(buf, "{\"escapes\":[");
+
+	for (i = 0; buf->length < size; i++)
+	{
+		JBench_Puts(buf, i ? ",\"" : "\"");
+		words = 20 + JBench_Random() % 80;
+
+		for (w = 0; w < words; w++)
+		{
+			JBench_Puts(buf, escapes[JBench_Random() % (sizeof(escapes) / sizeof(escapes[0]))]);
+			JBench_Word(buf);
+		}
+
+		JBench_Puts(buf, "\"");
+	}
+
+	JBench_Puts(buf, "]}");
+	JBench_AddLookup("escapes");
+}
+
+/* {"numbers":[1, -2.5, 3.25e10, ...]} */
+static void JBench_GenerateNumbers(JBench_Buffer * buf, size_t size)
+{
+	char number[64];
+	unsigned long i, r;
+
+	JBench_Puts(buf, "{\"numbers\":[");
+
+	for (i = 0; buf->length < size; i++)
+	{
+		r = JBench_Random();
+
+		switch (r % 4)
+		{
+		case 0: sprintf(number, "%lu", r % 1000); break;
+		case 1: sprintf(number, "-%lu.%02lu", r % 100000, r % 100); break;
+		case 2: sprintf(number, "%lu.%03lue%lu", r % 10, r % 1000, r % 30); break;
+		default: sprintf(number, "%.6f", (double)(r % 1000000) / 7.0); break;
+		}
+
+		JBench_Puts(buf, i ? "," : "");
+		JBench_Puts(buf, number);
+	}
+
+	JBench_Puts(buf, "]}");
+	JBench_AddLookup("numbers");
+}
+
+/* {"items":[{"id":0,"name":"...","tags":[...],"geo":{...}}, ...]} */
+static void JBench_GenerateRecords(JBench_Buffer * buf, size_t size)
+{
+	char text[128];
+	unsigned long i, t, tags;
+
+	JBench_Puts(buf, "{\"meta\":{\"generator\":\"JBench\",\"version\":1},\"items\":[");
+
+	for (i = 0; buf->length < size; i++)
+	{
+		sprintf(text, "%s{\"id\":%lu,\"name\":\"", i ? "," : "", i);
+		JBench_Puts(buf, text);
+		JBench_Word(buf);
+		JBench_Puts(buf, " ");
+		JBench_Word(buf);
+		sprintf(text, "\",\"score\":%lu.%lu,\"active\":%s,\"tags\":[",
+			JBench_Random() % 1000, JBench_Random() % 10,
+			(JBench_Random() & 1) ? "true" : "false");
+		JBench_Puts(buf, text);
+
+		for (t = 0, tags = JBench_Random() % 5; t < tags; t++)
+		{
+			JBench_Puts(buf, t ? ",\"" : "\"");
+			JBench_Word(buf);
+			JBench_Puts(buf, "\"");
+		}
+
+		sprintf(text, "],\"geo\":{\"lat\":%lu.%04lu,\"lon\":%lu.%04lu},\"parent\":null}",
+			JBench_Random() % 90, JBench_Random() % 10000,
+			JBench_Random() % 180, JBench_Random() % 10000);
+		JBench_Puts(buf, text);
+	}
+
+	JBench_Puts(buf, "]}");
+	JBench_AddLookup("meta.generator");
+	JBench_AddLookup("meta.version");
+	JBench_AddLookup("items");
+}
+
+static JBench_Corpus corpora[] = {
+	{ "deep",    JBench_GenerateDeep,    ".d0" },
+	{ "nested",  JBench_GenerateNested,  ".n" },
+	{ "wide",    JBench_GenerateWide,    ".k000097" },
+	{ "strings", JBench_GenerateStrings, ".strings[1]" },
+	{ "escapes", JBench_GenerateEscapes, ".escapes[1]" },
+	{ "numbers", JBench_GenerateNumbers, ".numbers[1]" },
+	{ "records", JBench_GenerateRecords, ".items[1].geo" },
+	{ NULL, NULL, NULL }
+};
+
+/******************************************************************************
+ *
+ * JGet pipeline (same path building than JGet.c)
+ *
+ ******************************************************************************/
+
+static void JBench_SinkValue(const JSON_Value * value)
+{
+	char * pretty = json_serialize_to_string_pretty(value);
+
+	if (pretty)
+	{
+		sinkBytes += strlen(pretty);
+		json_free_serialized_string(pretty);
+	}
+}
+
+static int JBench_Match(const char * query, const char * name, unsigned long depth, long index)
+{
+	unsigned long i;
+
+	if (depth > DEEP_DEPTH)
+		return 0;
+
+	if (index == -1)
+		sprintf(tokens[depth], "%.60s", name ? name : "");
+	else
+		sprintf(tokens[depth], "%.40s[%ld]", name ? name : "", index);
+
+	tmpPath[0] = '\0';
+
+	for (i = 0; i < depth; i++)
+	{
+		strcat(tmpPath, ".");
+		strcat(tmpPath, tokens[i + 1]);
+	}
+
+	return strcmp(query, tmpPath) == 0;
+}
+
+static void JBench_Walk(const char * query, const JSON_Value * value, const char * name, unsigned long depth, long index)
+{
+	JSON_Object * object;
+	JSON_Array * array;
+	size_t i, count;
+
+	if (JBench_Match(query, name, depth, index))
+		JBench_SinkValue(value);
+
+	switch (json_type(value))
+	{
+	case JSONArray:
+		array = json_array(value);
+		count = json_array_get_count(array);
+		for (i = 0; i < count; i++)
+			JBench_Walk(query, json_array_get_value(array, i), name, depth, (long)i);
+		break;
+	case JSONObject:
+		object = json_object(value);
+		count = json_object_get_count(object);
+		for (i = 0; i < count; i++)
+			JBench_Walk(query, json_object_get_value_at(object, i),
+				json_object_get_name(object, i), depth + 1, -1);
+		break;
+	}
+}
+
+/******************************************************************************
+ *
+ * Measures
+ *
+ ******************************************************************************/
+
+/* Reference for the "utf8" measure: a one code point at a time validator,
+   equivalent to the one parson used before it checked ASCII a word at a time. */
+static int JBench_ScalarUTF8(const char * string, size_t length)
+{
+	const unsigned char * s = (const unsigned char *)string;
+	const unsigned char * end = s + length;
+	unsigned long cp;
+	int len, i;
+
+	while (s < end)
+	{
+		if (s[0] < 0x80) { s++; continue; }
+		else if (s[0] < 0xC2) return 0;
+		else if (s[0] < 0xE0) { len = 2; cp = s[0] & 0x1F; }
+		else if (s[0] < 0xF0) { len = 3; cp = s[0] & 0x0F; }
+		else if (s[0] < 0xF5) { len = 4; cp = s[0] & 0x07; }
+		else return 0;
+
+		if (end - s < len)
+			return 0;
+
+		for (i = 1; i < len; i++)
+		{
+			if ((s[i] & 0xC0) != 0x80)
+				return 0;
+			cp = (cp << 6) | (s[i] & 0x3F);
+		}
+
+		if ((len == 3 && cp < 0x800) || (len == 4 && cp < 0x10000) ||
+			cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+			return 0;
+
+		s += len;
+	}
+
+	return 1;
+}
+
+static size_t JBench_CountNodes(const JSON_Value * value)
+{
+	size_t i, count, nodes = 1;
+
+	switch (json_type(value))
+	{
+	case JSONArray:
+		count = json_array_get_count(json_array(value));
+		for (i = 0; i < count; i++)
+			nodes += JBench_CountNodes(json_array_get_value(json_array(value), i));
+		break;
+	case JSONObject:
+		count = json_object_get_count(json_object(value));
+		for (i = 0; i < count; i++)
+			nodes += JBench_CountNodes(json_object_get_value_at(json_object(value), i));
+		break;
+	}
+
+	return nodes;
+}
+
+/* Builds a copy of a tree member by member, with the builder functions
+   (reserved tables, no duplicate scan, adopted strings) or with the setters */
+static JSON_Value * JBench_Build(const JSON_Value * value, int builder)
+{
+	JSON_Value * copy = NULL, * member;
+	JSON_Object * object;
+	JSON_Array * array;
+	size_t i, count, length;
+	char * string;
+
+	switch (json_type(value))
+	{
+	case JSONArray:
+		array = json_array(value);
+		count = json_array_get_count(array);
+		copy = json_value_init_array();
+		if (builder)
+			json_array_reserve(json_array(copy), count);
+		for (i = 0; i < count; i++)
+		{
+			if (builder && json_type(json_array_get_value(array, i)) == JSONNumber)
+			{
+				json_array_append_number(json_array(copy), json_array_get_number(array, i));
+				continue;
+			}
+			member = JBench_Build(json_array_get_value(array, i), builder);
+			if (json_array_append_value(json_array(copy), member) != JSONSuccess)
+				json_value_free(member);
+		}
+		break;
+	case JSONObject:
+		object = json_object(value);
+		count = json_object_get_count(object);
+		copy = json_value_init_object();
+		if (builder)
+			json_object_reserve(json_object(copy), count);
+		for (i = 0; i < count; i++)
+		{
+			member = JBench_Build(json_object_get_value_at(object, i), builder);
+			if ((builder ? json_object_append_value(json_object(copy), json_object_get_name(object, i), member)
+				: json_object_set_value(json_object(copy), json_object_get_name(object, i), member)) != JSONSuccess)
+				json_value_free(member);
+		}
+		break;
+	case JSONString:
+		length = json_string_len(value);
+		if (!builder)
+			return json_value_init_string_with_len(json_string(value), length);
+		if ((string = json_alloc_string_ex(NULL, length)) != NULL)
+		{
+			memcpy(string, json_string(value), length);
+			if ((copy = json_value_init_string_no_copy_ex(NULL, string, length)) == NULL)
+				json_free_serialized_string(string);
+		}
+		break;
+	case JSONNumber:
+		return json_value_init_number(json_number(value));
+	case JSONBoolean:
+		return json_value_init_boolean(json_boolean(value));
+	case JSONNull:
+		return json_value_init_null();
+	}
+
+	return copy;
+}
+
+static void JBench_Touch(JSON_Value * value)
+{
+	switch (json_type(value))
+	{
+	case JSONArray:
+		json_array_append_number(json_array(value), 1.0);
+		break;
+	case JSONObject:
+		json_object_set_number(json_object(value), "jbench", 1.0);
+		break;
+	}
+}
+
+/* The members of the main array of a corpus (found by following the last
+   member of the objects) as concatenated documents, one per line */
+static void JBench_Documents(JBench_Buffer * buf, const JSON_Value * value)
+{
+	JSON_Array * array;
+	char * text;
+	size_t i, count = 1;
+
+	while (json_type(value) == JSONObject && json_object_get_count(json_object(value)) > 0)
+		value = json_object_get_value_at(json_object(value), json_object_get_count(json_object(value)) - 1);
+
+	if ((array = json_array(value)) != NULL)
+		count = json_array_get_count(array);
+
+	for (i = 0; i < count; i++)
+	{
+		if ((text = json_serialize_to_string(array ? json_array_get_value(array, i) : value)) != NULL)
+		{
+			JBench_Puts(buf, text);
+			JBench_Puts(buf, "\n");
+			json_free_serialized_string(text);
+		}
+	}
+}
+
+/* Writes a tree again through the streaming writer, as a generator without a
+   tree would, into a sink that only counts the bytes */
+static JSON_Status JBench_Sink(void * sinkData, const char * data, size_t length)
+{
+	(void)sinkData;
+	(void)data;
+	sinkBytes += length;
+	return JSONSuccess;
+}
+
+static void JBench_Stream(JSON_Writer * writer, const JSON_Value * value)
+{
+	JSON_Object * object;
+	JSON_Array * array;
+	size_t i, count;
+
+	switch (json_type(value))
+	{
+	case JSONArray:
+		array = json_array(value);
+		count = json_array_get_count(array);
+		json_writer_begin_array(writer);
+		for (i = 0; i < count; i++)
+			JBench_Stream(writer, json_array_get_value(array, i));
+		json_writer_end_array(writer);
+		break;
+	case JSONObject:
+		object = json_object(value);
+		count = json_object_get_count(object);
+		json_writer_begin_object(writer);
+		for (i = 0; i < count; i++)
+		{
+			json_writer_key(writer, json_object_get_name(object, i));
+			JBench_Stream(writer, json_object_get_value_at(object, i));
+		}
+		json_writer_end_object(writer);
+		break;
+	case JSONString:
+		json_writer_string_with_len(writer, json_string(value), json_string_len(value));
+		break;
+	case JSONNumber:
+		json_writer_number(writer, json_number(value));
+		break;
+	case JSONBoolean:
+		json_writer_boolean(writer, json_boolean(value));
+		break;
+	case JSONNull:
+		json_writer_null(writer);
+		break;
+	}
+}
+
+/* Source of the streaming reader, the corpus text as a file would give it */
+static size_t JBench_Source(void * sourceData, char * buffer, size_t size)
+{
+	const JBench_Buffer * buf = (const JBench_Buffer *)sourceData;
+
+	if (size > buf->length - sourcePosition)
+		size = buf->length - sourcePosition;
+
+	memcpy(buffer, buf->data + sourcePosition, size);
+	sourcePosition += size;
+	return size;
+}
+
+/* Last container of the last container..., where an edit changes the most levels */
+static JSON_Value * JBench_Innermost(JSON_Value * value)
+{
+	JSON_Value * last;
+	size_t count;
+
+	for (;;)
+	{
+		if (json_type(value) == JSONObject && (count = json_object_get_count(json_object(value))) > 0)
+			last = json_object_get_value_at(json_object(value), count - 1);
+		else if (json_type(value) == JSONArray && (count = json_array_get_count(json_array(value))) > 0)
+			last = json_array_get_value(json_array(value), count - 1);
+		else
+			return value;
+
+		if (json_type(last) != JSONObject && json_type(last) != JSONArray)
+			return value;
+
+		value = last;
+	}
+}
+
+static void JBench_Report(JSON_Array * results, const char * corpus, const char * operation,
+	double bytes, double nodes, double best, double total, int iterations)
+{
+	JSON_Value * value = json_value_init_object();
+	JSON_Object * result = json_object(value);
+	double mbps = best > 0.0 ? bytes / (1024.0 * 1024.0) / best : 0.0;
+	double nspn = nodes > 0.0 ? best * 1000000000.0 / nodes : 0.0;
+	unsigned long count = allocs.count, bytesAllocated = allocs.bytes, peak = allocs.peak;
+	long rss = JBench_PeakRSS();
+
+	printf("%-8s %-8s %10.2f MB/s %10.1f ns/node %10lu allocs %10lu peak\n",
+		corpus, operation, mbps, nspn, count, peak);
+
+	json_object_set_string(result, "corpus", corpus);
+	json_object_set_string(result, "operation", operation);
+	json_object_set_number(result, "bytes", bytes);
+	json_object_set_number(result, "nodes", nodes);
+	json_object_set_number(result, "iterations", iterations);
+	json_object_set_number(result, "best_seconds", best);
+	json_object_set_number(result, "mean_seconds", total / iterations);
+	json_object_set_number(result, "mb_per_s", mbps);
+	json_object_set_number(result, "ns_per_node", nspn);
+	json_object_set_number(result, "allocations", count);
+	json_object_set_number(result, "allocated_bytes", bytesAllocated);
+	json_object_set_number(result, "peak_heap_bytes", peak);
+	json_object_set_number(result, "peak_rss_kb", rss);
+	json_array_append_value(results, value);
+}
+
+/* Runs one operation ITERATIONS times. The allocation counters
+   reported are the ones of the last iteration. */
+#define JBENCH_RUN(code) do { \
+		int it; double t0; \
+		best = 1e30; total = 0.0; \
+		for (it = 0; it < iterations; it++) { \
+			JBench_ResetAllocs(); \
+			t0 = JTimer_Seconds(); \
+			code; \
+			t0 = JTimer_Seconds() - t0; \
+			total += t0; \
+			if (t0 < best) best = t0; \
+		} \
+	} while (0)
+
+static void JBench_RunCorpus(JSON_Array * results, const JBench_Corpus * corpus,
+	size_t size, int iterations, const char * saveDir)
+{
+	JBench_Buffer buf = { NULL, 0, 0 }, docs = { NULL, 0, 0 };
+	JSON_Value * root, * copy, * tmp = NULL, ** trees;
+	JSON_Writer * writer;
+	JSON_Documents * documents;
+	JSON_Reader * reader;
+	char * text = NULL, * pretty;
+	double best, total, nodes;
+	size_t i, textLength = 0, prettyLength = 0;
+	int equal = 0;
+	FILE * fp;
+
+	lookupCount = 0;
+	corpus->generate(&buf, size);
+
+	if (saveDir)
+	{
+		char name[512];
+		sprintf(name, "%.400s%s%s.json", saveDir,
+			(*saveDir && strchr(":/", saveDir[strlen(saveDir) - 1]) == NULL) ? "/" : "",
+			corpus->name);
+		if ((fp = fopen(name, "wb")) != NULL)
+		{
+			fwrite(buf.data, 1, buf.length, fp);
+			fclose(fp);
+		}
+	}
+
+	if ((root = json_parse_string(buf.data)) == NULL)
+	{
+		fprintf(stderr, "JBench: corpus '%s' does not parse\n", corpus->name);
+		free(buf.data);
+		return;
+	}
+
+	nodes = (double)JBench_CountNodes(root);
+
+	JBENCH_RUN(tmp = json_parse_string(buf.data); json_value_free(tmp));
+	JBench_Report(results, corpus->name, "parse", (double)buf.length, nodes, best, total, iterations);
+
+	// Parse with one JSON_Value per number, arrays of numbers not kept as doubles
+	json_context_set_number_arrays(NULL, 0);
+	JBENCH_RUN(tmp = json_parse_string(buf.data); json_value_free(tmp));
+	JBench_Report(results, corpus->name, "boxed", (double)buf.length, nodes, best, total, iterations);
+	json_context_set_number_arrays(NULL, 1);
+
+	// Parse after counting the members of each container, which are then allocated once
+	json_context_set_prescan(NULL, 1);
+	JBENCH_RUN(tmp = json_parse_string(buf.data); json_value_free(tmp));
+	JBench_Report(results, corpus->name, "prescan", (double)buf.length, nodes, best, total, iterations);
+	json_context_set_prescan(NULL, 0);
+
+	// The same data as concatenated documents, parsed one after the other
+	JBench_Documents(&docs, root);
+	JBENCH_RUN(documents = json_documents_new(NULL, docs.data);
+		while ((tmp = json_documents_next(documents)) != NULL) json_value_free(tmp);
+		json_documents_free(documents));
+	JBench_Report(results, corpus->name, "docs", (double)docs.length, nodes, best, total, iterations);
+	free(docs.data);
+
+	// The tokens of the corpus through the streaming reader, which builds no tree
+	JBENCH_RUN(sourcePosition = 0; reader = json_reader_new(NULL, JBench_Source, &buf);
+		while (json_reader_next(reader) > JSONTokenEnd) ; json_reader_free(reader));
+	JBench_Report(results, corpus->name, "reader", (double)buf.length, nodes, best, total, iterations);
+
+	// Free alone, on trees parsed beforehand (it is the JBENCH_RUN iteration)
+	if ((trees = (JSON_Value **)malloc(iterations * sizeof(JSON_Value *))) != NULL)
+	{
+		for (i = 0; i < (size_t)iterations; i++)
+			trees[i] = json_parse_string(buf.data);
+
+		JBENCH_RUN(json_value_free(trees[it]));
+		JBench_Report(results, corpus->name, "free", (double)buf.length, nodes, best, total, iterations);
+		free(trees);
+	}
+
+	JBENCH_RUN(equal = json_is_valid_utf8(buf.data, buf.length));
+	JBench_Report(results, corpus->name, "utf8", (double)buf.length, nodes, best, total, iterations);
+
+	JBENCH_RUN(equal = JBench_ScalarUTF8(buf.data, buf.length));
+	JBench_Report(results, corpus->name, "utf8ref", (double)buf.length, nodes, best, total, iterations);
+
+	if (!equal)
+		fprintf(stderr, "JBench: corpus '%s' is not valid UTF-8\n", corpus->name);
+
+	JBENCH_RUN(text = json_serialize_to_string(root); textLength = text ? strlen(text) : 0; json_free_serialized_string(text));
+	JBench_Report(results, corpus->name, "serialize", (double)textLength, nodes, best, total, iterations);
+
+	JBENCH_RUN(text = json_serialize_to_string_pretty(root); prettyLength = text ? strlen(text) : 0; json_free_serialized_string(text));
+	JBench_Report(results, corpus->name, "pretty", (double)prettyLength, nodes, best, total, iterations);
+
+	// The members of the top level shared out between 4 jobs, run in turn here
+	pretty = json_serialize_to_string_pretty(root);
+	JBENCH_RUN(text = json_serialize_to_string_parallel_ex(NULL, root, 1, 4, NULL, NULL);
+		equal = text && pretty && strcmp(text, pretty) == 0; json_free_serialized_string(text));
+	JBench_Report(results, corpus->name, "parallel", (double)prettyLength, nodes, best, total, iterations);
+	json_free_serialized_string(pretty);
+
+	if (!equal)
+		fprintf(stderr, "JBench: corpus '%s' is not serialized in parallel as in one piece\n", corpus->name);
+
+	// The same output through the streaming writer, which needs no tree
+	JBENCH_RUN(sinkBytes = 0; writer = json_writer_new(NULL, JBench_Sink, NULL, 0);
+		JBench_Stream(writer, root); json_writer_finish(writer); json_writer_free(writer));
+	JBench_Report(results, corpus->name, "writer", (double)sinkBytes, nodes, best, total, iterations);
+
+	if (sinkBytes != textLength)
+		fprintf(stderr, "JBench: corpus '%s' is not streamed as serialized\n", corpus->name);
+
+	// Serialize again after one edit, the unchanged containers are copied from their memos
+	json_context_set_serialization_cache(NULL, 1);
+	copy = json_parse_string(buf.data);
+	text = json_serialize_to_string(copy);
+	json_free_serialized_string(text);
+	JBENCH_RUN(JBench_Touch(JBench_Innermost(copy)); text = json_serialize_to_string(copy);
+		textLength = text ? strlen(text) : 0; json_free_serialized_string(text));
+	JBench_Report(results, corpus->name, "reserial", (double)textLength, nodes, best, total, iterations);
+
+	// Edited then unchanged, the root copied from its memo, as written without the cache
+	JBench_Touch(JBench_Innermost(copy));
+	text = json_serialize_to_string(copy);
+	json_free_serialized_string(text);
+	text = json_serialize_to_string(copy);
+	json_context_set_serialization_cache(NULL, 0);
+	pretty = json_serialize_to_string(copy);
+	equal = text && pretty && strcmp(text, pretty) == 0;
+	json_free_serialized_string(pretty);
+	json_free_serialized_string(text);
+	json_value_free(copy);
+
+	if (!equal)
+		fprintf(stderr, "JBench: corpus '%s' is not serialized from the cache as without it\n", corpus->name);
+
+	// Pass-through, numbers converted to double and back, then kept as text
+	JBENCH_RUN(tmp = json_parse_string(buf.data); text = json_serialize_to_string(tmp);
+		json_free_serialized_string(text); json_value_free(tmp));
+	JBench_Report(results, corpus->name, "passthru", (double)buf.length, nodes, best, total, iterations);
+
+	json_set_number_lexemes(1);
+	JBENCH_RUN(tmp = json_parse_string(buf.data); text = json_serialize_to_string(tmp);
+		json_free_serialized_string(text); json_value_free(tmp));
+	JBench_Report(results, corpus->name, "lexemes", (double)buf.length, nodes, best, total, iterations);
+	json_set_number_lexemes(0);
+
+	JBENCH_RUN(tmp = json_value_deep_copy(root); json_value_free(tmp));
+	JBench_Report(results, corpus->name, "deepcopy", (double)buf.length, nodes, best, total, iterations);
+
+	// Build the same tree through the API, with and without the builder functions
+	JBENCH_RUN(tmp = JBench_Build(root, 1); json_value_free(tmp));
+	JBench_Report(results, corpus->name, "build", (double)buf.length, nodes, best, total, iterations);
+
+	JBENCH_RUN(tmp = JBench_Build(root, 0); json_value_free(tmp));
+	JBench_Report(results, corpus->name, "buildset", (double)buf.length, nodes, best, total, iterations);
+
+	// Snapshot, walk the copy, which reads the original in place, then modify it, which
+	// only copies the top level
+	JBENCH_RUN(tmp = json_value_deep_copy(root); equal = JBench_CountNodes(tmp) == (size_t)nodes;
+		JBench_Touch(tmp); json_value_free(tmp));
+	JBench_Report(results, corpus->name, "snapshot", (double)buf.length, nodes, best, total, iterations);
+
+	if (!equal)
+		fprintf(stderr, "JBench: corpus '%s' is not walked the same after a snapshot\n", corpus->name);
+
+	// Compare with a separately parsed tree, a deep copy would share its nodes
+	copy = json_parse_string(buf.data);
+	JBENCH_RUN(equal = json_value_equals(root, copy));
+	JBench_Report(results, corpus->name, "equals", (double)buf.length, nodes, best, total, iterations);
+	json_value_free(copy);
+
+	if (!equal)
+		fprintf(stderr, "JBench: corpus '%s' is not equal to itself\n", corpus->name);
+
+	JBENCH_RUN(for (i = 0; i < lookupCount; i++) json_object_dotget_value(json_object(root), lookups[i]));
+	JBench_Report(results, corpus->name, "dotget", 0.0, (double)lookupCount, best, total, iterations);
+
+	if ((fp = fopen(TMP_FILE, "wb")) != NULL)
+	{
+		fwrite(buf.data, 1, buf.length, fp);
+		fclose(fp);
+
+		JBENCH_RUN(sinkBytes = 0; tmp = json_parse_file(TMP_FILE);
+			if (tmp) { JBench_Walk(corpus->query, tmp, NULL, 0, -1); json_value_free(tmp); });
+		JBench_Report(results, corpus->name, "jget", (double)buf.length, nodes, best, total, iterations);
+
+		remove(TMP_FILE);
+	}
+
+	json_value_free(root);
+
+	for (i = 0; i < lookupCount; i++)
+		free(lookups[i]);
+
+	free(buf.data);
+}
+
+/******************************************************************************
+ *
+ * Streaming round trip
+ *
+ * A document of any size is generated as the reader asks for it, read token
+ * by token and written again by the writer into a sink that hashes it. Both
+ * texts are compact, with the numbers written back as read, so they must be
+ * the same: same length, same FNV-1a hash, and the reader offset must reach
+ * the length, which takes size_t offsets past 4 GB.
+ *
+ ******************************************************************************/
+
+static unsigned long JBench_Hash(unsigned long hash, const char * data, size_t length)
+{
+	size_t i;
+
+	for (i = 0; i < length; i++)
+		hash = ((hash ^ (unsigned char)data[i]) * 16777619UL) & 0xFFFFFFFFUL;
+
+	return hash;
+}
+
+static size_t JBench_Generate(void * sourceData, char * buffer, size_t size)
+{
+	JBench_Generator * gen = (JBench_Generator *)sourceData;
+	size_t done = 0, chunk;
+
+	while (done < size)
+	{
+		if (gen->position == gen->length)
+		{
+			// The next record, or the end of the array once the target is reached
+			if (gen->records > 0 && gen->produced >= gen->target)
+			{
+				if (gen->text[0] == ']')
+					break;
+				strcpy(gen->text, "]");
+			}
+			else
+			{
+				sprintf(gen->text, "%s{\"id\":%lu,\"name\":\"record %lu\",\"tags\":[\"chip\",\"fast\"],\"ok\":%s,\"ratio\":%lu.%02lu,\"next\":null}",
+					gen->records == 0 ? "[" : ",", gen->records, JBench_Random() % 100000UL,
+					(gen->records & 1) ? "true" : "false", JBench_Random() % 1000UL, JBench_Random() % 100UL);
+				gen->records++;
+			}
+
+			gen->position = 0;
+			gen->length = strlen(gen->text);
+		}
+
+		chunk = gen->length - gen->position;
+		if (chunk > size - done)
+			chunk = size - done;
+
+		memcpy(buffer + done, gen->text + gen->position, chunk);
+		gen->hash = JBench_Hash(gen->hash, gen->text + gen->position, chunk);
+		gen->position += chunk;
+		gen->produced += chunk;
+		done += chunk;
+	}
+
+	return done;
+}
+
+static JSON_Status JBench_HashSink(void * sinkData, const char * data, size_t length)
+{
+	(void)sinkData;
+	sinkBytes += length;
+	sinkHash = JBench_Hash(sinkHash, data, length);
+	return JSONSuccess;
+}
+
+/* Returns the bytes read, 0 when the texts differ */
+static size_t JBench_RoundTrip(size_t size)
+{
+	JBench_Generator gen;
+	JSON_Reader * reader;
+	JSON_Writer * writer;
+	JSON_Token token;
+	JSON_Status status = JSONSuccess;
+	size_t offset;
+
+	memset(&gen, 0, sizeof(gen));
+	gen.target = size;
+	gen.hash = sinkHash = 2166136261UL;
+	sinkBytes = 0;
+
+	reader = json_reader_new(NULL, JBench_Generate, &gen);
+	writer = json_writer_new(NULL, JBench_HashSink, NULL, 0);
+
+	if (reader == NULL || writer == NULL)
+	{
+		json_reader_free(reader);
+		json_writer_free(writer);
+		return 0;
+	}
+
+	while (status == JSONSuccess && (token = json_reader_next(reader)) > JSONTokenEnd)
+	{
+		switch (token)
+		{
+		case JSONTokenBeginObject: status = json_writer_begin_object(writer); break;
+		case JSONTokenEndObject:   status = json_writer_end_object(writer); break;
+		case JSONTokenBeginArray:  status = json_writer_begin_array(writer); break;
+		case JSONTokenEndArray:    status = json_writer_end_array(writer); break;
+		case JSONTokenKey:         status = json_writer_key(writer, json_reader_string(reader)); break;
+		case JSONTokenString:
+			status = json_writer_string_with_len(writer, json_reader_string(reader), json_reader_string_len(reader));
+			break;
+		case JSONTokenNumber:
+			status = json_writer_number_text(writer, json_reader_string(reader), json_reader_string_len(reader));
+			break;
+		case JSONTokenBoolean:     status = json_writer_boolean(writer, json_reader_boolean(reader)); break;
+		case JSONTokenNull:        status = json_writer_null(writer); break;
+		default:                   status = JSONFailure; break;
+		}
+	}
+
+	if (status == JSONSuccess && token == JSONTokenEnd)
+		status = json_writer_finish(writer);
+	else
+		status = JSONFailure;
+
+	offset = json_reader_offset(reader);
+	json_reader_free(reader);
+	json_writer_free(writer);
+
+	if (status != JSONSuccess || offset != gen.produced || sinkBytes != gen.produced || sinkHash != gen.hash)
+	{
+		fprintf(stderr, "JBench: the stream of %.0f bytes is not written back as read\n", (double)gen.produced);
+		return 0;
+	}
+
+	return offset;
+}
+
+/******************************************************************************
+ *
+ * Entry point
+ *
+ ******************************************************************************/
+
+static const char * JBench_Option(const char * arg, const char * name)
+{
+	size_t length = strlen(name);
+	size_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		if (toupper((unsigned char)arg[i]) != name[i])
+			return NULL;
+	}
+
+	return arg[length] == '=' ? arg + length + 1 : NULL;
+}
+
+int main(int argc, char ** argv)
+{
+	size_t size = DEFAULT_SIZE;
+	int iterations = DEFAULT_ITERATIONS;
+	const char * output = NULL;
+	const char * only = NULL;
+	const char * saveDir = NULL;
+	const char * value;
+	double stream = 0.0, best, total;
+	size_t streamed = 0;
+	JSON_Value * report;
+	JSON_Array * results;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if ((value = JBench_Option(argv[i], "SIZE")) != NULL)
+			size = (size_t)strtoul(value, NULL, 0);
+		else if ((value = JBench_Option(argv[i], "ITERATIONS")) != NULL)
+			iterations = atoi(value);
+		else if ((value = JBench_Option(argv[i], "SEED")) != NULL)
+			seed = strtoul(value, NULL, 0);
+		else if ((value = JBench_Option(argv[i], "CORPUS")) != NULL)
+			only = value;
+		else if ((value = JBench_Option(argv[i], "OUTPUT")) != NULL)
+			output = value;
+		else if ((value = JBench_Option(argv[i], "SAVE")) != NULL)
+			saveDir = value;
+		else if ((value = JBench_Option(argv[i], "STREAM")) != NULL)
+			stream = strtod(value, NULL);
+		else
+		{
+			printf("Usage: JBench [SIZE=<bytes>] [ITERATIONS=<n>] [SEED=<n>]\n"
+				"              [CORPUS=<name>] [OUTPUT=<file>] [SAVE=<dir>]\n"
+				"              [STREAM=<bytes>]\n\n"
+				" Corpora: deep, nested, wide, strings, escapes, numbers, records.\n");
+			return 20;
+		}
+	}
+
+	if (iterations < 1 || size < 16 || seed == 0 || stream < 0.0 || stream >= (double)(size_t)~0UL)
+	{
+		fprintf(stderr, "JBench: invalid arguments\n");
+		return 20;
+	}
+
+	if (!JTimer_Open())
+	{
+		fprintf(stderr, "JBench: cannot open the timer\n");
+		return 20;
+	}
+
+	json_set_allocation_functions(JBench_Malloc, JBench_Free);
+
+	report = json_value_init_object();
+	json_object_set_string(json_object(report), "tool", "JBench");
+	json_object_set_number(json_object(report), "format", 1);
+	json_object_set_number(json_object(report), "seed", (double)seed);
+	json_object_set_number(json_object(report), "size", (double)size);
+	json_object_set_number(json_object(report), "iterations", iterations);
+#ifdef JTIMER_AMIGA
+	json_object_set_string(json_object(report), "platform", "amiga");
+#else
+	json_object_set_string(json_object(report), "platform", "posix");
+#endif
+	json_object_set_value(json_object(report), "results", json_value_init_array());
+	results = json_object_get_array(json_object(report), "results");
+
+	for (i = 0; corpora[i].name; i++)
+	{
+		if (only == NULL || strcmp(only, corpora[i].name) == 0)
+			JBench_RunCorpus(results, &corpora[i], size, iterations, saveDir);
+	}
+
+	if (stream > 0.0)
+	{
+		JBENCH_RUN(streamed = JBench_RoundTrip((size_t)stream));
+		JBench_Report(results, "stream", "roundtrip", (double)streamed, 0.0, best, total, iterations);
+	}
+
+	if (output != NULL && json_serialize_to_file_pretty(report, output) != JSONSuccess)
+		fprintf(stderr, "JBench: cannot write '%s'\n", output);
+
+	json_value_free(report);
+	JTimer_Close();
+
+	return 0;
+}
+
+/******************************************************************************
+ *
+ * End of file
+ *
+ ******************************************************************************/
@@ -0,0 +1,1252 @@
+/******************************************************************************
+ *
+ * File:    JDiff.c
+ * Short:   Prints the differences between two JSON files
+ * Author:  Philippe CARPENTIER, aka flype.
+ * Date:    March 2025
+ *
+ * Both documents are hashed in one bottom-up pass : every node gets a 64 bits
+ * content hash and the number of nodes of its subtree, stored in a table in
+ * document order. The two trees are then walked together and every pair of
+ * subtrees with the same hash is skipped without being visited, so that the
+ * cost of the comparison depends on the size of the differences.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dos/dos.h>
+#include <exec/exec.h>
+#include <proto/dos.h>
+#include <proto/exec.h>
+
+#include "JDiff.h"
+#include "JTimer.h"
+#include "parson.h"
+
+/******************************************************************************
+ *
+ * DEFINES
+ *
+ ******************************************************************************/
+
+#define TEMPLATE "H=HELP/S,F=FROM/A,T=TO/A,W=WITHCOMMENTS/S,Q=QUIET/S,TIMING/S"
+
+#define FNV_BASIS  2166136261UL
+#define FNV_PRIME  16777619UL
+#define GOLDEN     2654435769UL
+
+#define NO_SLOT    ((ULONG)~0UL)
+
+#define JDIFF_LCS_CELLS 65536 // Largest range of two arrays aligned exactly
+
+typedef enum {
+	OPT_HELP,
+	OPT_FROM,
+	OPT_TO,
+	OPT_WITH_COMMENTS,
+	OPT_QUIET,
+	OPT_TIMING,
+	OPT_COUNT
+} OPT_ARGS;
+
+typedef enum {
+	PHASE_READ,
+	PHASE_PARSE,
+	PHASE_HASH,
+	PHASE_DIFF,
+	PHASE_FREE,
+	PHASE_COUNT
+} PHASES;
+
+typedef struct {
+	ULONG a;
+	ULONG b;
+} JDIFF_HASH;
+
+typedef struct {
+	JDIFF_HASH hash;
+	ULONG      size;      // Nodes in the subtree, the node itself included
+} JDIFF_NODE;
+
+typedef struct {
+	JSON_Value * root;
+	JDIFF_NODE * nodes;   // In document order, the children of a node follow it
+	ULONG        count;
+	ULONG        capacity;
+} JDIFF_TREE;
+
+typedef struct {
+	JSON_Value * value;
+	ULONG        index;
+	ULONG        next;
+	ULONG        count;
+	JDIFF_HASH   hash;    // Running hash of an array, sum of the members of an object
+} JDIFF_FRAME;
+
+typedef struct {
+	JDIFF_HASH hash;
+	ULONG      count;
+	ULONG      index;     // Of the element in TO, for the hashes found once there
+} JDIFF_ENTRY;
+
+typedef struct {
+	JDIFF_ENTRY * entries;
+	ULONG         mask;
+} JDIFF_SET;
+
+typedef struct {
+	JSON_Array * x;
+	JSON_Array * y;
+	ULONG      * cx;      // Node numbers of the elements, see JDiff_Children
+	ULONG      * cy;
+	JDIFF_SET    sx;      // Hashes of the elements on each side
+	JDIFF_SET    sy;
+} JDIFF_ALIGN;
+
+typedef struct {
+	double seconds[PHASE_COUNT];
+	ULONG  bytesRead;
+	ULONG  nodesHashed;
+	ULONG  nodesVisited;
+	ULONG  subtreesPruned;
+	ULONG  changes;
+} JDIFF_TIMING;
+
+/******************************************************************************
+ *
+ * GLOBALS
+ *
+ ******************************************************************************/
+
+static BOOL   optQuiet = FALSE;
+static BOOL   optTiming = FALSE;
+static BOOL   outOfMemory = FALSE;
+static STRPTR verstring = APP_VERSTRING;
+
+static JDIFF_TREE from;
+static JDIFF_TREE to;
+
+static JDIFF_FRAME * frames = NULL;
+static ULONG         framesCapacity = 0;
+
+static STRPTR path = NULL;
+static ULONG  pathLength = 0;
+static ULONG  pathCapacity = 0;
+
+static JDIFF_TIMING timing;
+
+static CONST_STRPTR phaseNames[PHASE_COUNT] = {
+	"read", "parse", "hash", "diff", "free"
+};
+
+extern struct ExecBase * SysBase;
+extern struct DosLibrary * DOSBase;
+
+#ifdef __SASC
+long __stack = 65536; // The comparison recurses into the subtrees that differ
+#endif
+
+/******************************************************************************
+ *
+ * PROTOTYPES
+ *
+ ******************************************************************************/
+
+VOID JDiff_PrintHelp    (VOID);
+VOID JDiff_PrintTiming  (VOID);
+double JDiff_PhaseStart (VOID);
+VOID JDiff_PhaseEnd     (ULONG phase, double start);
+STRPTR JDiff_ReadFile   (CONST_STRPTR file);
+VOID JDiff_Mix          (JDIFF_HASH * hash, ULONG word);
+VOID JDiff_MixBytes     (JDIFF_HASH * hash, CONST_STRPTR bytes, ULONG length);
+ULONG JDiff_NameHash    (CONST_STRPTR name);
+VOID JDiff_HashScalar   (JSON_Value * value, JDIFF_HASH * hash);
+VOID JDiff_HashChild    (JDIFF_FRAME * parent, JDIFF_HASH * child);
+ULONG JDiff_AddNode     (JDIFF_TREE * tree);
+BOOL JDiff_HashTree     (JDIFF_TREE * tree);
+VOID JDiff_FreeTree     (JDIFF_TREE * tree);
+BOOL JDiff_SameHash     (JDIFF_NODE * a, JDIFF_NODE * b);
+BOOL JDiff_SetInit      (JDIFF_SET * set, ULONG count);
+JDIFF_ENTRY * JDiff_SetFind (JDIFF_SET * set, JDIFF_HASH * hash, BOOL add);
+BOOL JDiff_PathAppend   (CONST_STRPTR prefix, CONST_STRPTR name, ULONG index);
+VOID JDiff_PrintValue   (JSON_Value * value);
+VOID JDiff_PrintChange  (UBYTE mark, JSON_Value * before, JSON_Value * after);
+ULONG * JDiff_Children  (JDIFF_TREE * tree, ULONG index, ULONG count, ULONG extra);
+VOID JDiff_CompareObjects (ULONG i, JSON_Object * x, ULONG j, JSON_Object * y);
+VOID JDiff_CompareRange   (JDIFF_ALIGN * align, ULONG a, ULONG ex, ULONG b, ULONG ey);
+VOID JDiff_CompareArrays  (ULONG i, JSON_Array * x, ULONG j, JSON_Array * y);
+VOID JDiff_Compare      (ULONG i, JSON_Value * x, ULONG j, JSON_Value * y);
+ULONG JDiff_DiffFiles   (LONG * options);
+
+/******************************************************************************
+ *
+ * JDiff_PrintHelp()
+ *
+ ******************************************************************************/
+
+VOID JDiff_PrintHelp(VOID)
+{
+	printf(APP_HELPSTRING);
+}
+
+/******************************************************************************
+ *
+ * JDiff_PhaseStart(), JDiff_PhaseEnd()
+ *
+ ******************************************************************************/
+
+double JDiff_PhaseStart(VOID)
+{
+	return optTiming ? JTimer_Seconds() : 0.0;
+}
+
+VOID JDiff_PhaseEnd(ULONG phase, double start)
+{
+	if (optTiming)
+	{
+		timing.seconds[phase] += JTimer_Seconds() - start;
+	}
+}
+
+/******************************************************************************
+ *
+ * JDiff_PrintTiming()
+ *
+ ******************************************************************************/
+
+VOID JDiff_PrintTiming(VOID)
+{
+	double total = 0.0;
+	ULONG i;
+
+	printf("\nPhase          Seconds\n");
+
+	for (i = 0; i < PHASE_COUNT; i++)
+	{
+		printf("%-10s %11.6f\n", phaseNames[i], timing.seconds[i]);
+		total += timing.seconds[i];
+	}
+
+	printf("%-10s %11.6f\n\n", "total", total);
+	printf("Bytes read      : %lu\n", timing.bytesRead);
+	printf("Nodes hashed    : %lu\n", timing.nodesHashed);
+	printf("Nodes visited   : %lu\n", timing.nodesVisited);
+	printf("Subtrees pruned : %lu\n", timing.subtreesPruned);
+	printf("Changes         : %lu\n", timing.changes);
+}
+
+/******************************************************************************
+ *
+ * JDiff_ReadFile()
+ *
+ ******************************************************************************/
+
+STRPTR JDiff_ReadFile(CONST_STRPTR file)
+{
+	STRPTR buffer = NULL;
+	FILE * fp;
+	LONG size;
+
+	if (fp = fopen(file, "r"))
+	{
+		fseek(fp, 0L, SEEK_END);
+
+		if ((size = ftell(fp)) >= 0)
+		{
+			rewind(fp);
+
+			if (buffer = (STRPTR)malloc(size + 1))
+			{
+				size = fread(buffer, 1, size, fp);
+
+				if (size == 0 || ferror(fp))
+				{
+					free(buffer);
+					buffer = NULL;
+				}
+				else
+				{
+					buffer[size] = '\0';
+					timing.bytesRead += size;
+				}
+			}
+		}
+
+		fclose(fp);
+	}
+
+	return buffer;
+}
+
+/******************************************************************************
+ *
+ * JDiff_Mix(), JDiff_MixBytes(), JDiff_NameHash()
+ *
+ * The content hash is made of two independent 32 bits halves, FNV-1a and a
+ * multiplicative one, as SAS/C has no 64 bits integers.
+ *
+ ******************************************************************************/
+
+VOID JDiff_Mix(JDIFF_HASH * hash, ULONG word)
+{
+	hash->a = ((hash->a ^ word) * FNV_PRIME) & 0xFFFFFFFFUL;
+	hash->b = ((hash->b + word) * GOLDEN) & 0xFFFFFFFFUL;
+	hash->b ^= hash->b >> 15;
+}
+
+VOID JDiff_MixBytes(JDIFF_HASH * hash, CONST_STRPTR bytes, ULONG length)
+{
+	ULONG i;
+
+	JDiff_Mix(hash, length);
+
+	for (i = 0; i < length; i++)
+	{
+		JDiff_Mix(hash, (UBYTE)bytes[i]);
+	}
+}
+
+ULONG JDiff_NameHash(CONST_STRPTR name)
+{
+	ULONG hash = FNV_BASIS;
+
+	while (*name)
+	{
+		hash = ((hash ^ (UBYTE)*name++) * FNV_PRIME) & 0xFFFFFFFFUL;
+	}
+
+	return hash;
+}
+
+/******************************************************************************
+ *
+ * JDiff_HashScalar()
+ *
+ ******************************************************************************/
+
+VOID JDiff_HashScalar(JSON_Value * value, JDIFF_HASH * hash)
+{
+	double number;
+
+	hash->a = FNV_BASIS;
+	hash->b = GOLDEN;
+
+	JDiff_Mix(hash, (ULONG)json_type(value));
+
+	switch (json_type(value))
+	{
+	case JSONString:
+		JDiff_MixBytes(hash, json_value_get_string(value), json_value_get_string_len(value));
+		break;
+	case JSONNumber:
+		// Numbers are compared by value, 1.0 and 1 are the same number
+		number = json_value_get_number(value);
+		if (number == 0.0)
+			number = 0.0;
+		JDiff_MixBytes(hash, (CONST_STRPTR)&number, sizeof(number));
+		break;
+	case JSONBoolean:
+		JDiff_Mix(hash, (ULONG)json_value_get_boolean(value));
+		break;
+	}
+}
+
+/******************************************************************************
+ *
+ * JDiff_HashChild()
+ *
+ * Array elements are mixed in order. Object members are hashed with their
+ * name and summed, so that the order of the members does not matter.
+ *
+ ******************************************************************************/
+
+VOID JDiff_HashChild(JDIFF_FRAME * parent, JDIFF_HASH * child)
+{
+	JDIFF_HASH member;
+
+	if (json_type(parent->value) == JSONArray)
+	{
+		JDiff_Mix(&parent->hash, child->a);
+		JDiff_Mix(&parent->hash, child->b);
+	}
+	else
+	{
+		member.a = FNV_BASIS;
+		member.b = GOLDEN;
+
+		JDiff_Mix(&member, JDiff_NameHash(json_object_get_name(json_object(parent->value), parent->next - 1)));
+		JDiff_Mix(&member, child->a);
+		JDiff_Mix(&member, child->b);
+
+		parent->hash.a = (parent->hash.a + member.a) & 0xFFFFFFFFUL;
+		parent->hash.b = (parent->hash.b + member.b) & 0xFFFFFFFFUL;
+	}
+}
+
+/******************************************************************************
+ *
+ * JDiff_AddNode()
+ *
+ ******************************************************************************/
+
+ULONG JDiff_AddNode(JDIFF_TREE * tree)
+{
+	JDIFF_NODE * nodes;
+	ULONG capacity;
+
+	if (tree->count == tree->capacity)
+	{
+		capacity = tree->capacity ? tree->capacity * 2 : 1024;
+
+		if (!(nodes = (JDIFF_NODE *)realloc(tree->nodes, capacity * sizeof(JDIFF_NODE))))
+		{
+			outOfMemory = TRUE;
+			return NO_SLOT;
+		}
+
+		tree->nodes = nodes;
+		tree->capacity = capacity;
+	}
+
+	timing.nodesHashed++;
+
+	return tree->count++;
+}
+
+/******************************************************************************
+ *
+ * JDiff_HashTree()
+ *
+ * Walks the tree with an explicit stack. A container gets its number when it
+ * is entered and its hash when it is left, once all its children are hashed.
+ *
+ ******************************************************************************/
+
+BOOL JDiff_HashTree(JDIFF_TREE * tree)
+{
+	JDIFF_FRAME * frame;
+	JDIFF_HASH hash;
+	JSON_Value * value = tree->root;
+	ULONG depth = 0, index, capacity;
+
+	for (;;)
+	{
+		// Enter the next value
+
+		if (value)
+		{
+			if ((index = JDiff_AddNode(tree)) == NO_SLOT)
+				return FALSE;
+
+			if (json_type(value) == JSONObject || json_type(value) == JSONArray)
+			{
+				if (depth == framesCapacity)
+				{
+					capacity = framesCapacity ? framesCapacity * 2 : 64;
+
+					if (!(frame = (JDIFF_FRAME *)realloc(frames, capacity * sizeof(JDIFF_FRAME))))
+					{
+						outOfMemory = TRUE;
+						return FALSE;
+					}
+
+					frames = frame;
+					framesCapacity = capacity;
+				}
+
+				frame = &frames[depth++];
+				frame->value = value;
+				frame->index = index;
+				frame->next = 0;
+				frame->hash.a = FNV_BASIS;
+				frame->hash.b = GOLDEN;
+
+				if (json_type(value) == JSONObject)
+					frame->count = json_object_get_count(json_object(value));
+				else
+					frame->count = json_array_get_count(json_array(value));
+
+				value = NULL;
+			}
+			else
+			{
+				JDiff_HashScalar(value, &tree->nodes[index].hash);
+				tree->nodes[index].size = 1;
+
+				if (depth == 0)
+					return TRUE;
+
+				JDiff_HashChild(&frames[depth - 1], &tree->nodes[index].hash);
+				value = NULL;
+			}
+		}
+
+		// Descend into the next child, or leave the container
+
+		frame = &frames[depth - 1];
+
+		if (frame->next < frame->count)
+		{
+			if (json_type(frame->value) == JSONObject)
+				value = json_object_get_value_at(json_object(frame->value), frame->next);
+			else
+				value = json_array_get_value(json_array(frame->value), frame->next);
+
+			frame->next++;
+		}
+		else
+		{
+			hash.a = FNV_BASIS;
+			hash.b = GOLDEN;
+
+			JDiff_Mix(&hash, (ULONG)json_type(frame->value));
+			JDiff_Mix(&hash, frame->count);
+			JDiff_Mix(&hash, frame->hash.a);
+			JDiff_Mix(&hash, frame->hash.b);
+
+			tree->nodes[frame->index].hash = hash;
+			tree->nodes[frame->index].size = tree->count - frame->index;
+
+			if (--depth == 0)
+				return TRUE;
+
+			JDiff_HashChild(&frames[depth - 1], &hash);
+		}
+	}
+}
+
+/******************************************************************************
+ *
+ * JDiff_FreeTree()
+ *
+ ******************************************************************************/
+
+VOID JDiff_FreeTree(JDIFF_TREE * tree)
+{
+	if (tree->root)
+		json_value_free(tree->root);
+
+	if (tree->nodes)
+		free(tree->nodes);
+
+	memset(tree, 0, sizeof(JDIFF_TREE));
+}
+
+/******************************************************************************
+ *
+ * JDiff_SameHash()
+ *
+ ******************************************************************************/
+
+BOOL JDiff_SameHash(JDIFF_NODE * a, JDIFF_NODE * b)
+{
+	return (BOOL)(a->hash.a == b->hash.a && a->hash.b == b->hash.b);
+}
+
+/******************************************************************************
+ *
+ * JDiff_SetInit(), JDiff_SetFind()
+ *
+ * A multiset of subtree hashes, used to align the elements of two arrays.
+ *
+ ******************************************************************************/
+
+BOOL JDiff_SetInit(JDIFF_SET * set, ULONG count)
+{
+	ULONG size = 16;
+
+	while (size < count * 2)
+		size *= 2;
+
+	if (!(set->entries = (JDIFF_ENTRY *)calloc(size, sizeof(JDIFF_ENTRY))))
+	{
+		outOfMemory = TRUE;
+		return FALSE;
+	}
+
+	set->mask = size - 1;
+
+	return TRUE;
+}
+
+JDIFF_ENTRY * JDiff_SetFind(JDIFF_SET * set, JDIFF_HASH * hash, BOOL add)
+{
+	JDIFF_ENTRY * entry;
+	ULONG slot = hash->a & set->mask;
+
+	// Entries are never removed, their count only drops to zero
+
+	for (;; slot = (slot + 1) & set->mask)
+	{
+		entry = &set->entries[slot];
+
+		if (entry->hash.a == hash->a && entry->hash.b == hash->b)
+			return entry;
+
+		if (entry->count == 0 && entry->hash.a == 0 && entry->hash.b == 0)
+			break;
+	}
+
+	if (!add)
+		return NULL;
+
+	entry->hash = *hash;
+
+	return entry;
+}
+
+/******************************************************************************
+ *
+ * JDiff_PathAppend()
+ *
+ ******************************************************************************/
+
+BOOL JDiff_PathAppend(CONST_STRPTR prefix, CONST_STRPTR name, ULONG index)
+{
+	UBYTE number[16];
+	ULONG length, capacity;
+	STRPTR text;
+
+	if (name == NULL)
+	{
+		sprintf(number, "[%lu]", index);
+		name = number;
+	}
+
+	length = strlen(prefix) + strlen(name);
+
+	if (pathLength + length + 1 > pathCapacity)
+	{
+		capacity = (pathLength + length + 1) * 2;
+
+		if (!(text = (STRPTR)realloc(path, capacity)))
+		{
+			outOfMemory = TRUE;
+			return FALSE;
+		}
+
+		path = text;
+		pathCapacity = capacity;
+	}
+
+	strcpy(&path[pathLength], prefix);
+	strcat(&path[pathLength], name);
+	pathLength += length;
+
+	return TRUE;
+}
+
+/******************************************************************************
+ *
+ * JDiff_PrintValue(), JDiff_PrintChange()
+ *
+ ******************************************************************************/
+
+VOID JDiff_PrintValue(JSON_Value * value)
+{
+	STRPTR text;
+
+	if (text = json_serialize_to_string(value))
+	{
+		printf("%s", text);
+		json_free_serialized_string(text);
+	}
+	else
+	{
+		outOfMemory = TRUE;
+	}
+}
+
+VOID JDiff_PrintChange(UBYTE mark, JSON_Value * before, JSON_Value * after)
+{
+	timing.changes++;
+
+	if (optQuiet)
+		return;
+
+	printf("%c %s: ", mark, pathLength ? path : (STRPTR)".");
+
+	if (before)
+	{
+		JDiff_PrintValue(before);
+
+		if (after)
+			printf(" -> ");
+	}
+
+	if (after)
+		JDiff_PrintValue(after);
+
+	printf("\n");
+}
+
+/******************************************************************************
+ *
+ * JDiff_Children()
+ *
+ * Returns the node numbers of the children of a container, followed by
+ * 'extra' free ULONGs for the caller.
+ *
+ ******************************************************************************/
+
+ULONG * JDiff_Children(JDIFF_TREE * tree, ULONG index, ULONG count, ULONG extra)
+{
+	ULONG * children, i;
+
+	if (!(children = (ULONG *)malloc((count + extra + 1) * sizeof(ULONG))))
+	{
+		outOfMemory = TRUE;
+		return NULL;
+	}
+
+	for (i = 0, index++; i < count; i++)
+	{
+		children[i] = index;
+		index += tree->nodes[index].size;
+	}
+
+	return children;
+}
+
+/******************************************************************************
+ *
+ * JDiff_CompareObjects()
+ *
+ * Members are paired by name through a hash table of the new names, the
+ * members of the new object left unpaired are the added ones.
+ *
+ ******************************************************************************/
+
+VOID JDiff_CompareObjects(ULONG i, JSON_Object * x, ULONG j, JSON_Object * y)
+{
+	ULONG nx = json_object_get_count(x), ny = json_object_get_count(y);
+	ULONG * children, * slots, size = 16, mask, slot, m, k, length = pathLength;
+	CONST_STRPTR name;
+	UBYTE * paired;
+
+	while (size < ny * 2)
+		size *= 2;
+
+	mask = size - 1;
+
+	// The node numbers of the new members, the table, the paired flags
+
+	if (!(children = JDiff_Children(&to, j, ny, size + (ny + sizeof(ULONG)) / sizeof(ULONG))))
+		return;
+
+	slots = &children[ny];
+	paired = (UBYTE *)&slots[size];
+
+	memset(slots, 0xFF, size * sizeof(ULONG));
+	memset(paired, 0, ny);
+
+	for (m = 0; m < ny; m++)
+	{
+		slot = JDiff_NameHash(json_object_get_name(y, m)) & mask;
+
+		while (slots[slot] != NO_SLOT)
+			slot = (slot + 1) & mask;
+
+		slots[slot] = m;
+	}
+
+	for (m = 0, k = i + 1; m < nx && !outOfMemory; k += from.nodes[k].size, m++)
+	{
+		name = json_object_get_name(x, m);
+		slot = JDiff_NameHash(name) & mask;
+
+		while (slots[slot] != NO_SLOT && strcmp(json_object_get_name(y, slots[slot]), name) != 0)
+			slot = (slot + 1) & mask;
+
+		if (!JDiff_PathAppend(".", name, 0))
+			break;
+
+		if (slots[slot] == NO_SLOT)
+		{
+			JDiff_PrintChange('-', json_object_get_value_at(x, m), NULL);
+		}
+		else
+		{
+			paired[slots[slot]] = TRUE;
+			JDiff_Compare(k, json_object_get_value_at(x, m),
+				children[slots[slot]], json_object_get_value_at(y, slots[slot]));
+		}
+
+		pathLength = length;
+	}
+
+	for (m = 0; m < ny && !outOfMemory; m++)
+	{
+		if (!paired[m])
+		{
+			if (!JDiff_PathAppend(".", json_object_get_name(y, m), 0))
+				break;
+
+			JDiff_PrintChange('+', NULL, json_object_get_value_at(y, m));
+			pathLength = length;
+		}
+	}
+
+	pathLength = length;
+
+	free(children);
+}
+
+/******************************************************************************
+ *
+ * JDiff_CompareRange()
+ *
+ * Aligns the elements of FROM from a up to ex with those of TO from b up to
+ * ey. A small range is aligned on its longest common subsequence, so that no
+ * element is removed then added again, a larger one greedily: an element found
+ * nowhere ahead in the other array is removed (or added). Two elements left
+ * face to face are compared as a change.
+ *
+ ******************************************************************************/
+
+VOID JDiff_CompareRange(JDIFF_ALIGN * align, ULONG a, ULONG ex, ULONG b, ULONG ey)
+{
+	ULONG nx = ex - a, ny = ey - b, width = ny + 1, length = pathLength, p, q;
+	UWORD * lcs;
+	JDIFF_ENTRY * ea, * eb, * entry;
+	BOOL inFrom, inTo;
+
+	if (nx && ny && nx <= JDIFF_LCS_CELLS / ny)
+	{
+		// lcs[p * width + q], the longest common subsequence from a + p and b + q on
+
+		if (!(lcs = (UWORD *)malloc((nx + 1) * width * sizeof(UWORD))))
+		{
+			outOfMemory = TRUE;
+			return;
+		}
+
+		for (p = nx + 1; p-- > 0;)
+		{
+			for (q = width; q-- > 0;)
+			{
+				if (p == nx || q == ny)
+					lcs[p * width + q] = 0;
+				else if (JDiff_SameHash(&from.nodes[align->cx[a + p]], &to.nodes[align->cy[b + q]]))
+					lcs[p * width + q] = lcs[(p + 1) * width + q + 1] + 1;
+				else if (lcs[(p + 1) * width + q] > lcs[p * width + q + 1])
+					lcs[p * width + q] = lcs[(p + 1) * width + q];
+				else
+					lcs[p * width + q] = lcs[p * width + q + 1];
+			}
+		}
+
+		for (p = q = 0; (p < nx || q < ny) && !outOfMemory; pathLength = length)
+		{
+			if (p < nx && q < ny && JDiff_SameHash(&from.nodes[align->cx[a + p]], &to.nodes[align->cy[b + q]]))
+			{
+				timing.subtreesPruned++;
+				p++, q++;
+			}
+			else if (p < nx && q < ny && lcs[(p + 1) * width + q + 1] == lcs[p * width + q])
+			{
+				if (!JDiff_PathAppend("", NULL, b + q))
+					break;
+
+				JDiff_Compare(align->cx[a + p], json_array_get_value(align->x, a + p),
+					align->cy[b + q], json_array_get_value(align->y, b + q));
+				p++, q++;
+			}
+			else if (p < nx && (q == ny || lcs[(p + 1) * width + q] == lcs[p * width + q]))
+			{
+				if (!JDiff_PathAppend("", NULL, a + p))
+					break;
+
+				JDiff_PrintChange('-', json_array_get_value(align->x, a + p), NULL);
+				p++;
+			}
+			else
+			{
+				if (!JDiff_PathAppend("", NULL, b + q))
+					break;
+
+				JDiff_PrintChange('+', NULL, json_array_get_value(align->y, b + q));
+				q++;
+			}
+		}
+
+		pathLength = length;
+		free(lcs);
+		return;
+	}
+
+	// The counts of the range only, set back to zero at the end
+
+	if (nx && ny)
+	{
+		for (p = a; p < ex; p++)
+			JDiff_SetFind(&align->sx, &from.nodes[align->cx[p]].hash, TRUE)->count++;
+
+		for (q = b; q < ey; q++)
+			JDiff_SetFind(&align->sy, &to.nodes[align->cy[q]].hash, TRUE)->count++;
+	}
+
+	for (p = a, q = b; p < ex && q < ey && !outOfMemory; pathLength = length)
+	{
+		ea = JDiff_SetFind(&align->sx, &from.nodes[align->cx[p]].hash, FALSE);
+		eb = JDiff_SetFind(&align->sy, &to.nodes[align->cy[q]].hash, FALSE);
+
+		if (JDiff_SameHash(&from.nodes[align->cx[p]], &to.nodes[align->cy[q]]))
+		{
+			timing.subtreesPruned++;
+			ea->count--;
+			eb->count--;
+			p++, q++;
+			continue;
+		}
+
+		// Is each element still ahead in the other array ?
+
+		inTo = (BOOL)((entry = JDiff_SetFind(&align->sy, &ea->hash, FALSE)) && entry->count);
+		inFrom = (BOOL)((entry = JDiff_SetFind(&align->sx, &eb->hash, FALSE)) && entry->count);
+
+		if (inTo && !inFrom)
+		{
+			if (!JDiff_PathAppend("", NULL, q))
+				break;
+
+			JDiff_PrintChange('+', NULL, json_array_get_value(align->y, q));
+			eb->count--;
+			q++;
+		}
+		else if (inFrom || inTo)
+		{
+			if (!JDiff_PathAppend("", NULL, p))
+				break;
+
+			JDiff_PrintChange('-', json_array_get_value(align->x, p), NULL);
+			ea->count--;
+			p++;
+		}
+		else
+		{
+			if (!JDiff_PathAppend("", NULL, q))
+				break;
+
+			JDiff_Compare(align->cx[p], json_array_get_value(align->x, p), align->cy[q], json_array_get_value(align->y, q));
+			ea->count--;
+			eb->count--;
+			p++, q++;
+		}
+	}
+
+	for (; p < ex && !outOfMemory; p++, pathLength = length)
+	{
+		if (!JDiff_PathAppend("", NULL, p))
+			break;
+
+		JDiff_PrintChange('-', json_array_get_value(align->x, p), NULL);
+	}
+
+	for (; q < ey && !outOfMemory; q++, pathLength = length)
+	{
+		if (!JDiff_PathAppend("", NULL, q))
+			break;
+
+		JDiff_PrintChange('+', NULL, json_array_get_value(align->y, q));
+	}
+
+	pathLength = length;
+
+	if (nx && ny)
+	{
+		for (p = a; p < ex; p++)
+			JDiff_SetFind(&align->sx, &from.nodes[align->cx[p]].hash, FALSE)->count = 0;
+
+		for (q = b; q < ey; q++)
+			JDiff_SetFind(&align->sy, &to.nodes[align->cy[q]].hash, FALSE)->count = 0;
+	}
+}
+
+/******************************************************************************
+ *
+ * JDiff_CompareArrays()
+ *
+ * The common head and tail are skipped by hash. What is left in between is
+ * aligned by JDiff_CompareRange. When it is too large for an exact alignment,
+ * the elements found once in each array are matched first, and the longest run
+ * of them in the same order in both is kept as is (a patience diff), the
+ * ranges between them being aligned in turn. The paths of the removed elements hold their
+ * index in FROM, the other paths their index in TO.
+ *
+ ******************************************************************************/
+
+VOID JDiff_CompareArrays(ULONG i, JSON_Array * x, ULONG j, JSON_Array * y)
+{
+	ULONG nx = json_array_get_count(x), ny = json_array_get_count(y);
+	ULONG head = 0, ex = nx, ey = ny, a, b, k, low, high, runs = 0, count = 0;
+	ULONG * ax = NULL, * by = NULL, * prev = NULL, * tails = NULL;
+	JDIFF_ALIGN align;
+	JDIFF_ENTRY * ea, * eb;
+
+	align.x = x;
+	align.y = y;
+	align.cy = NULL;
+	align.sx.entries = align.sy.entries = NULL;
+
+	// Room for the matched elements after the node numbers of FROM
+
+	if (!(align.cx = JDiff_Children(&from, i, nx, nx * 4)) || !(align.cy = JDiff_Children(&to, j, ny, 0)))
+		goto cleanup;
+
+	while (head < ex && head < ey && JDiff_SameHash(&from.nodes[align.cx[head]], &to.nodes[align.cy[head]]))
+		head++;
+
+	while (ex > head && ey > head && JDiff_SameHash(&from.nodes[align.cx[ex - 1]], &to.nodes[align.cy[ey - 1]]))
+		ex--, ey--;
+
+	timing.subtreesPruned += head + (nx - ex);
+
+	// The hashes left on each side, when both sides have some and are too large
+	// to be aligned exactly at once
+
+	if (head < ex && head < ey && ex - head > JDIFF_LCS_CELLS / (ey - head))
+	{
+		if (!JDiff_SetInit(&align.sx, ex - head) || !JDiff_SetInit(&align.sy, ey - head))
+			goto cleanup;
+
+		for (a = head; a < ex; a++)
+			JDiff_SetFind(&align.sx, &from.nodes[align.cx[a]].hash, TRUE)->count++;
+
+		for (b = head; b < ey; b++)
+		{
+			eb = JDiff_SetFind(&align.sy, &to.nodes[align.cy[b]].hash, TRUE);
+			eb->index = b;
+			eb->count++;
+		}
+
+		// The elements found once on both sides, in the order of FROM, and the
+		// longest run of them in the order of TO: tails[k] ends the best run of
+		// k + 1 found so far, prev links each element to the one before it
+
+		ax = align.cx + nx;
+		by = ax + nx;
+		prev = by + nx;
+		tails = prev + nx;
+
+		for (a = head; a < ex; a++)
+		{
+			ea = JDiff_SetFind(&align.sx, &from.nodes[align.cx[a]].hash, FALSE);
+
+			if (ea->count != 1 || !(eb = JDiff_SetFind(&align.sy, &ea->hash, FALSE)) || eb->count != 1)
+				continue;
+
+			for (low = 0, high = runs; low < high;)
+			{
+				k = (low + high) / 2;
+
+				if (by[tails[k]] < eb->index)
+					low = k + 1;
+				else
+					high = k;
+			}
+
+			ax[count] = a;
+			by[count] = eb->index;
+			prev[count] = low ? tails[low - 1] : NO_SLOT;
+			tails[low] = count++;
+
+			if (low == runs)
+				runs++;
+		}
+
+		// The run, in order, in tails
+
+		for (k = runs, a = runs ? tails[runs - 1] : NO_SLOT; a != NO_SLOT; a = prev[a])
+			tails[--k] = a;
+
+		for (a = head; a < ex; a++)
+			JDiff_SetFind(&align.sx, &from.nodes[align.cx[a]].hash, FALSE)->count = 0;
+
+		for (b = head; b < ey; b++)
+			JDiff_SetFind(&align.sy, &to.nodes[align.cy[b]].hash, FALSE)->count = 0;
+	}
+
+	for (a = b = head, k = 0; k < runs && !outOfMemory; k++)
+	{
+		JDiff_CompareRange(&align, a, ax[tails[k]], b, by[tails[k]]);
+		timing.subtreesPruned++;
+		a = ax[tails[k]] + 1;
+		b = by[tails[k]] + 1;
+	}
+
+	if (!outOfMemory)
+		JDiff_CompareRange(&align, a, ex, b, ey);
+
+cleanup:
+
+	if (align.sx.entries) free(align.sx.entries);
+	if (align.sy.entries) free(align.sy.entries);
+	if (align.cx) free(align.cx);
+	if (align.cy) free(align.cy);
+}
+
+/******************************************************************************
+ *
+ * JDiff_Compare()
+ *
+ ******************************************************************************/
+
+VOID JDiff_Compare(ULONG i, JSON_Value * x, ULONG j, JSON_Value * y)
+{
+	timing.nodesVisited++;
+
+	if (JDiff_SameHash(&from.nodes[i], &to.nodes[j]))
+	{
+		timing.subtreesPruned++;
+		return;
+	}
+
+	if (json_type(x) == JSONObject && json_type(y) == JSONObject)
+	{
+		JDiff_CompareObjects(i, json_object(x), j, json_object(y));
+	}
+	else if (json_type(x) == JSONArray && json_type(y) == JSONArray)
+	{
+		JDiff_CompareArrays(i, json_array(x), j, json_array(y));
+	}
+	else
+	{
+		JDiff_PrintChange('~', x, y);
+	}
+}
+
+/******************************************************************************
+ *
+ * JDiff_DiffFiles()
+ *
+ ******************************************************************************/
+
+ULONG JDiff_DiffFiles(LONG * opts)
+{
+	ULONG result = RETURN_ERROR, i;
+	JDIFF_TREE * tree;
+	STRPTR buffer;
+	double t;
+
+	optQuiet = (BOOL)opts[OPT_QUIET];
+	optTiming = (BOOL)(opts[OPT_TIMING] && JTimer_Open());
+
+	memset(&timing, 0, sizeof(timing));
+
+	// Keep the text of the numbers, they are printed verbatim
+
+	json_set_number_lexemes(TRUE);
+
+	for (i = 0; i < 2; i++)
+	{
+		tree = i ? &to : &from;
+
+		t = JDiff_PhaseStart();
+		buffer = JDiff_ReadFile((STRPTR)opts[i ? OPT_TO : OPT_FROM]);
+		JDiff_PhaseEnd(PHASE_READ, t);
+
+		if (buffer)
+		{
+			t = JDiff_PhaseStart();
+
+			if (opts[OPT_WITH_COMMENTS])
+				json_strip_comments(buffer);
+
+			tree->root = json_parse_string(buffer);
+			JDiff_PhaseEnd(PHASE_PARSE, t);
+
+			free(buffer);
+		}
+	}
+
+	if (!from.root || !to.root)
+	{
+		printf("The %s file is not valid.\n", from.root ? "TO" : "FROM");
+	}
+	else
+	{
+		t = JDiff_PhaseStart();
+
+		if (JDiff_HashTree(&from) && JDiff_HashTree(&to))
+		{
+			JDiff_PhaseEnd(PHASE_HASH, t);
+
+			t = JDiff_PhaseStart();
+			JDiff_Compare(0, from.root, 0, to.root);
+			JDiff_PhaseEnd(PHASE_DIFF, t);
+		}
+
+		if (outOfMemory)
+			printf("Not enough memory.\n");
+		else
+			result = timing.changes ? RETURN_WARN : RETURN_OK;
+	}
+
+	t = JDiff_PhaseStart();
+
+	JDiff_FreeTree(&from);
+	JDiff_FreeTree(&to);
+
+	if (frames)
+		free(frames);
+
+	if (path)
+		free(path);
+
+	JDiff_PhaseEnd(PHASE_FREE, t);
+
+	if (optTiming)
+	{
+		JDiff_PrintTiming();
+		JTimer_Close();
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * Entry point
+ *
+ ******************************************************************************/
+
+ULONG main(ULONG argc, STRPTR * argv)
+{
+	ULONG result = RETURN_FAIL;
+	LONG opts[OPT_COUNT];
+	struct RDArgs * rdArgs;
+
+	memset(opts, 0, sizeof(opts));
+
+	if (rdArgs = (struct RDArgs *)ReadArgs(TEMPLATE, opts, NULL))
+	{
+		if (opts[OPT_HELP])
+		{
+			JDiff_PrintHelp();
+
+			result = RETURN_OK;
+		}
+		else
+		{
+			result = JDiff_DiffFiles(opts);
+		}
+
+		FreeArgs(rdArgs);
+	}
+	else
+	{
+		JDiff_PrintHelp();
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * End of file
+ *
+ ******************************************************************************/
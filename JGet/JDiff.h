@@ -0,0 +1,18 @@
+#ifndef __JDIFF_H__
+#define __JDIFF_H__
+
+#include <exec/types.h>
+#include <exec/execbase.h>
+
+#define APP_AUTHOR "Philippe CARPENTIER"
+#define APP_VERSTRING "$VER: JDiff 1.0 (16.3.2025) [SAS/C 6.59] " APP_AUTHOR
+#define APP_HELPSTRING ("Usage: JDiff <fromfile> <tofile> [<options>]\n\n"\
+	" HELP            This help.\n"\
+	" FROM            The original JSON file (mandatory).\n"\
+	" TO              The modified JSON file (mandatory).\n"\
+	" WITHCOMMENTS    For use with commented JSON files (optional).\n"\
+	" QUIET           Only set the return code, print nothing (optional).\n"\
+	" TIMING          Print the phase timings (optional).\n\n"\
+	"See JDiff.help for a more detailed documentation.\n")
+
+#endif /* __JDIFF_H__ */
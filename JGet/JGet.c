@@ -10,13 +10,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include <dos/dos.h>
+#include <dos/dosasl.h>
 #include <exec/exec.h>
 #include <proto/dos.h>
 #include <proto/exec.h>
 
 #include "JGet.h"
+#include "JInflate.h"
+#include "JTimer.h"
+#include "JPath.h"
 #include "parson.h"
 
 /******************************************************************************
@@ -27,8 +32,22 @@
 
 #define MAXDEPTH   64
 #define MAXNAMELEN 256
+#define MAXFILELEN 512
 
-#define TEMPLATE "H=HELP/S,F=FILE/A,P=PATH,L=LIST/S,E=ESCAPESLASHES/S,W=WITHCOMMENTS/S"
+#define POOL_PUDDLE    32768
+#define POOL_THRESHOLD 8192
+#define POOL_HEADER    8        // The size of the block, doubles aligned
+
+#define TEMPLATE "H=HELP/S,F=FILE/A,P=PATH,L=LIST/S,E=ESCAPESLASHES/S,W=WITHCOMMENTS/S,M=MULTI/S,S=STATS/S,T=TIMING/K,A=AGGREGATE/K,X=EXPORT/K,C=COLUMNS/K,ALL/S"
+
+#define FNV_BASIS  2166136261UL
+#define FNV_PRIME  16777619UL
+
+#define HLL_BITS      12                // 4096 registers, about 1.6% off
+#define HLL_REGISTERS (1 << HLL_BITS)
+#define MAX_AGGREGATES 16
+
+#define EXPORT_BUFFER_SIZE 32768
 
 typedef enum {
 	OPT_HELP,
@@ -37,9 +56,71 @@ typedef enum {
 	OPT_LIST,
 	OPT_ESCAPE_SLASHES,
 	OPT_WITH_COMMENTS,
+	OPT_MULTI,
+	OPT_STATS,
+	OPT_TIMING,
+	OPT_AGGREGATE,
+	OPT_EXPORT,
+	OPT_COLUMNS,
+	OPT_ALL,
 	OPT_COUNT
 } OPT_ARGS;
 
+typedef enum {
+	PHASE_READ,
+	PHASE_COMMENTS,
+	PHASE_PARSE,
+	PHASE_MATCH,
+	PHASE_OUTPUT,
+	PHASE_FREE,
+	PHASE_COUNT
+} PHASES;
+
+typedef struct {
+	double seconds[PHASE_COUNT];
+	ULONG  bytesRead;
+	ULONG  nodesCreated;
+	ULONG  nodesVisited;
+	ULONG  matches;
+	ULONG  bytesWritten;
+} JGET_TIMING;
+
+typedef enum {
+	AGG_COUNT,
+	AGG_SUM,
+	AGG_MIN,
+	AGG_MAX,
+	AGG_AVG,
+	AGG_DISTINCT,
+	AGG_OPERATORS
+} AGGREGATES;
+
+typedef struct {
+	ULONG  operators[MAX_AGGREGATES];  // In the order to print them
+	ULONG  operatorCount;
+	ULONG  count;                      // Of the values
+	ULONG  numbers;                    // Of the numbers among them
+	double sum;
+	double min;
+	double max;
+	UBYTE  minText[32];                // As written in the file
+	UBYTE  maxText[32];
+	UBYTE  registers[HLL_REGISTERS];   // HyperLogLog of the distinct values
+} JGET_AGGREGATE;
+
+typedef struct {
+	CONST_STRPTR   name;      // As given in COLUMNS
+	JPath          path;      // The PATH then the column
+	BOOL           parsed;
+	JPath_Walker * walker;
+	JSON_Writer  * writer;    // While an object or array is copied
+	size_t         depth;     // Of the reader once it is copied
+	STRPTR         text;      // The cell of the current row
+	ULONG          length;
+	ULONG          capacity;
+	BOOL           set;
+} JGET_COLUMN;
+
 /******************************************************************************
  * 
  * GLOBALS
@@ -47,11 +128,24 @@ typedef enum {
  ******************************************************************************/
 
 static BOOL   optList = FALSE;
+static BOOL   optTiming = FALSE;
 static STRPTR optPath = NULL;
+static STRPTR optTag = NULL;       // The file name printed before each value
 static STRPTR verstring = APP_VERSTRING;
 static UBYTE  tokens[MAXDEPTH][MAXNAMELEN];
 static UBYTE  tmpPath[MAXDEPTH * MAXNAMELEN];
 
+static JGET_TIMING timing;
+static JSON_Context * context = NULL;
+
+static CONST_STRPTR phaseNames[PHASE_COUNT] = {
+	"read", "comments", "parse", "match", "output", "free"
+};
+
+static CONST_STRPTR aggregateNames[AGG_OPERATORS] = {
+	"COUNT", "SUM", "MIN", "MAX", "AVG", "DISTINCT"
+};
+
 extern struct ExecBase * SysBase;
 extern struct DosLibrary * DOSBase;
 
@@ -63,11 +157,41 @@ extern struct DosLibrary * DOSBase;
 
 VOID JGet_PrintHelp   (VOID);
 VOID JGet_PrintValue  (JSON_Value * value);
-BOOL JGet_ParseFile   (LONG * options);
+VOID JGet_PrintStats  (VOID);
+VOID JGet_PrintTiming (CONST_STRPTR file, CONST_STRPTR format);
+double JGet_PhaseStart(VOID);
+VOID JGet_PhaseEnd    (ULONG phase, double start);
+STRPTR JGet_ReadFile  (CONST_STRPTR file);
+STRPTR JGet_InflateFile (CONST_STRPTR file);
+JSON_Reader * JGet_OpenReader (CONST_STRPTR file, JInflate ** inflater);
+BOOL JGet_CloseReader (JSON_Reader * reader, JInflate * inflater, CONST_STRPTR file);
+VOID * JGet_PoolAlloc (VOID * pool, size_t size);
+VOID JGet_PoolFree    (VOID * pool, VOID * memory);
+int JGet_CompareNames (const VOID * a, const VOID * b);
+STRPTR * JGet_MatchFiles (CONST_STRPTR pattern, BOOL all, ULONG * count);
+VOID JGet_FreeFiles   (STRPTR * files, ULONG count);
+BOOL JGet_IsPattern   (CONST_STRPTR pattern);
+BOOL JGet_IsFile      (CONST_STRPTR name);
+BOOL JGet_ParseFiles  (LONG * options);
+BOOL JGet_ParseFile   (LONG * options, CONST_STRPTR file);
+BOOL JGet_ParseDocuments (CONST_STRPTR buffer);
 VOID JGet_ParseArray  (JSON_Array * array, CONST_STRPTR name, ULONG depth);
 VOID JGet_ParseObject (JSON_Object * object, ULONG depth, ULONG index);
 VOID JGet_ParseValue  (JSON_Value * value, CONST_STRPTR name, ULONG depth, ULONG index);
 BOOL JGet_ParseMatch  (CONST_STRPTR name, ULONG depth, ULONG index);
+BOOL JGet_AggregateInit  (JGET_AGGREGATE * aggregate, CONST_STRPTR operators);
+ULONG JGet_AggregateHash (ULONG hash, CONST UBYTE * data, ULONG length);
+BOOL JGet_AggregateValue (JGET_AGGREGATE * aggregate, JPath_Walker * walker, JSON_Reader * reader, JSON_Token token);
+VOID JGet_AggregatePrint (JGET_AGGREGATE * aggregate);
+BOOL JGet_AggregateFile  (JGET_AGGREGATE * aggregate, JPath * path, CONST_STRPTR file);
+BOOL JGet_Aggregate   (LONG * options, STRPTR * files, ULONG fileCount);
+BOOL JGet_CellAppend  (JGET_COLUMN * column, CONST_STRPTR data, ULONG length);
+JSON_Status JGet_CellSink (VOID * sinkData, CONST_STRPTR data, size_t length);
+BOOL JGet_CopyToken   (JSON_Writer * writer, JSON_Reader * reader, JSON_Token token);
+BOOL JGet_ColumnToken (JGET_COLUMN * column, JSON_Reader * reader, JSON_Token token, BOOL match);
+VOID JGet_ExportCell  (BOOL tsv, CONST_STRPTR text, ULONG length);
+BOOL JGet_ExportFile  (JGET_COLUMN * columns, ULONG count, JPath * rowPath, BOOL tsv, CONST_STRPTR file, ULONG * rowCount);
+BOOL JGet_Export      (LONG * options, STRPTR * files, ULONG fileCount);
 
 /******************************************************************************
  * 
@@ -89,11 +213,17 @@ VOID JGet_PrintHelp(VOID)
 VOID JGet_PrintValue(JSON_Value * value)
 {
 	STRPTR pretty, start;
+	double t;
 	
 	if (optList)
 		return;
 	
-	if (start = pretty = json_serialize_to_string_pretty(value))
+	t = JGet_PhaseStart();
+	timing.matches++;
+	
+	// Through the parser context, which holds the ESCAPESLASHES setting
+	
+	if (start = pretty = json_serialize_to_string_ex(context, value, 1))
 	{
 		size_t length = strlen(start);
 		
@@ -103,10 +233,278 @@ VOID JGet_PrintValue(JSON_Value * value)
 			start += 1;
 		}
 		
+		if (optTag)
+			printf("%s: ", optTag);
+		
 		printf("%.*s\n", length, start);
+		timing.bytesWritten += length + 1;
+		
+		json_free_serialized_string_ex(context, pretty);
+	}
+	
+	JGet_PhaseEnd(PHASE_OUTPUT, t);
+}
+
+/******************************************************************************
+ * 
+ * JGet_PrintStats()
+ * 
+ ******************************************************************************/
+
+VOID JGet_PrintStats(VOID)
+{
+	JSON_Stats stats;
+	ULONG i, count = 0, bytes = 0, frees = 0;
+	
+	if (json_context_get_stats(context, &stats) != JSONSuccess)
+	{
+		printf("Statistics are not available (parson built without PARSON_STATS).\n");
+		return;
+	}
+	
+	printf("\nCategory        Allocs        Bytes        Frees\n");
+	
+	for (i = 0; i < JSON_ALLOC_CATEGORIES; i++)
+	{
+		printf("%-10s %11lu  %11lu  %11lu\n", json_stats_category_name(i),
+			(ULONG)stats.allocations[i], (ULONG)stats.bytes[i], (ULONG)stats.frees[i]);
+		
+		count += stats.allocations[i];
+		bytes += stats.bytes[i];
+		frees += stats.frees[i];
+	}
+	
+	printf("%-10s %11lu  %11lu  %11lu\n", "total", count, bytes, frees);
+	printf("\nLive bytes: %lu, peak live bytes: %lu\n",
+		(ULONG)stats.live_bytes, (ULONG)stats.peak_live_bytes);
+	
+	printf("\nSize histogram:\n");
+	
+	for (i = 0; i < JSON_STATS_BUCKETS; i++)
+	{
+		if (i < JSON_STATS_BUCKETS - 1)
+			printf(" <= %5lu bytes : %lu\n", 8UL << i, (ULONG)stats.histogram[i]);
+		else
+			printf("  > %5lu bytes : %lu\n", 8UL << (i - 1), (ULONG)stats.histogram[i]);
+	}
+}
+
+/******************************************************************************
+ * 
+ * JGet_PhaseStart(), JGet_PhaseEnd()
+ * 
+ ******************************************************************************/
+
+double JGet_PhaseStart(VOID)
+{
+	return optTiming ? JTimer_Seconds() : 0.0;
+}
+
+VOID JGet_PhaseEnd(ULONG phase, double start)
+{
+	if (optTiming)
+	{
+		timing.seconds[phase] += JTimer_Seconds() - start;
+	}
+}
+
+/******************************************************************************
+ * 
+ * JGet_PrintTiming()
+ * 
+ ******************************************************************************/
+
+VOID JGet_PrintTiming(CONST_STRPTR file, CONST_STRPTR format)
+{
+	double total = 0.0;
+	ULONG i;
+	
+	// The output phase runs inside the match phase
+	
+	timing.seconds[PHASE_MATCH] -= timing.seconds[PHASE_OUTPUT];
+	
+	for (i = 0; i < PHASE_COUNT; i++)
+	{
+		total += timing.seconds[i];
+	}
+	
+	if (stricmp(format, "JSON") == 0)
+	{
+		printf("{\"file\":\"%s\",\"phases\":{", file);
+		
+		for (i = 0; i < PHASE_COUNT; i++)
+		{
+			printf("%s\"%s\":%.6f", i ? "," : "", phaseNames[i], timing.seconds[i]);
+		}
+		
+		printf("},\"total\":%.6f,\"bytes_read\":%lu,\"nodes_created\":%lu,"
+			"\"nodes_visited\":%lu,\"matches\":%lu,\"bytes_written\":%lu}\n",
+			total, timing.bytesRead, timing.nodesCreated,
+			timing.nodesVisited, timing.matches, timing.bytesWritten);
+	}
+	else
+	{
+		printf("\nPhase          Seconds\n");
+		
+		for (i = 0; i < PHASE_COUNT; i++)
+		{
+			printf("%-10s %11.6f\n", phaseNames[i], timing.seconds[i]);
+		}
+		
+		printf("%-10s %11.6f\n\n", "total", total);
+		printf("Bytes read    : %lu\n", timing.bytesRead);
+		printf("Nodes created : %lu\n", timing.nodesCreated);
+		printf("Nodes visited : %lu\n", timing.nodesVisited);
+		printf("Matches       : %lu\n", timing.matches);
+		printf("Bytes written : %lu\n", timing.bytesWritten);
+	}
+}
+
+/******************************************************************************
+ * 
+ * JGet_ReadFile()
+ * 
+ ******************************************************************************/
+
+STRPTR JGet_ReadFile(CONST_STRPTR file)
+{
+	STRPTR buffer = NULL;
+	FILE * fp;
+	LONG size;
+	
+	if (JInflate_Detect(file) != JINFLATE_NONE)
+		return JGet_InflateFile(file);
+	
+	if (fp = fopen(file, "r"))
+	{
+		fseek(fp, 0L, SEEK_END);
+		
+		if ((size = ftell(fp)) >= 0)
+		{
+			rewind(fp);
+			
+			if (buffer = json_alloc_input_ex(context, size))
+			{
+				size = fread(buffer, 1, size, fp);
+				
+				if (size == 0 || ferror(fp))
+				{
+					json_free_serialized_string_ex(context, buffer);
+					buffer = NULL;
+				}
+				else
+				{
+					buffer[size] = '\0';
+					timing.bytesRead += size;
+				}
+			}
+		}
+		
+		fclose(fp);
+	}
+	
+	return buffer;
+}
+
+/******************************************************************************
+ * 
+ * JGet_InflateFile()
+ * 
+ * A gzip or zlib file decompressed straight into memory, the buffer
+ * doubled as it fills. The context has no realloc, so the text is copied
+ * over each time.
+ * 
+ ******************************************************************************/
+
+STRPTR JGet_InflateFile(CONST_STRPTR file)
+{
+	JInflate * inflater;
+	STRPTR buffer, larger;
+	ULONG size = 0, capacity = 65536;
+	size_t length;
+	
+	if (!(inflater = JInflate_Open(file)))
+		return NULL;
+	
+	buffer = json_alloc_input_ex(context, capacity);
+	
+	while (buffer && (length = JInflate_Read(inflater, buffer + size, capacity - size)) > 0)
+	{
+		if ((size += length) == capacity)
+		{
+			if (larger = json_alloc_input_ex(context, capacity * 2))
+				memcpy(larger, buffer, size);
+			
+			json_free_serialized_string_ex(context, buffer);
+			buffer = larger;
+			capacity *= 2;
+		}
+	}
+	
+	if (!buffer || JInflate_Failed(inflater) || size == 0)
+	{
+		if (JInflate_Failed(inflater))
+			printf("%s is not a valid gzip or zlib file.\n", file);
 		
-		json_free_serialized_string(pretty);
+		json_free_serialized_string_ex(context, buffer);
+		buffer = NULL;
+	}
+	else
+	{
+		buffer[size] = '\0';
+		timing.bytesRead += size;
+	}
+	
+	JInflate_Close(inflater);
+	
+	return buffer;
+}
+
+/******************************************************************************
+ * 
+ * JGet_OpenReader()
+ * 
+ * A streaming reader over the file, or over its decompressed bytes when it
+ * is gzip or zlib, the inflater then returned too.
+ * 
+ ******************************************************************************/
+
+JSON_Reader * JGet_OpenReader(CONST_STRPTR file, JInflate ** inflater)
+{
+	*inflater = NULL;
+	
+	if (JInflate_Detect(file) == JINFLATE_NONE)
+		return json_reader_new_file(NULL, file);
+	
+	if (!(*inflater = JInflate_Open(file)))
+		return NULL;
+	
+	return json_reader_new(NULL, JInflate_Read, *inflater);
+}
+
+/******************************************************************************
+ * 
+ * JGet_CloseReader()
+ * 
+ * Fails when the decompression did, the reader having only seen the end of
+ * its input.
+ * 
+ ******************************************************************************/
+
+BOOL JGet_CloseReader(JSON_Reader * reader, JInflate * inflater, CONST_STRPTR file)
+{
+	BOOL result = TRUE;
+	
+	if (inflater && JInflate_Failed(inflater))
+	{
+		printf("%s is not a valid gzip or zlib file.\n", file);
+		result = FALSE;
 	}
+	
+	json_reader_free(reader);
+	JInflate_Close(inflater);
+	
+	return result;
 }
 
 /******************************************************************************
@@ -135,6 +533,9 @@ BOOL JGet_ParseMatch(CONST_STRPTR name, ULONG depth, ULONG index)
 	
 	if (optList && depth)
 	{
+		if (optTag)
+			printf("%s: ", optTag);
+		
 		printf("%s\n", tmpPath);
 	}
 	
@@ -184,6 +585,8 @@ VOID JGet_ParseObject(JSON_Object * object, ULONG depth, ULONG index)
 
 VOID JGet_ParseValue(JSON_Value * value, CONST_STRPTR name, ULONG depth, ULONG index)
 {
+	timing.nodesVisited++;
+	
 	if (JGet_ParseMatch(name, depth, index))
 	{
 		JGet_PrintValue(value);
@@ -202,30 +605,1206 @@ VOID JGet_ParseValue(JSON_Value * value, CONST_STRPTR name, ULONG depth, ULONG i
 
 /******************************************************************************
  * 
- * JGet_ParseFile()
+ * JGet_ParseDocuments()
  * 
  ******************************************************************************/
 
-BOOL JGet_ParseFile(LONG * opts)
+BOOL JGet_ParseDocuments(CONST_STRPTR buffer)
 {
+	JSON_Documents * documents;
 	JSON_Value * root;
+	BOOL result = FALSE;
+	double t;
 	
-	optList = (BOOL)opts[OPT_LIST];
-	optPath = (STRPTR)opts[OPT_PATH];
+	// Several documents one after the other, each one is queried then freed
 	
-	root = opts[OPT_WITH_COMMENTS] ? 
-		json_parse_file_with_comments((STRPTR)opts[OPT_FILE]) :
-		json_parse_file((STRPTR)opts[OPT_FILE]);
+	if (documents = json_documents_new(context, buffer))
+	{
+		for (;;)
+		{
+			t = JGet_PhaseStart();
+			root = json_documents_next(documents);
+			JGet_PhaseEnd(PHASE_PARSE, t);
+			
+			if (!root)
+				break;
+			
+			t = JGet_PhaseStart();
+			JGet_ParseValue(root, NULL, 0, -1);
+			JGet_PhaseEnd(PHASE_MATCH, t);
+			
+			t = JGet_PhaseStart();
+			json_value_free(root);
+			JGet_PhaseEnd(PHASE_FREE, t);
+		}
+		
+		if (json_documents_failed(documents))
+		{
+			printf("The document at offset %lu is not valid.\n",
+				(ULONG)json_documents_offset(documents));
+		}
+		else
+		{
+			result = TRUE;
+		}
+		
+		json_documents_free(documents);
+	}
 	
-	if (root)
+	return result;
+}
+
+/******************************************************************************
+ * 
+ * JGet_AggregateInit()
+ * 
+ * The operators, e.g. "COUNT,SUM", or ALL of them.
+ * 
+ ******************************************************************************/
+
+BOOL JGet_AggregateInit(JGET_AGGREGATE * aggregate, CONST_STRPTR operators)
+{
+	CONST_STRPTR end;
+	ULONG i, length;
+	
+	memset(aggregate, 0, sizeof(JGET_AGGREGATE));
+	
+	if (stricmp(operators, "ALL") == 0)
 	{
-		json_set_escape_slashes(opts[OPT_ESCAPE_SLASHES]);
-		JGet_ParseValue(root, NULL, 0, -1);
-		json_value_free(root);
+		for (i = 0; i < AGG_OPERATORS; i++)
+		{
+			aggregate->operators[aggregate->operatorCount++] = i;
+		}
+		
 		return TRUE;
 	}
 	
-	return FALSE;
+	while (*operators)
+	{
+		if (!(end = strchr(operators, ',')))
+			end = operators + strlen(operators);
+		
+		length = end - operators;
+		
+		for (i = 0; i < AGG_OPERATORS; i++)
+		{
+			if (length == strlen(aggregateNames[i]) && strnicmp(operators, aggregateNames[i], length) == 0)
+				break;
+		}
+		
+		if (i == AGG_OPERATORS || aggregate->operatorCount == MAX_AGGREGATES)
+			return FALSE;
+		
+		aggregate->operators[aggregate->operatorCount++] = i;
+		operators = *end ? end + 1 : end;
+	}
+	
+	return (BOOL)(aggregate->operatorCount > 0);
+}
+
+/******************************************************************************
+ * 
+ * JGet_AggregateHash()
+ * 
+ ******************************************************************************/
+
+ULONG JGet_AggregateHash(ULONG hash, CONST UBYTE * data, ULONG length)
+{
+	while (length--)
+	{
+		hash = ((hash ^ *data++) * FNV_PRIME) & 0xFFFFFFFFUL;
+	}
+	
+	return hash;
+}
+
+/******************************************************************************
+ * 
+ * JGet_AggregateValue()
+ * 
+ * Adds the value starting with token. The numbers go into the sum, min and
+ * max, every value into the distinct count, hashed a token at a time so
+ * that an object or an array is never held in memory.
+ * 
+ ******************************************************************************/
+
+BOOL JGet_AggregateValue(JGET_AGGREGATE * aggregate, JPath_Walker * walker, JSON_Reader * reader, JSON_Token token)
+{
+	ULONG depth = json_reader_depth(reader), hash = FNV_BASIS, index, rank;
+	CONST_STRPTR text = json_reader_string(reader);
+	ULONG length = json_reader_string_len(reader);
+	double number;
+	UBYTE byte;
+	int match;
+	
+	aggregate->count++;
+	
+	if (token == JSONTokenNumber)
+	{
+		number = json_reader_number(reader);
+		
+		if (aggregate->numbers == 0 || number < aggregate->min)
+		{
+			aggregate->min = number;
+			
+			if (length < sizeof(aggregate->minText))
+				strcpy(aggregate->minText, text);
+			else
+				sprintf(aggregate->minText, "%.17g", number);
+		}
+		
+		if (aggregate->numbers == 0 || number > aggregate->max)
+		{
+			aggregate->max = number;
+			
+			if (length < sizeof(aggregate->maxText))
+				strcpy(aggregate->maxText, text);
+			else
+				sprintf(aggregate->maxText, "%.17g", number);
+		}
+		
+		aggregate->sum += number;
+		aggregate->numbers++;
+	}
+	
+	// A container is one level deeper once its first token is read
+	
+	if (token == JSONTokenBeginObject || token == JSONTokenBeginArray)
+		depth--;
+	
+	for (;;)
+	{
+		byte = (UBYTE)token;
+		hash = JGet_AggregateHash(hash, &byte, 1);
+		
+		switch (token)
+		{
+		case JSONTokenError:
+		case JSONTokenEnd:
+			return FALSE;
+		case JSONTokenKey:
+		case JSONTokenString:
+			// With its '\0', so that "ab","c" and "a","bc" differ
+			hash = JGet_AggregateHash(hash, json_reader_string(reader), json_reader_string_len(reader) + 1);
+			break;
+		case JSONTokenNumber:
+			// By value, 1.0 and 1 are the same number, and so are -0 and 0
+			if ((number = json_reader_number(reader)) == 0.0)
+				number = 0.0;
+			hash = JGet_AggregateHash(hash, (CONST UBYTE *)&number, sizeof(number));
+			break;
+		case JSONTokenBoolean:
+			byte = (UBYTE)json_reader_boolean(reader);
+			hash = JGet_AggregateHash(hash, &byte, 1);
+			break;
+		}
+		
+		if (json_reader_depth(reader) == depth)
+			break;
+		
+		token = JPath_Next(walker, &match);
+	}
+	
+	// The FNV bits are not mixed enough for the register ranks
+	
+	hash ^= hash >> 16;
+	hash = (hash * 0x85EBCA6BUL) & 0xFFFFFFFFUL;
+	hash ^= hash >> 13;
+	hash = (hash * 0xC2B2AE35UL) & 0xFFFFFFFFUL;
+	hash ^= hash >> 16;
+	
+	index = hash >> (32 - HLL_BITS);
+	hash <<= HLL_BITS;
+	
+	for (rank = 1; rank <= 32 - HLL_BITS && !(hash & 0x80000000UL); rank++)
+	{
+		hash <<= 1;
+	}
+	
+	if (rank > aggregate->registers[index])
+		aggregate->registers[index] = (UBYTE)rank;
+	
+	return TRUE;
+}
+
+/******************************************************************************
+ * 
+ * JGet_AggregatePrint()
+ * 
+ * One line per operator, in the order they were given.
+ * 
+ ******************************************************************************/
+
+VOID JGet_AggregatePrint(JGET_AGGREGATE * aggregate)
+{
+	double estimate, sum;
+	ULONG i, r, zeros;
+	
+	for (i = 0; i < aggregate->operatorCount; i++)
+	{
+		switch (aggregate->operators[i])
+		{
+		case AGG_COUNT:
+			printf("%lu\n", aggregate->count);
+			break;
+		case AGG_SUM:
+			printf("%.15g\n", aggregate->sum);
+			break;
+		case AGG_MIN:
+			printf("%s\n", aggregate->numbers ? (STRPTR)aggregate->minText : "null");
+			break;
+		case AGG_MAX:
+			printf("%s\n", aggregate->numbers ? (STRPTR)aggregate->maxText : "null");
+			break;
+		case AGG_AVG:
+			if (aggregate->numbers)
+				printf("%.15g\n", aggregate->sum / aggregate->numbers);
+			else
+				printf("null\n");
+			break;
+		case AGG_DISTINCT:
+			// The HyperLogLog estimate, counting the empty registers
+			// while there are many of them
+			
+			for (sum = 0.0, zeros = 0, r = 0; r < HLL_REGISTERS; r++)
+			{
+				sum += ldexp(1.0, -(int)aggregate->registers[r]);
+				zeros += aggregate->registers[r] == 0;
+			}
+			
+			estimate = (0.7213 / (1.0 + 1.079 / HLL_REGISTERS)) * HLL_REGISTERS * HLL_REGISTERS / sum;
+			
+			if (estimate <= 2.5 * HLL_REGISTERS && zeros > 0)
+				estimate = HLL_REGISTERS * log((double)HLL_REGISTERS / zeros);
+			else if (estimate > 4294967296.0 / 30.0)
+				estimate = -4294967296.0 * log(1.0 - estimate / 4294967296.0);
+			
+			printf("%lu\n", (ULONG)(estimate + 0.5));
+			break;
+		}
+	}
+}
+
+/******************************************************************************
+ * 
+ * JGet_AggregateFile()
+ * 
+ ******************************************************************************/
+
+BOOL JGet_AggregateFile(JGET_AGGREGATE * aggregate, JPath * path, CONST_STRPTR file)
+{
+	JSON_Reader * reader;
+	JInflate * inflater;
+	JPath_Walker * walker = NULL;
+	JSON_Token token = JSONTokenError;
+	int match;
+	
+	if (!(reader = JGet_OpenReader(file, &inflater)) || !(walker = JPath_WalkerNew(reader, path)))
+	{
+		printf("Cannot read %s.\n", file);
+	}
+	else
+	{
+		while ((token = JPath_Next(walker, &match)) != JSONTokenError && token != JSONTokenEnd)
+		{
+			if (match && !JGet_AggregateValue(aggregate, walker, reader, token))
+			{
+				token = JSONTokenError;
+				break;
+			}
+		}
+		
+		timing.bytesRead += json_reader_offset(reader);
+		
+		if (token == JSONTokenError && !(inflater && JInflate_Failed(inflater)))
+			printf("%s is not valid at offset %lu.\n", file, (ULONG)json_reader_offset(reader));
+	}
+	
+	JPath_WalkerFree(walker);
+	
+	if (!JGet_CloseReader(reader, inflater, file))
+		token = JSONTokenError;
+	
+	return (BOOL)(token == JSONTokenEnd);
+}
+
+/******************************************************************************
+ * 
+ * JGet_Aggregate()
+ * 
+ * Reads the files as it goes, without loading them, the memory used being
+ * the same whatever their size. Only the aggregates are printed.
+ * 
+ ******************************************************************************/
+
+BOOL JGet_Aggregate(LONG * opts, STRPTR * files, ULONG fileCount)
+{
+	JGET_AGGREGATE * aggregate;
+	BOOL result = FALSE;
+	JPath path;
+	ULONG i;
+	
+	if (opts[OPT_WITH_COMMENTS] || opts[OPT_MULTI])
+	{
+		printf("AGGREGATE cannot be used with WITHCOMMENTS or MULTI.\n");
+		return FALSE;
+	}
+	
+	if (!JPath_Parse(&path, optPath ? optPath : (STRPTR)"."))
+	{
+		printf("The PATH is not valid.\n");
+		return FALSE;
+	}
+	
+	if (!(aggregate = (JGET_AGGREGATE *)malloc(sizeof(JGET_AGGREGATE))))
+	{
+		printf("Not enough memory.\n");
+	}
+	else if (!JGet_AggregateInit(aggregate, (STRPTR)opts[OPT_AGGREGATE]))
+	{
+		printf("The AGGREGATE operators are COUNT, SUM, MIN, MAX, AVG, DISTINCT or ALL.\n");
+	}
+	else
+	{
+		// The values of all the files make one set
+		
+		for (i = 0; i < fileCount; i++)
+		{
+			if (!JGet_AggregateFile(aggregate, &path, files[i]))
+				break;
+		}
+		
+		timing.matches = aggregate->count;
+		
+		if (i == fileCount)
+		{
+			JGet_AggregatePrint(aggregate);
+			
+			result = (BOOL)(aggregate->count > 0);
+		}
+	}
+	
+	free(aggregate);
+	JPath_Free(&path);
+	
+	return result;
+}
+
+/******************************************************************************
+ * 
+ * JGet_CellAppend(), JGet_CellSink()
+ * 
+ ******************************************************************************/
+
+BOOL JGet_CellAppend(JGET_COLUMN * column, CONST_STRPTR data, ULONG length)
+{
+	STRPTR text;
+	ULONG capacity;
+	
+	if (column->length + length > column->capacity)
+	{
+		for (capacity = column->capacity ? column->capacity : 64; capacity < column->length + length; )
+		{
+			capacity *= 2;
+		}
+		
+		if (!(text = (STRPTR)realloc(column->text, capacity)))
+			return FALSE;
+		
+		column->text = text;
+		column->capacity = capacity;
+	}
+	
+	memcpy(column->text + column->length, data, length);
+	column->length += length;
+	
+	return TRUE;
+}
+
+JSON_Status JGet_CellSink(VOID * sinkData, CONST_STRPTR data, size_t length)
+{
+	return JGet_CellAppend((JGET_COLUMN *)sinkData, data, length) ? JSONSuccess : JSONFailure;
+}
+
+/******************************************************************************
+ * 
+ * JGet_CopyToken()
+ * 
+ ******************************************************************************/
+
+BOOL JGet_CopyToken(JSON_Writer * writer, JSON_Reader * reader, JSON_Token token)
+{
+	JSON_Status status = JSONFailure;
+	
+	switch (token)
+	{
+	case JSONTokenBeginObject:
+		status = json_writer_begin_object(writer);
+		break;
+	case JSONTokenEndObject:
+		status = json_writer_end_object(writer);
+		break;
+	case JSONTokenBeginArray:
+		status = json_writer_begin_array(writer);
+		break;
+	case JSONTokenEndArray:
+		status = json_writer_end_array(writer);
+		break;
+	case JSONTokenKey:
+		status = json_writer_key(writer, json_reader_string(reader));
+		break;
+	case JSONTokenString:
+		status = json_writer_string_with_len(writer, json_reader_string(reader), json_reader_string_len(reader));
+		break;
+	case JSONTokenNumber:
+		status = json_writer_number_text(writer, json_reader_string(reader), json_reader_string_len(reader));
+		break;
+	case JSONTokenBoolean:
+		status = json_writer_boolean(writer, json_reader_boolean(reader));
+		break;
+	case JSONTokenNull:
+		status = json_writer_null(writer);
+		break;
+	}
+	
+	return (BOOL)(status == JSONSuccess);
+}
+
+/******************************************************************************
+ * 
+ * JGet_ColumnToken()
+ * 
+ * The first value of the column in the row goes into its cell : a string
+ * without its quotes, a number as written, nothing for null, an object or
+ * an array as compact JSON.
+ * 
+ ******************************************************************************/
+
+BOOL JGet_ColumnToken(JGET_COLUMN * column, JSON_Reader * reader, JSON_Token token, BOOL match)
+{
+	if (column->writer)
+	{
+		if (!JGet_CopyToken(column->writer, reader, token))
+			return FALSE;
+		
+		if (json_reader_depth(reader) == column->depth)
+		{
+			column->set = (BOOL)(json_writer_finish(column->writer) == JSONSuccess);
+			json_writer_free(column->writer);
+			column->writer = NULL;
+			
+			return column->set;
+		}
+		
+		return TRUE;
+	}
+	
+	if (!match || column->set)
+		return TRUE;
+	
+	column->set = TRUE;
+	
+	switch (token)
+	{
+	case JSONTokenBeginObject:
+	case JSONTokenBeginArray:
+		column->set = FALSE;
+		column->depth = json_reader_depth(reader) - 1;
+		
+		if (!(column->writer = json_writer_new(NULL, (JSON_Writer_Function)JGet_CellSink, column, FALSE)))
+			return FALSE;
+		
+		return JGet_CopyToken(column->writer, reader, token);
+	case JSONTokenString:
+	case JSONTokenNumber:
+		return JGet_CellAppend(column, json_reader_string(reader), json_reader_string_len(reader));
+	case JSONTokenBoolean:
+		return json_reader_boolean(reader) ? JGet_CellAppend(column, "true", 4) : JGet_CellAppend(column, "false", 5);
+	}
+	
+	return TRUE;
+}
+
+/******************************************************************************
+ * 
+ * JGet_ExportCell()
+ * 
+ * CSV quotes a cell holding a separator, a quote or a line break, and
+ * doubles its quotes (RFC 4180). TSV cannot quote, its tabs, line breaks
+ * and backslashes are escaped as \t, \n, \r and \\.
+ * 
+ ******************************************************************************/
+
+VOID JGet_ExportCell(BOOL tsv, CONST_STRPTR text, ULONG length)
+{
+	CONST_STRPTR end = text + length, run;
+	BOOL quote = FALSE;
+	
+	if (!tsv)
+	{
+		for (run = text; run < end && !quote; run++)
+		{
+			quote = (BOOL)(*run == ',' || *run == '"' || *run == '\n' || *run == '\r');
+		}
+		
+		if (!quote)
+		{
+			fwrite(text, 1, length, stdout);
+			return;
+		}
+		
+		putchar('"');
+	}
+	
+	for (run = text; text < end; text++)
+	{
+		if (tsv ? (*text == '\t' || *text == '\n' || *text == '\r' || *text == '\\') : *text == '"')
+		{
+			fwrite(run, 1, text - run, stdout);
+			
+			if (tsv)
+			{
+				putchar('\\');
+				putchar(*text == '\t' ? 't' : *text == '\n' ? 'n' : *text == '\r' ? 'r' : '\\');
+			}
+			else
+			{
+				fputs("\"\"", stdout);
+			}
+			
+			run = text + 1;
+		}
+	}
+	
+	fwrite(run, 1, end - run, stdout);
+	
+	if (!tsv)
+		putchar('"');
+}
+
+/******************************************************************************
+ * 
+ * JGet_ExportFile()
+ * 
+ * Writes the rows of one file, the walkers of the columns following its
+ * reader.
+ * 
+ ******************************************************************************/
+
+BOOL JGet_ExportFile(JGET_COLUMN * columns, ULONG count, JPath * rowPath, BOOL tsv, CONST_STRPTR file, ULONG * rowCount)
+{
+	JSON_Reader * reader;
+	JInflate * inflater;
+	JPath_Walker * rows = NULL;
+	JSON_Token token = JSONTokenError;
+	ULONG i, rowDepth = 0;
+	BOOL inRow = FALSE, failed = FALSE;
+	int match;
+	
+	if (!(reader = JGet_OpenReader(file, &inflater)) || !(rows = JPath_WalkerNew(reader, rowPath)))
+	{
+		printf("Cannot read %s.\n", file);
+		failed = TRUE;
+	}
+	
+	for (i = 0; i < count && !failed; i++)
+	{
+		if (!(columns[i].walker = JPath_WalkerNew(reader, &columns[i].path)))
+		{
+			printf("Not enough memory.\n");
+			failed = TRUE;
+		}
+	}
+	
+	while (!failed && (token = json_reader_next(reader)) != JSONTokenError && token != JSONTokenEnd)
+	{
+		if (JPath_Feed(rows, token, &match) == JSONTokenError)
+		{
+			token = JSONTokenError;
+			break;
+		}
+		
+		if (match)
+		{
+			inRow = TRUE;
+			rowDepth = json_reader_depth(reader);
+			
+			if (token == JSONTokenBeginObject || token == JSONTokenBeginArray)
+				rowDepth--;
+			
+			for (i = 0; i < count; i++)
+			{
+				columns[i].length = 0;
+				columns[i].set = FALSE;
+			}
+		}
+		
+		for (i = 0; i < count; i++)
+		{
+			if (JPath_Feed(columns[i].walker, token, &match) == JSONTokenError ||
+				(inRow && !JGet_ColumnToken(&columns[i], reader, token, (BOOL)match)))
+				failed = TRUE;
+		}
+		
+		if (failed)
+		{
+			printf("Not enough memory.\n");
+			break;
+		}
+		
+		if (inRow && json_reader_depth(reader) == rowDepth)
+		{
+			for (i = 0; i < count; i++)
+			{
+				if (i > 0)
+					putchar(tsv ? '\t' : ',');
+				
+				JGet_ExportCell(tsv, columns[i].text, columns[i].length);
+			}
+			
+			putchar('\n');
+			
+			inRow = FALSE;
+			(*rowCount)++;
+		}
+	}
+	
+	if (token == JSONTokenError && !failed && !(inflater && JInflate_Failed(inflater)))
+	{
+		fflush(stdout);
+		
+		if (json_reader_next(reader) != JSONTokenError)
+			printf("Not enough memory.\n");
+		else
+			printf("%s is not valid at offset %lu.\n", file, (ULONG)json_reader_offset(reader));
+	}
+	
+	for (i = 0; i < count; i++)
+	{
+		json_writer_free(columns[i].writer);
+		JPath_WalkerFree(columns[i].walker);
+		
+		columns[i].writer = NULL;
+		columns[i].walker = NULL;
+	}
+	
+	timing.bytesRead += json_reader_offset(reader);
+	
+	JPath_WalkerFree(rows);
+	
+	if (!JGet_CloseReader(reader, inflater, file))
+		token = JSONTokenError;
+	
+	return (BOOL)(token == JSONTokenEnd);
+}
+
+/******************************************************************************
+ * 
+ * JGet_Export()
+ * 
+ * One row per value at the PATH, one column per path of COLUMNS, relative
+ * to the row. The files are read once as they go, the memory used being
+ * the size of a row whatever the size of the files.
+ * 
+ ******************************************************************************/
+
+BOOL JGet_Export(LONG * opts, STRPTR * files, ULONG fileCount)
+{
+	JGET_COLUMN * columns = NULL;
+	CONST_STRPTR format = (STRPTR)opts[OPT_EXPORT];
+	STRPTR names = NULL, name, fullPath;
+	ULONG i, count = 0, rowCount = 0;
+	BOOL result = FALSE, tsv;
+	JPath rowPath;
+	
+	if (stricmp(format, "CSV") != 0 && stricmp(format, "TSV") != 0)
+	{
+		printf("The EXPORT format is CSV or TSV.\n");
+		return FALSE;
+	}
+	
+	if (!optPath || !opts[OPT_COLUMNS] || opts[OPT_WITH_COMMENTS] || opts[OPT_MULTI])
+	{
+		printf("EXPORT needs a PATH and COLUMNS, not WITHCOMMENTS nor MULTI.\n");
+		return FALSE;
+	}
+	
+	tsv = (BOOL)(stricmp(format, "TSV") == 0);
+	
+	if (!JPath_Parse(&rowPath, optPath))
+	{
+		printf("The PATH is not valid.\n");
+		return FALSE;
+	}
+	
+	// The columns, split at the commas, each one matched from the root
+	
+	if ((names = (STRPTR)malloc(strlen((STRPTR)opts[OPT_COLUMNS]) + 1)) != NULL)
+	{
+		strcpy(names, (STRPTR)opts[OPT_COLUMNS]);
+		
+		for (count = 1, name = names; *name; name++)
+		{
+			count += *name == ',';
+		}
+		
+		columns = (JGET_COLUMN *)calloc(count, sizeof(JGET_COLUMN));
+	}
+	
+	if (!columns)
+	{
+		printf("Not enough memory.\n");
+		goto cleanup;
+	}
+	
+	for (i = 0, name = names; i < count; i++)
+	{
+		columns[i].name = name;
+		
+		if ((name = strchr(name, ',')) != NULL)
+			*name++ = '\0';
+		
+		if (!(fullPath = (STRPTR)malloc(strlen(optPath) + strlen(columns[i].name) + 1)))
+		{
+			printf("Not enough memory.\n");
+			goto cleanup;
+		}
+		
+		strcpy(fullPath, optPath);
+		
+		if (strcmp(columns[i].name, ".") != 0)
+			strcat(fullPath, columns[i].name);
+		
+		columns[i].parsed = JPath_Parse(&columns[i].path, fullPath);
+		free(fullPath);
+		
+		if (!columns[i].parsed)
+		{
+			printf("The column %s is not valid.\n", columns[i].name);
+			goto cleanup;
+		}
+	}
+	
+	json_set_escape_slashes(opts[OPT_ESCAPE_SLASHES]);
+	
+	// The rows are written a buffer at a time
+	
+	setvbuf(stdout, NULL, _IOFBF, EXPORT_BUFFER_SIZE);
+	
+	for (i = 0; i < count; i++)
+	{
+		if (i > 0)
+			putchar(tsv ? '\t' : ',');
+		
+		// The names without their leading dot
+		
+		name = (STRPTR)columns[i].name;
+		
+		if (name[0] == '.' && name[1])
+			name++;
+		
+		JGet_ExportCell(tsv, name, strlen(name));
+	}
+	
+	putchar('\n');
+	
+	// The rows of all the files make one table
+	
+	for (i = 0; i < fileCount; i++)
+	{
+		if (!JGet_ExportFile(columns, count, &rowPath, tsv, files[i], &rowCount))
+			break;
+	}
+	
+	timing.matches = rowCount;
+	
+	if (fflush(stdout) == 0 && i == fileCount)
+		result = (BOOL)(rowCount > 0);
+	
+cleanup:
+	
+	for (i = 0; columns && i < count; i++)
+	{
+		if (columns[i].parsed)
+			JPath_Free(&columns[i].path);
+		
+		free(columns[i].text);
+	}
+	
+	JPath_Free(&rowPath);
+	free(columns);
+	free(names);
+	
+	return result;
+}
+
+/******************************************************************************
+ * 
+ * JGet_PoolAlloc(), JGet_PoolFree()
+ * 
+ * The allocator of the parser context, one exec memory pool per file. The
+ * document is dropped at once with its pool, not freed node by node.
+ * 
+ ******************************************************************************/
+
+VOID * JGet_PoolAlloc(VOID * pool, size_t size)
+{
+	UBYTE * block;
+	
+	if (block = (UBYTE *)AllocPooled(pool, size + POOL_HEADER))
+	{
+		*(ULONG *)block = size + POOL_HEADER;
+		block += POOL_HEADER;
+	}
+	
+	return block;
+}
+
+VOID JGet_PoolFree(VOID * pool, VOID * memory)
+{
+	UBYTE * block = (UBYTE *)memory - POOL_HEADER;
+	
+	if (memory)
+	{
+		FreePooled(pool, block, *(ULONG *)block);
+	}
+}
+
+/******************************************************************************
+ * 
+ * JGet_MatchFiles(), JGet_FreeFiles()
+ * 
+ * The files matching the FILE pattern, and those of the directories below
+ * with ALL, sorted by name so that the output does not depend on the order
+ * of the directories. A file named as it is does not go through
+ * MatchFirst(), which would take "data(1).json" or "a[b].json" for a
+ * pattern and find another file or none.
+ * 
+ ******************************************************************************/
+
+int JGet_CompareNames(const VOID * a, const VOID * b)
+{
+	return stricmp(*(STRPTR *)a, *(STRPTR *)b);
+}
+
+STRPTR * JGet_MatchFiles(CONST_STRPTR pattern, BOOL all, ULONG * count)
+{
+	struct AnchorPath * anchor;
+	STRPTR * files = NULL, * newFiles;
+	ULONG capacity = 0;
+	LONG error;
+	
+	*count = 0;
+	
+	if (JGet_IsFile(pattern))
+	{
+		if ((files = (STRPTR *)malloc(sizeof(STRPTR))) && (files[0] = (STRPTR)malloc(strlen(pattern) + 1)))
+		{
+			strcpy(files[0], pattern);
+			*count = 1;
+			return files;
+		}
+		
+		printf("Not enough memory.\n");
+		free(files);
+		return NULL;
+	}
+	
+	if (!all && !JGet_IsPattern(pattern))
+	{
+		printf("No file matches %s.\n", pattern);
+		return NULL;
+	}
+	
+	if (!(anchor = (struct AnchorPath *)AllocVec(sizeof(struct AnchorPath) + MAXFILELEN, MEMF_CLEAR)))
+		return NULL;
+	
+	anchor->ap_BreakBits = SIGBREAKF_CTRL_C;
+	anchor->ap_Strlen = MAXFILELEN;
+	
+	for (error = MatchFirst((STRPTR)pattern, anchor); error == 0; error = MatchNext(anchor))
+	{
+		if (anchor->ap_Info.fib_DirEntryType > 0)
+		{
+			// Enter each directory once, on its way down
+			
+			if (all && !(anchor->ap_Flags & APF_DIDDIR))
+				anchor->ap_Flags |= APF_DODIR;
+			
+			anchor->ap_Flags &= ~APF_DIDDIR;
+			continue;
+		}
+		
+		if (*count == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 64;
+			
+			if (!(newFiles = (STRPTR *)realloc(files, capacity * sizeof(STRPTR))))
+				break;
+			
+			files = newFiles;
+		}
+		
+		if (!(files[*count] = (STRPTR)malloc(strlen(anchor->ap_Buf) + 1)))
+			break;
+		
+		strcpy(files[(*count)++], anchor->ap_Buf);
+	}
+	
+	MatchEnd(anchor);
+	FreeVec(anchor);
+	
+	if (error == 0)
+	{
+		printf("Not enough memory.\n");
+	}
+	else if (error == ERROR_BREAK)
+	{
+		printf("***Break\n");
+	}
+	
+	else if (error == ERROR_OBJECT_NOT_FOUND || (error == ERROR_NO_MORE_ENTRIES && *count == 0))
+	{
+		printf("No file matches %s.\n", pattern);
+	}
+	
+	if (error != ERROR_NO_MORE_ENTRIES)
+	{
+		JGet_FreeFiles(files, *count);
+		*count = 0;
+		return NULL;
+	}
+	
+	if (*count > 1)
+	{
+		qsort(files, *count, sizeof(STRPTR), JGet_CompareNames);
+	}
+	
+	return files;
+}
+
+VOID JGet_FreeFiles(STRPTR * files, ULONG count)
+{
+	ULONG i;
+	
+	for (i = 0; i < count; i++)
+	{
+		free(files[i]);
+	}
+	
+	free(files);
+}
+
+/******************************************************************************
+ * 
+ * JGet_IsPattern()
+ * 
+ ******************************************************************************/
+
+BOOL JGet_IsPattern(CONST_STRPTR pattern)
+{
+	LONG size = strlen(pattern) * 2 + 2;
+	STRPTR buffer;
+	BOOL result = FALSE;
+	
+	if (buffer = (STRPTR)malloc(size))
+	{
+		result = (BOOL)(ParsePatternNoCase((STRPTR)pattern, buffer, size) == 1);
+		free(buffer);
+	}
+	
+	return result;
+}
+
+/******************************************************************************
+ * 
+ * JGet_IsFile()
+ * 
+ * TRUE for the name of a file as it is, pattern characters and all.
+ * 
+ ******************************************************************************/
+
+BOOL JGet_IsFile(CONST_STRPTR name)
+{
+	struct FileInfoBlock * fib;
+	BPTR lock;
+	BOOL result = FALSE;
+	
+	if (lock = Lock((STRPTR)name, ACCESS_READ))
+	{
+		if (fib = (struct FileInfoBlock *)AllocDosObject(DOS_FIB, NULL))
+		{
+			if (Examine(lock, fib))
+				result = (BOOL)(fib->fib_DirEntryType < 0);
+			
+			FreeDosObject(DOS_FIB, fib);
+		}
+		
+		UnLock(lock);
+	}
+	
+	return result;
+}
+
+/******************************************************************************
+ * 
+ * JGet_ParseFile()
+ * 
+ ******************************************************************************/
+
+BOOL JGet_ParseFile(LONG * opts, CONST_STRPTR file)
+{
+	JSON_Value * root = NULL;
+	STRPTR buffer;
+	APTR pool;
+	BOOL result = FALSE;
+	double t;
+	
+	if (!(pool = CreatePool(MEMF_ANY, POOL_PUDDLE, POOL_THRESHOLD)))
+		return FALSE;
+	
+	// The input is read into the pool as well, and counted as input
+	
+	json_context_set_allocator(context, JGet_PoolAlloc, JGet_PoolFree, pool);
+	
+	t = JGet_PhaseStart();
+	buffer = JGet_ReadFile(file);
+	JGet_PhaseEnd(PHASE_READ, t);
+	
+	if (!buffer)
+	{
+		json_context_set_allocator(context, NULL, NULL, NULL);
+		DeletePool(pool);
+		return FALSE;
+	}
+	
+	if (opts[OPT_WITH_COMMENTS])
+	{
+		t = JGet_PhaseStart();
+		json_strip_comments(buffer);
+		JGet_PhaseEnd(PHASE_COMMENTS, t);
+	}
+	
+	if (opts[OPT_MULTI])
+	{
+		result = JGet_ParseDocuments(buffer);
+	}
+	else
+	{
+		t = JGet_PhaseStart();
+		root = json_parse_string_ex(context, buffer);
+		JGet_PhaseEnd(PHASE_PARSE, t);
+	}
+	
+	json_free_serialized_string_ex(context, buffer);
+	
+	if (root)
+	{
+		result = TRUE;
+		
+		t = JGet_PhaseStart();
+		JGet_ParseValue(root, NULL, 0, -1);
+		JGet_PhaseEnd(PHASE_MATCH, t);
+	}
+	
+	// The context lets go of its scratch buffer before the pool goes
+	
+	t = JGet_PhaseStart();
+	json_context_set_allocator(context, NULL, NULL, NULL);
+	DeletePool(pool);
+	JGet_PhaseEnd(PHASE_FREE, t);
+	
+	return result;
+}
+
+/******************************************************************************
+ * 
+ * JGet_ParseFiles()
+ * 
+ * The files are queried one after the other by the same process, with the
+ * same parser context, each one in a pool of its own. With a pattern or
+ * ALL, the values and paths are printed after the name of their file.
+ * 
+ ******************************************************************************/
+
+BOOL JGet_ParseFiles(LONG * opts)
+{
+	JSON_Stats stats;
+	STRPTR * files;
+	ULONG i, count;
+	BOOL result = FALSE, tag;
+	double t;
+	
+	optList = (BOOL)opts[OPT_LIST];
+	optPath = (STRPTR)opts[OPT_PATH];
+	optTiming = (BOOL)(opts[OPT_TIMING] && JTimer_Open());
+	
+	memset(&timing, 0, sizeof(timing));
+	
+	files = JGet_MatchFiles((STRPTR)opts[OPT_FILE], (BOOL)opts[OPT_ALL], &count);
+	tag = (BOOL)(opts[OPT_ALL] || (JGet_IsPattern((STRPTR)opts[OPT_FILE]) && !JGet_IsFile((STRPTR)opts[OPT_FILE])));
+	
+	if (opts[OPT_STATS] || optTiming)
+	{
+		json_reset_stats();
+		json_set_stats_enabled(TRUE);
+	}
+	
+	if (count == 0)
+	{
+		// No file, or not enough memory for their names
+	}
+	else if (opts[OPT_AGGREGATE] || opts[OPT_EXPORT])
+	{
+		// Read as they go with the default context, never loaded
+		
+		t = JGet_PhaseStart();
+		result = opts[OPT_EXPORT] ? JGet_Export(opts, files, count) : JGet_Aggregate(opts, files, count);
+		JGet_PhaseEnd(PHASE_PARSE, t);
+	}
+	else if (!(context = json_context_new()))
+	{
+		printf("Not enough memory.\n");
+	}
+	else
+	{
+		// Keep the text of the numbers, they are printed verbatim
+		
+		json_context_set_stats_enabled(context, opts[OPT_STATS] || optTiming);
+		json_context_set_number_lexemes(context, TRUE);
+		json_context_set_escape_slashes(context, opts[OPT_ESCAPE_SLASHES]);
+		
+		for (result = TRUE, i = 0; i < count; i++)
+		{
+			optTag = tag ? files[i] : NULL;
+			
+			if (!JGet_ParseFile(opts, files[i]))
+				result = FALSE;
+		}
+	}
+	
+	JGet_FreeFiles(files, count);
+	
+	if (json_context_get_stats(context, &stats) == JSONSuccess)
+	{
+		timing.nodesCreated = stats.allocations[JSONAllocValue];
+	}
+	
+	if (opts[OPT_STATS])
+	{
+		JGet_PrintStats();
+	}
+	
+	if (optTiming)
+	{
+		JGet_PrintTiming((STRPTR)opts[OPT_FILE], (STRPTR)opts[OPT_TIMING]);
+		JTimer_Close();
+	}
+	
+	json_context_free(context);
+	context = NULL;
+	
+	return result;
 }
 
 /******************************************************************************
@@ -254,7 +1833,7 @@ ULONG main(ULONG argc, STRPTR * argv)
 		}
 		else
 		{
-			if (JGet_ParseFile(opts))
+			if (JGet_ParseFiles(opts))
 			{
 				result = RETURN_OK;
 			}
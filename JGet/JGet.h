@@ -8,11 +8,18 @@
 #define APP_VERSTRING "$VER: JGet 1.0 (16.3.2025) [SAS/C 6.59] " APP_AUTHOR
 #define APP_HELPSTRING ("Usage: JGet <jsonfile> [<jsonpath>] [<options>]\n\n"\
 	" HELP            This help.\n"\
-	" FILE            The JSON file to parse (mandatory).\n"\
+	" FILE            The JSON file to parse, gzip or not, or a pattern (mandatory).\n"\
 	" PATH            The path of the JSON value to retrieve (optional).\n"\
 	" LIST            List all the JSON paths (optional).\n"\
 	" ESCAPESLASHES   Escape slashes in the JSON values (optional).\n"\
-	" WITHCOMMENTS    For use with commented JSON files (optional).\n\n"\
+	" WITHCOMMENTS    For use with commented JSON files (optional).\n"\
+	" MULTI           The file holds several JSON documents (optional).\n"\
+	" STATS           Print the parser memory statistics (optional).\n"\
+	" TIMING          Print the phase timings, as TEXT or JSON (optional).\n"\
+	" AGGREGATE       Print COUNT, SUM, MIN, MAX, AVG, DISTINCT or ALL (optional).\n"\
+	" EXPORT          Print the values at PATH as CSV or TSV rows (optional).\n"\
+	" COLUMNS         The column paths of EXPORT, e.g. .id,.name (optional).\n"\
+	" ALL             Match the FILE pattern in the directories below (optional).\n\n"\
 	"See JGet.help for a more detailed documentation.\n")
 
 #endif /* __JGET_H__ */
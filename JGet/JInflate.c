@@ -0,0 +1,744 @@
+/******************************************************************************
+ *
+ * File:    JInflate.c
+ * Short:   gzip and zlib files decompressed as they are read
+ * Author:  Philippe CARPENTIER, aka flype.
+ * Date:    March 2025
+ *
+ * A plain inflater (RFC 1950, 1951, 1952), written to be read from like a
+ * file: it stops wherever the caller's buffer is full, in the middle of a
+ * block or of a match, and goes on from there on the next call.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "JInflate.h"
+
+#define INPUT_SIZE  4096
+#define WINDOW_SIZE 32768
+#define WINDOW_MASK (WINDOW_SIZE - 1)
+#define FAST_BITS   9
+#define FAST_MASK   ((1 << FAST_BITS) - 1)
+
+#define ADLER_BASE  65521UL
+#define ADLER_NMAX  5552
+
+enum {
+	STATE_HEADER,   /* of the stream or of the next gzip member */
+	STATE_BLOCK,    /* the header of the next block */
+	STATE_STORED,
+	STATE_CODES,
+	STATE_TRAILER,
+	STATE_DONE
+};
+
+/******************************************************************************
+ *
+ * Canonical Huffman codes. The codes of up to FAST_BITS bits are found with
+ * one look-up of the next bits, the longer ones by their length.
+ *
+ ******************************************************************************/
+
+typedef struct {
+	unsigned short fast[1 << FAST_BITS];  /* (length << 9) | symbol, 0 for a longer code */
+	unsigned short firstCode[16];
+	unsigned short firstSymbol[16];
+	unsigned long  maxCode[17];           /* first code past the length, on 16 bits */
+	unsigned char  size[288];
+	unsigned short value[288];
+} JInflate_Huffman;
+
+struct JInflate {
+	FILE *           fp;
+	unsigned char    input[INPUT_SIZE];
+	size_t           inputPos;
+	size_t           inputLength;
+	size_t           offset;
+	unsigned long    bits;          /* read from the low bit up */
+	int              bitCount;
+	int              pad;           /* zero bits past the end of the file, on top */
+	int              format;        /* of the current member */
+	int              state;
+	int              last;          /* the current block is the last one */
+	int              failed;
+	size_t           stored;        /* bytes left in a stored block */
+	size_t           copyLength;    /* of the match being copied */
+	size_t           copyDistance;
+	unsigned long    check;         /* CRC-32 or Adler-32 of the member so far */
+	unsigned long    size;          /* of the member, modulo 2^32 */
+	size_t           windowPos;
+	size_t           windowFill;    /* the distance a match may go back */
+	unsigned char    window[WINDOW_SIZE];
+	JInflate_Huffman lengths;       /* literals, lengths and the end of block */
+	JInflate_Huffman distances;
+};
+
+static const unsigned short lengthBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const unsigned char lengthExtra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const unsigned short distanceBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const unsigned char distanceExtra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static const unsigned char codeLengthOrder[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static unsigned long crcTable[256];
+static int crcReady = 0;
+
+/******************************************************************************
+ *
+ * Input, a bit at a time
+ *
+ ******************************************************************************/
+
+static int JInflate_Byte(JInflate * z)
+{
+	if (z->inputPos == z->inputLength)
+	{
+		z->inputPos = 0;
+		z->inputLength = fread(z->input, 1, INPUT_SIZE, z->fp);
+
+		if (z->inputLength == 0)
+			return -1;
+	}
+
+	z->offset++;
+	return z->input[z->inputPos++];
+}
+
+/* At least 25 bits in the buffer, zeros past the end of the file */
+static void JInflate_Fill(JInflate * z)
+{
+	int c;
+
+	while (z->bitCount <= 24)
+	{
+		if ((c = z->pad ? -1 : JInflate_Byte(z)) < 0)
+		{
+			c = 0;
+			z->pad += 8;
+		}
+
+		z->bits |= (unsigned long)c << z->bitCount;
+		z->bitCount += 8;
+	}
+}
+
+/* Drops n bits, the file is cut short when they were past its end */
+static void JInflate_Drop(JInflate * z, int n)
+{
+	z->bits >>= n;
+	z->bitCount -= n;
+
+	if (z->bitCount < z->pad)
+		z->failed = 1;
+}
+
+static unsigned long JInflate_Bits(JInflate * z, int n)
+{
+	unsigned long value;
+
+	if (n == 0)
+		return 0;
+
+	if (z->bitCount < n)
+		JInflate_Fill(z);
+
+	value = z->bits & ((1UL << n) - 1);
+	JInflate_Drop(z, n);
+
+	return value;
+}
+
+static void JInflate_Align(JInflate * z)
+{
+	JInflate_Drop(z, z->bitCount & 7);
+}
+
+/******************************************************************************
+ *
+ * Huffman codes
+ *
+ ******************************************************************************/
+
+static unsigned int JInflate_Reverse(unsigned int v, int n)
+{
+	v = ((v & 0xAAAA) >> 1) | ((v & 0x5555) << 1);
+	v = ((v & 0xCCCC) >> 2) | ((v & 0x3333) << 2);
+	v = ((v & 0xF0F0) >> 4) | ((v & 0x0F0F) << 4);
+	v = ((v & 0xFF00) >> 8) | ((v & 0x00FF) << 8);
+
+	return v >> (16 - n);
+}
+
+/* Fails when more codes are given a length than it has room for */
+static int JInflate_Build(JInflate_Huffman * h, const unsigned char * lengths, int count)
+{
+	int sizes[16], nextCode[16];
+	int i, j, s, c, code = 0, k = 0;
+
+	memset(sizes, 0, sizeof(sizes));
+	memset(h->fast, 0, sizeof(h->fast));
+
+	for (i = 0; i < count; i++)
+		sizes[lengths[i]]++;
+
+	sizes[0] = 0;
+
+	for (i = 1; i < 16; i++)
+	{
+		nextCode[i] = code;
+		h->firstCode[i] = (unsigned short)code;
+		h->firstSymbol[i] = (unsigned short)k;
+		code += sizes[i];
+
+		if (sizes[i] && code - 1 >= (1 << i))
+			return 0;
+
+		h->maxCode[i] = (unsigned long)code << (16 - i);
+		code <<= 1;
+		k += sizes[i];
+	}
+
+	h->maxCode[16] = 0x10000UL;
+
+	for (i = 0; i < count; i++)
+	{
+		if ((s = lengths[i]) == 0)
+			continue;
+
+		c = nextCode[s] - h->firstCode[s] + h->firstSymbol[s];
+		h->size[c] = (unsigned char)s;
+		h->value[c] = (unsigned short)i;
+
+		if (s <= FAST_BITS)
+		{
+			for (j = JInflate_Reverse(nextCode[s], s); j < (1 << FAST_BITS); j += 1 << s)
+				h->fast[j] = (unsigned short)((s << 9) | i);
+		}
+
+		nextCode[s]++;
+	}
+
+	return 1;
+}
+
+static int JInflate_Decode(JInflate * z, const JInflate_Huffman * h)
+{
+	unsigned long k;
+	int b, s;
+
+	if (z->bitCount < 16)
+		JInflate_Fill(z);
+
+	if ((b = h->fast[z->bits & FAST_MASK]) != 0)
+	{
+		JInflate_Drop(z, b >> 9);
+		return b & 511;
+	}
+
+	k = JInflate_Reverse((unsigned int)(z->bits & 0xFFFF), 16);
+
+	for (s = FAST_BITS + 1; k >= h->maxCode[s]; s++)
+		;
+
+	if (s >= 16)
+	{
+		z->failed = 1;
+		return -1;
+	}
+
+	b = (int)(k >> (16 - s)) - h->firstCode[s] + h->firstSymbol[s];
+
+	if (b >= 288 || h->size[b] != s)
+	{
+		z->failed = 1;
+		return -1;
+	}
+
+	JInflate_Drop(z, s);
+	return h->value[b];
+}
+
+static int JInflate_Fixed(JInflate * z)
+{
+	unsigned char lengths[288];
+	int i;
+
+	for (i = 0; i < 288; i++)
+		lengths[i] = (unsigned char)(i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8);
+
+	if (!JInflate_Build(&z->lengths, lengths, 288))
+		return 0;
+
+	memset(lengths, 5, 30);
+
+	return JInflate_Build(&z->distances, lengths, 30);
+}
+
+/* The code lengths of the block, themselves Huffman coded */
+static int JInflate_Dynamic(JInflate * z)
+{
+	unsigned char lengths[286 + 30], codeLengths[19];
+	int hlit, hdist, hclen, i, n, symbol, repeat, value;
+
+	hlit = (int)JInflate_Bits(z, 5) + 257;
+	hdist = (int)JInflate_Bits(z, 5) + 1;
+	hclen = (int)JInflate_Bits(z, 4) + 4;
+
+	if (hlit > 286 || hdist > 30)
+		return 0;
+
+	memset(codeLengths, 0, sizeof(codeLengths));
+
+	for (i = 0; i < hclen; i++)
+		codeLengths[codeLengthOrder[i]] = (unsigned char)JInflate_Bits(z, 3);
+
+	if (!JInflate_Build(&z->lengths, codeLengths, 19))
+		return 0;
+
+	for (n = 0; n < hlit + hdist && !z->failed; )
+	{
+		if ((symbol = JInflate_Decode(z, &z->lengths)) < 16)
+		{
+			if (symbol >= 0)
+				lengths[n++] = (unsigned char)symbol;
+			continue;
+		}
+
+		if (symbol == 16)
+		{
+			if (n == 0)
+				return 0;
+
+			value = lengths[n - 1];
+			repeat = 3 + (int)JInflate_Bits(z, 2);
+		}
+		else
+		{
+			value = 0;
+			repeat = symbol == 17 ? 3 + (int)JInflate_Bits(z, 3) : 11 + (int)JInflate_Bits(z, 7);
+		}
+
+		if (n + repeat > hlit + hdist)
+			return 0;
+
+		memset(lengths + n, value, repeat);
+		n += repeat;
+	}
+
+	if (z->failed || lengths[256] == 0)
+		return 0;
+
+	return JInflate_Build(&z->lengths, lengths, hlit) &&
+		JInflate_Build(&z->distances, lengths + hlit, hdist);
+}
+
+/******************************************************************************
+ *
+ * Checksums
+ *
+ ******************************************************************************/
+
+static void JInflate_CrcTable(void)
+{
+	unsigned long c;
+	int n, k;
+
+	for (n = 0; n < 256; n++)
+	{
+		for (c = (unsigned long)n, k = 0; k < 8; k++)
+			c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+
+		crcTable[n] = c;
+	}
+
+	crcReady = 1;
+}
+
+static void JInflate_Check(JInflate * z, const unsigned char * data, size_t length)
+{
+	unsigned long a, b, c;
+	size_t n;
+
+	z->size = (z->size + (unsigned long)length) & 0xFFFFFFFFUL;
+	z->windowFill = length < WINDOW_SIZE - z->windowFill ? z->windowFill + length : WINDOW_SIZE;
+
+	if (z->format == JINFLATE_GZIP)
+	{
+		for (c = z->check; length > 0; length--)
+			c = crcTable[(c ^ *data++) & 0xFF] ^ (c >> 8);
+
+		z->check = c;
+		return;
+	}
+
+	a = z->check & 0xFFFF;
+	b = (z->check >> 16) & 0xFFFF;
+
+	while (length > 0)
+	{
+		n = length < ADLER_NMAX ? length : ADLER_NMAX;
+		length -= n;
+
+		while (n-- > 0)
+		{
+			a += *data++;
+			b += a;
+		}
+
+		a %= ADLER_BASE;
+		b %= ADLER_BASE;
+	}
+
+	z->check = (b << 16) | a;
+}
+
+/******************************************************************************
+ *
+ * Headers and trailers
+ *
+ ******************************************************************************/
+
+static int JInflate_IsZlib(int cmf, int flg)
+{
+	/* Deflate, a window of 32 KB at most, no preset dictionary */
+	return (cmf & 0x0F) == 8 && (cmf >> 4) <= 7 && ((cmf << 8) | flg) % 31 == 0 && !(flg & 0x20);
+}
+
+static void JInflate_SkipString(JInflate * z)
+{
+	while (JInflate_Bits(z, 8) != 0 && !z->failed)
+		;
+}
+
+static int JInflate_Header(JInflate * z)
+{
+	int b0, b1, flags;
+	unsigned long i, length;
+
+	b0 = (int)JInflate_Bits(z, 8);
+	b1 = (int)JInflate_Bits(z, 8);
+
+	if (b0 == 0x1F && b1 == 0x8B)
+	{
+		if (JInflate_Bits(z, 8) != 8 || ((flags = (int)JInflate_Bits(z, 8)) & 0xE0))
+			return 0;
+
+		for (i = 0; i < 6; i++)     /* Time, extra flags, system */
+			JInflate_Bits(z, 8);
+
+		if (flags & 4)
+		{
+			for (length = JInflate_Bits(z, 16), i = 0; i < length && !z->failed; i++)
+				JInflate_Bits(z, 8);
+		}
+
+		if (flags & 8)
+			JInflate_SkipString(z);
+
+		if (flags & 16)
+			JInflate_SkipString(z);
+
+		if (flags & 2)
+			JInflate_Bits(z, 16);
+
+		z->format = JINFLATE_GZIP;
+		z->check = 0xFFFFFFFFUL;
+	}
+	else if (z->format == JINFLATE_NONE && JInflate_IsZlib(b0, b1))
+	{
+		z->format = JINFLATE_ZLIB;
+		z->check = 1;
+	}
+	else
+	{
+		return 0;
+	}
+
+	z->size = 0;
+	z->last = 0;
+	z->windowFill = 0;
+
+	return !z->failed;
+}
+
+/* Checks the member just read, then tells whether another one follows */
+static int JInflate_Trailer(JInflate * z)
+{
+	unsigned long check, size;
+
+	JInflate_Align(z);
+
+	if (z->format == JINFLATE_GZIP)
+	{
+		check = JInflate_Bits(z, 16);
+		check |= JInflate_Bits(z, 16) << 16;
+		size = JInflate_Bits(z, 16);
+		size |= JInflate_Bits(z, 16) << 16;
+
+		if (z->failed || check != (z->check ^ 0xFFFFFFFFUL) || size != z->size)
+			return 0;
+
+		JInflate_Fill(z);
+
+		z->state = z->bitCount - z->pad >= 16 && (z->bits & 0xFFFF) == 0x8B1F ? STATE_HEADER : STATE_DONE;
+	}
+	else
+	{
+		check = JInflate_Bits(z, 8) << 24;
+		check |= JInflate_Bits(z, 8) << 16;
+		check |= JInflate_Bits(z, 8) << 8;
+		check |= JInflate_Bits(z, 8);
+
+		if (z->failed || check != z->check)
+			return 0;
+
+		z->state = STATE_DONE;
+	}
+
+	return 1;
+}
+
+/******************************************************************************
+ *
+ * Reading
+ *
+ ******************************************************************************/
+
+int JInflate_Detect(const char * filename)
+{
+	unsigned char head[2];
+	int format = JINFLATE_NONE;
+	FILE * fp;
+
+	if ((fp = fopen(filename, "rb")) != NULL)
+	{
+		if (fread(head, 1, 2, fp) == 2)
+		{
+			if (head[0] == 0x1F && head[1] == 0x8B)
+				format = JINFLATE_GZIP;
+			else if (JInflate_IsZlib(head[0], head[1]))
+				format = JINFLATE_ZLIB;
+		}
+
+		fclose(fp);
+	}
+
+	return format;
+}
+
+JInflate * JInflate_Open(const char * filename)
+{
+	JInflate * z;
+
+	if (!crcReady)
+		JInflate_CrcTable();
+
+	if ((z = (JInflate *)malloc(sizeof(JInflate))) == NULL)
+		return NULL;
+
+	memset(z, 0, offsetof(JInflate, window));
+	z->format = JINFLATE_NONE;
+	z->state = STATE_HEADER;
+
+	if ((z->fp = fopen(filename, "rb")) == NULL)
+	{
+		free(z);
+		return NULL;
+	}
+
+	return z;
+}
+
+size_t JInflate_Read(void * inflater, char * buffer, size_t size)
+{
+	JInflate * z = (JInflate *)inflater;
+	unsigned char * out = (unsigned char *)buffer, * end = out + size, * mark = out;
+	size_t from, length;
+	int symbol = 0, c;
+
+	while (out < end && !z->failed && z->state != STATE_DONE)
+	{
+		/* The rest of a match first */
+		if (z->copyLength > 0)
+		{
+			from = (z->windowPos - z->copyDistance) & WINDOW_MASK;
+
+			for (; z->copyLength > 0 && out < end; z->copyLength--)
+			{
+				*out++ = z->window[z->windowPos] = z->window[from];
+				from = (from + 1) & WINDOW_MASK;
+				z->windowPos = (z->windowPos + 1) & WINDOW_MASK;
+			}
+
+			continue;
+		}
+
+		switch (z->state)
+		{
+		case STATE_HEADER:
+			if (!JInflate_Header(z))
+				z->failed = 1;
+			else
+				z->state = STATE_BLOCK;
+			break;
+
+		case STATE_BLOCK:
+			if (z->last)
+			{
+				z->state = STATE_TRAILER;
+				break;
+			}
+
+			z->last = (int)JInflate_Bits(z, 1);
+
+			switch (JInflate_Bits(z, 2))
+			{
+			case 0:
+				JInflate_Align(z);
+				z->stored = JInflate_Bits(z, 16);
+
+				if ((z->stored ^ 0xFFFF) != JInflate_Bits(z, 16))
+					z->failed = 1;
+
+				z->state = STATE_STORED;
+				break;
+			case 1:
+				if (!JInflate_Fixed(z))
+					z->failed = 1;
+				z->state = STATE_CODES;
+				break;
+			case 2:
+				if (!JInflate_Dynamic(z))
+					z->failed = 1;
+				z->state = STATE_CODES;
+				break;
+			default:
+				z->failed = 1;
+				break;
+			}
+			break;
+
+		case STATE_STORED:
+			/* Bytes still in the bit buffer, then straight from the file */
+			for (; z->stored > 0 && out < end; z->stored--)
+			{
+				if (z->bitCount > z->pad)
+					c = (int)JInflate_Bits(z, 8);
+				else if ((c = JInflate_Byte(z)) < 0)
+				{
+					z->failed = 1;
+					break;
+				}
+
+				*out++ = z->window[z->windowPos] = (unsigned char)c;
+				z->windowPos = (z->windowPos + 1) & WINDOW_MASK;
+			}
+
+			if (z->stored == 0)
+				z->state = STATE_BLOCK;
+			break;
+
+		case STATE_CODES:
+			while (out < end && (symbol = JInflate_Decode(z, &z->lengths)) < 256)
+			{
+				if (symbol < 0)
+					break;
+
+				*out++ = z->window[z->windowPos] = (unsigned char)symbol;
+				z->windowPos = (z->windowPos + 1) & WINDOW_MASK;
+			}
+
+			if (out == end || z->failed)
+				break;
+
+			if (symbol == 256)
+			{
+				z->state = STATE_BLOCK;
+				break;
+			}
+
+			if ((symbol -= 257) >= 29)
+			{
+				z->failed = 1;
+				break;
+			}
+
+			length = lengthBase[symbol] + JInflate_Bits(z, lengthExtra[symbol]);
+
+			if ((symbol = JInflate_Decode(z, &z->distances)) < 0 || symbol >= 30)
+			{
+				z->failed = 1;
+				break;
+			}
+
+			z->copyDistance = distanceBase[symbol] + JInflate_Bits(z, distanceExtra[symbol]);
+			z->copyLength = length;
+
+			/* Not further back than the output of the member */
+			if (z->copyDistance > z->windowFill + (size_t)(out - mark))
+				z->failed = 1;
+			break;
+
+		case STATE_TRAILER:
+			JInflate_Check(z, mark, out - mark);
+			mark = out;
+
+			if (!JInflate_Trailer(z))
+				z->failed = 1;
+			break;
+		}
+
+		/* The window holds the output of the member up to its size */
+		if (z->state == STATE_HEADER)
+			mark = out;
+	}
+
+	JInflate_Check(z, mark, out - mark);
+
+	return z->failed ? 0 : (size_t)(out - (unsigned char *)buffer);
+}
+
+int JInflate_Failed(const JInflate * inflater)
+{
+	return inflater->failed;
+}
+
+size_t JInflate_Offset(const JInflate * inflater)
+{
+	return inflater->offset;
+}
+
+void JInflate_Close(JInflate * inflater)
+{
+	if (inflater)
+	{
+		fclose(inflater->fp);
+		free(inflater);
+	}
+}
+
+/******************************************************************************
+ *
+ * End of file
+ *
+ ******************************************************************************/
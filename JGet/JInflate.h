@@ -0,0 +1,41 @@
+/******************************************************************************
+ *
+ * File:    JInflate.h
+ * Short:   gzip and zlib files decompressed as they are read
+ * Author:  Philippe CARPENTIER, aka flype.
+ * Date:    March 2025
+ *
+ ******************************************************************************/
+
+#ifndef __JINFLATE_H__
+#define __JINFLATE_H__
+
+#include <stddef.h>
+
+/******************************************************************************
+ *
+ * JInflate_Detect() tells from its first bytes whether a file is gzip, as
+ * written by gzip, or zlib, as written by deflate streams, and no JSON text
+ * starts like either. JInflate_Read() then returns the decompressed bytes
+ * in order, as a JSON_Reader_Function does, 0 at the end or on an error,
+ * which JInflate_Failed() tells apart, the checksums included. gzip members
+ * written one after the other are read as one stream. The inflater keeps
+ * the last 32 KB of output and reads its file 4 KB at a time, whatever the
+ * size of the file.
+ *
+ ******************************************************************************/
+
+#define JINFLATE_NONE 0
+#define JINFLATE_GZIP 1
+#define JINFLATE_ZLIB 2
+
+typedef struct JInflate JInflate;
+
+int        JInflate_Detect   (const char * filename);
+JInflate * JInflate_Open     (const char * filename);
+size_t     JInflate_Read     (void * inflater, char * buffer, size_t size);
+int        JInflate_Failed   (const JInflate * inflater);
+size_t     JInflate_Offset   (const JInflate * inflater); /* compressed bytes read */
+void       JInflate_Close    (JInflate * inflater);
+
+#endif /* __JINFLATE_H__ */
@@ -0,0 +1,522 @@
+/******************************************************************************
+ *
+ * File:    JMerge.c
+ * Short:   Applies a JSON merge patch (RFC 7386) to a JSON file
+ * Author:  Philippe CARPENTIER, aka flype.
+ * Date:    March 2025
+ *
+ * Only the patch is parsed. The base document is read one token at a time
+ * with a JSON_Reader and written back through a JSON_Writer, the members
+ * named by the patch being replaced, removed or merged on the way, so that
+ * the memory used depends on the size of the patch, not of the base.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dos/dos.h>
+#include <exec/exec.h>
+#include <proto/dos.h>
+#include <proto/exec.h>
+
+#include "JMerge.h"
+#include "parson.h"
+
+/******************************************************************************
+ *
+ * DEFINES
+ *
+ ******************************************************************************/
+
+#define TEMPLATE "H=HELP/S,B=BASE/A,P=PATCH/A,TO/K,PRETTY/S,E=ESCAPESLASHES/S"
+
+#define FNV_BASIS  2166136261UL
+#define FNV_PRIME  16777619UL
+
+#define NO_SLOT    ((ULONG)~0UL)
+
+typedef enum {
+	OPT_HELP,
+	OPT_BASE,
+	OPT_PATCH,
+	OPT_TO,
+	OPT_PRETTY,
+	OPT_ESCAPE_SLASHES,
+	OPT_COUNT
+} OPT_ARGS;
+
+typedef struct {
+	JSON_Object * patch;
+	ULONG       * slots;     // Member positions by name hash
+	ULONG         mask;
+	UBYTE       * applied;   // The member was found in the base object
+} JMERGE_INDEX;
+
+/******************************************************************************
+ *
+ * GLOBALS
+ *
+ ******************************************************************************/
+
+static BOOL   outOfMemory = FALSE;
+static STRPTR verstring = APP_VERSTRING;
+
+extern struct ExecBase * SysBase;
+extern struct DosLibrary * DOSBase;
+
+#ifdef __SASC
+long __stack = 65536; // The merge recurses as deep as the patch
+#endif
+
+/******************************************************************************
+ *
+ * PROTOTYPES
+ *
+ ******************************************************************************/
+
+VOID JMerge_PrintHelp    (VOID);
+ULONG JMerge_NameHash    (CONST_STRPTR name);
+BOOL JMerge_IndexInit    (JMERGE_INDEX * index, JSON_Object * patch);
+ULONG JMerge_IndexFind   (JMERGE_INDEX * index, CONST_STRPTR name);
+VOID JMerge_IndexFree    (JMERGE_INDEX * index);
+JSON_Status JMerge_Stdout(VOID * sinkData, CONST_STRPTR data, size_t length);
+BOOL JMerge_Skip         (JSON_Reader * reader, JSON_Token token);
+BOOL JMerge_Copy         (JSON_Reader * reader, JSON_Writer * writer, JSON_Token token);
+BOOL JMerge_WritePatch   (JSON_Writer * writer, JSON_Value * value);
+BOOL JMerge_MergeObject  (JSON_Reader * reader, JSON_Writer * writer, JSON_Object * patch);
+BOOL JMerge_MergeValue   (JSON_Reader * reader, JSON_Writer * writer, JSON_Value * patch);
+ULONG JMerge_MergeFiles  (LONG * options);
+
+/******************************************************************************
+ *
+ * JMerge_PrintHelp()
+ *
+ ******************************************************************************/
+
+VOID JMerge_PrintHelp(VOID)
+{
+	printf(APP_HELPSTRING);
+}
+
+/******************************************************************************
+ *
+ * JMerge_NameHash()
+ *
+ ******************************************************************************/
+
+ULONG JMerge_NameHash(CONST_STRPTR name)
+{
+	ULONG hash = FNV_BASIS;
+
+	while (*name)
+	{
+		hash = ((hash ^ (UBYTE)*name++) * FNV_PRIME) & 0xFFFFFFFFUL;
+	}
+
+	return hash;
+}
+
+/******************************************************************************
+ *
+ * JMerge_IndexInit(), JMerge_IndexFind(), JMerge_IndexFree()
+ *
+ * The member names of a patch object, hashed once, as parson looks names
+ * up one after the other.
+ *
+ ******************************************************************************/
+
+BOOL JMerge_IndexInit(JMERGE_INDEX * index, JSON_Object * patch)
+{
+	ULONG count = json_object_get_count(patch), size = 16, m, slot;
+
+	while (size < count * 2)
+		size *= 2;
+
+	index->patch = patch;
+	index->mask = size - 1;
+
+	if (!(index->slots = (ULONG *)malloc(size * sizeof(ULONG) + count + 1)))
+	{
+		outOfMemory = TRUE;
+		return FALSE;
+	}
+
+	index->applied = (UBYTE *)&index->slots[size];
+
+	memset(index->slots, 0xFF, size * sizeof(ULONG));
+	memset(index->applied, 0, count);
+
+	for (m = 0; m < count; m++)
+	{
+		slot = JMerge_NameHash(json_object_get_name(patch, m)) & index->mask;
+
+		while (index->slots[slot] != NO_SLOT)
+			slot = (slot + 1) & index->mask;
+
+		index->slots[slot] = m;
+	}
+
+	return TRUE;
+}
+
+ULONG JMerge_IndexFind(JMERGE_INDEX * index, CONST_STRPTR name)
+{
+	ULONG slot = JMerge_NameHash(name) & index->mask;
+
+	while (index->slots[slot] != NO_SLOT)
+	{
+		if (strcmp(json_object_get_name(index->patch, index->slots[slot]), name) == 0)
+			return index->slots[slot];
+
+		slot = (slot + 1) & index->mask;
+	}
+
+	return NO_SLOT;
+}
+
+VOID JMerge_IndexFree(JMERGE_INDEX * index)
+{
+	free(index->slots);
+}
+
+/******************************************************************************
+ *
+ * JMerge_Stdout()
+ *
+ ******************************************************************************/
+
+JSON_Status JMerge_Stdout(VOID * sinkData, CONST_STRPTR data, size_t length)
+{
+	return fwrite(data, 1, length, stdout) == length ? JSONSuccess : JSONFailure;
+}
+
+/******************************************************************************
+ *
+ * JMerge_Skip()
+ *
+ * Drops the base value starting with token.
+ *
+ ******************************************************************************/
+
+BOOL JMerge_Skip(JSON_Reader * reader, JSON_Token token)
+{
+	if (token == JSONTokenBeginObject || token == JSONTokenBeginArray)
+		token = json_reader_skip(reader);
+
+	return (BOOL)(token != JSONTokenError && token != JSONTokenEnd);
+}
+
+/******************************************************************************
+ *
+ * JMerge_Copy()
+ *
+ * Writes the base value starting with token as it is, numbers as written.
+ *
+ ******************************************************************************/
+
+BOOL JMerge_Copy(JSON_Reader * reader, JSON_Writer * writer, JSON_Token token)
+{
+	ULONG depth = json_reader_depth(reader);
+	JSON_Status status;
+
+	// A container is one level deeper once its first token is read
+
+	if (token == JSONTokenBeginObject || token == JSONTokenBeginArray)
+		depth--;
+
+	for (;;)
+	{
+		switch (token)
+		{
+		case JSONTokenBeginObject:
+			status = json_writer_begin_object(writer);
+			break;
+		case JSONTokenEndObject:
+			status = json_writer_end_object(writer);
+			break;
+		case JSONTokenBeginArray:
+			status = json_writer_begin_array(writer);
+			break;
+		case JSONTokenEndArray:
+			status = json_writer_end_array(writer);
+			break;
+		case JSONTokenKey:
+			status = json_writer_key(writer, json_reader_string(reader));
+			break;
+		case JSONTokenString:
+			status = json_writer_string_with_len(writer, json_reader_string(reader), json_reader_string_len(reader));
+			break;
+		case JSONTokenNumber:
+			status = json_writer_number_text(writer, json_reader_string(reader), json_reader_string_len(reader));
+			break;
+		case JSONTokenBoolean:
+			status = json_writer_boolean(writer, json_reader_boolean(reader));
+			break;
+		case JSONTokenNull:
+			status = json_writer_null(writer);
+			break;
+		default:
+			return FALSE;
+		}
+
+		if (status != JSONSuccess)
+			return FALSE;
+
+		if (json_reader_depth(reader) == depth)
+			return TRUE;
+
+		token = json_reader_next(reader);
+	}
+}
+
+/******************************************************************************
+ *
+ * JMerge_WritePatch()
+ *
+ * Writes a patch value where the base has none : the null members of its
+ * objects remove nothing, they are left out.
+ *
+ ******************************************************************************/
+
+BOOL JMerge_WritePatch(JSON_Writer * writer, JSON_Value * value)
+{
+	JSON_Object * object;
+	JSON_Value * member;
+	ULONG i, count;
+
+	if (json_type(value) != JSONObject)
+		return (BOOL)(json_writer_value(writer, value) == JSONSuccess);
+
+	object = json_object(value);
+	count = json_object_get_count(object);
+
+	if (json_writer_begin_object(writer) != JSONSuccess)
+		return FALSE;
+
+	for (i = 0; i < count; i++)
+	{
+		member = json_object_get_value_at(object, i);
+
+		if (json_type(member) == JSONNull)
+			continue;
+
+		if (json_writer_key(writer, json_object_get_name(object, i)) != JSONSuccess ||
+			!JMerge_WritePatch(writer, member))
+			return FALSE;
+	}
+
+	return (BOOL)(json_writer_end_object(writer) == JSONSuccess);
+}
+
+/******************************************************************************
+ *
+ * JMerge_MergeObject()
+ *
+ * Both the base object and its copy are open. The members of the base named
+ * by the patch are merged, removed when the patch value is null, the members
+ * of the patch that the base does not have are added at the end.
+ *
+ ******************************************************************************/
+
+BOOL JMerge_MergeObject(JSON_Reader * reader, JSON_Writer * writer, JSON_Object * patch)
+{
+	JMERGE_INDEX index;
+	JSON_Value * value;
+	JSON_Token token;
+	BOOL result = FALSE;
+	ULONG m, count = json_object_get_count(patch);
+
+	if (!JMerge_IndexInit(&index, patch))
+		return FALSE;
+
+	while ((token = json_reader_next(reader)) == JSONTokenKey)
+	{
+		if ((m = JMerge_IndexFind(&index, json_reader_string(reader))) == NO_SLOT)
+		{
+			if (!JMerge_Copy(reader, writer, token) || !JMerge_Copy(reader, writer, json_reader_next(reader)))
+				goto cleanup;
+
+			continue;
+		}
+
+		index.applied[m] = TRUE;
+		value = json_object_get_value_at(patch, m);
+
+		if (json_type(value) == JSONNull)
+		{
+			if (!JMerge_Skip(reader, json_reader_next(reader)))
+				goto cleanup;
+
+			continue;
+		}
+
+		if (json_writer_key(writer, json_object_get_name(patch, m)) != JSONSuccess ||
+			!JMerge_MergeValue(reader, writer, value))
+			goto cleanup;
+	}
+
+	if (token != JSONTokenEndObject)
+		goto cleanup;
+
+	for (m = 0; m < count; m++)
+	{
+		value = json_object_get_value_at(patch, m);
+
+		if (index.applied[m] || json_type(value) == JSONNull)
+			continue;
+
+		if (json_writer_key(writer, json_object_get_name(patch, m)) != JSONSuccess ||
+			!JMerge_WritePatch(writer, value))
+			goto cleanup;
+	}
+
+	result = (BOOL)(json_writer_end_object(writer) == JSONSuccess);
+
+cleanup:
+
+	JMerge_IndexFree(&index);
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * JMerge_MergeValue()
+ *
+ * Merges the patch into the next base value : an object patch merges into
+ * an object, any other patch replaces the value.
+ *
+ ******************************************************************************/
+
+BOOL JMerge_MergeValue(JSON_Reader * reader, JSON_Writer * writer, JSON_Value * patch)
+{
+	JSON_Token token = json_reader_next(reader);
+
+	if (json_type(patch) == JSONObject && token == JSONTokenBeginObject)
+	{
+		if (json_writer_begin_object(writer) != JSONSuccess)
+			return FALSE;
+
+		return JMerge_MergeObject(reader, writer, json_object(patch));
+	}
+
+	return (BOOL)(JMerge_Skip(reader, token) && JMerge_WritePatch(writer, patch));
+}
+
+/******************************************************************************
+ *
+ * JMerge_MergeFiles()
+ *
+ ******************************************************************************/
+
+ULONG JMerge_MergeFiles(LONG * opts)
+{
+	ULONG result = RETURN_ERROR;
+	JSON_Reader * reader = NULL;
+	JSON_Writer * writer = NULL;
+	JSON_Value * patch;
+	JSON_Token token = JSONTokenError;
+	BOOL pretty = (BOOL)opts[OPT_PRETTY], merged;
+
+	// Keep the text of the numbers, they are written verbatim
+
+	json_set_number_lexemes(TRUE);
+	json_set_escape_slashes(opts[OPT_ESCAPE_SLASHES]);
+
+	if (!(patch = json_parse_file((STRPTR)opts[OPT_PATCH])))
+	{
+		printf("The PATCH file is not valid.\n");
+		return result;
+	}
+
+	if (!(reader = json_reader_new_file(NULL, (STRPTR)opts[OPT_BASE])))
+	{
+		printf("Cannot open the BASE file.\n");
+	}
+	else if (opts[OPT_TO])
+	{
+		if (!(writer = json_writer_new_file(NULL, (STRPTR)opts[OPT_TO], pretty)))
+			printf("Cannot open the TO file.\n");
+	}
+	else
+	{
+		writer = json_writer_new(NULL, (JSON_Writer_Function)JMerge_Stdout, NULL, pretty);
+	}
+
+	if (reader && writer)
+	{
+		// The whole of BASE, a second document after it is not merged
+
+		if ((merged = JMerge_MergeValue(reader, writer, patch)) && (token = json_reader_next(reader)) == JSONTokenEnd &&
+			json_writer_finish(writer) == JSONSuccess)
+		{
+			if (!opts[OPT_TO])
+				printf("\n");
+
+			result = RETURN_OK;
+		}
+		else if (outOfMemory)
+		{
+			printf("\nNot enough memory.\n");
+		}
+		else if (merged ? token != JSONTokenEnd : json_reader_next(reader) == JSONTokenError)
+		{
+			printf("\nThe BASE file is not valid at offset %lu.\n", (ULONG)json_reader_offset(reader));
+		}
+		else
+		{
+			printf("\nCannot write the result.\n");
+		}
+	}
+
+	json_writer_free(writer);
+	json_reader_free(reader);
+	json_value_free(patch);
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * Entry point
+ *
+ ******************************************************************************/
+
+ULONG main(ULONG argc, STRPTR * argv)
+{
+	ULONG result = RETURN_FAIL;
+	LONG opts[OPT_COUNT];
+	struct RDArgs * rdArgs;
+
+	memset(opts, 0, sizeof(opts));
+
+	if (rdArgs = (struct RDArgs *)ReadArgs(TEMPLATE, opts, NULL))
+	{
+		if (opts[OPT_HELP])
+		{
+			JMerge_PrintHelp();
+
+			result = RETURN_OK;
+		}
+		else
+		{
+			result = JMerge_MergeFiles(opts);
+		}
+
+		FreeArgs(rdArgs);
+	}
+	else
+	{
+		JMerge_PrintHelp();
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * End of file
+ *
+ ******************************************************************************/
@@ -0,0 +1,18 @@
+#ifndef __JMERGE_H__
+#define __JMERGE_H__
+
+#include <exec/types.h>
+#include <exec/execbase.h>
+
+#define APP_AUTHOR "Philippe CARPENTIER"
+#define APP_VERSTRING "$VER: JMerge 1.0 (16.3.2025) [SAS/C 6.59] " APP_AUTHOR
+#define APP_HELPSTRING ("Usage: JMerge <basefile> <patchfile> [TO <file>] [<options>]\n\n"\
+	" HELP            This help.\n"\
+	" BASE            The JSON file to patch (mandatory).\n"\
+	" PATCH           The JSON merge patch to apply, RFC 7386 (mandatory).\n"\
+	" TO              The file to write, the console if omitted (optional).\n"\
+	" PRETTY          Write the result prettyfied (optional).\n"\
+	" ESCAPESLASHES   Escape slashes in the JSON values (optional).\n\n"\
+	"See JMerge.help for a more detailed documentation.\n")
+
+#endif /* __JMERGE_H__ */
@@ -0,0 +1,283 @@
+/******************************************************************************
+ *
+ * File:    JPath.c
+ * Short:   JGet paths matched on the fly over a streaming JSON reader
+ * Author:  Philippe CARPENTIER, aka flype.
+ * Date:    March 2025
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "JPath.h"
+
+#define JPATH_NONE ((size_t)~0UL)
+
+/******************************************************************************
+ *
+ * Walker : one level per open container. The levels above the current
+ * value all match when 'matched' is the depth.
+ *
+ ******************************************************************************/
+
+typedef struct {
+	unsigned char isObject;
+	unsigned char match;   /* the current member or element matches its segment */
+	unsigned long index;   /* of the current element, JPATH_ANY before the first */
+} JPath_Level;
+
+struct JPath_Walker {
+	JSON_Reader * reader;
+	const JPath * path;
+	JPath_Level * levels;
+	size_t        depth;
+	size_t        capacity;
+	size_t        matched;
+	size_t        prefix;   /* segments matched by the value just started */
+};
+
+/******************************************************************************
+ *
+ * Paths
+ *
+ ******************************************************************************/
+
+int JPath_Parse(JPath * path, const char * text)
+{
+	size_t length = strlen(text);
+	JPath_Segment * segment = NULL;
+	char * name;
+
+	path->count = 0;
+	path->segments = (JPath_Segment *)malloc((length + 1) * sizeof(JPath_Segment));
+	path->names = name = (char *)malloc(length + 1);
+
+	if (!path->segments || !name)
+	{
+		JPath_Free(path);
+		return 0;
+	}
+
+	if (strcmp(text, ".") == 0)
+		return 1;
+
+	while (*text)
+	{
+		segment = &path->segments[path->count++];
+
+		if (*text == '.')
+		{
+			segment->name = name;
+			segment->index = 0;
+
+			for (text++; *text && *text != '.' && *text != '['; )
+				*name++ = *text++;
+
+			if (name == segment->name)
+				break;
+
+			*name++ = '\0';
+		}
+		else if (text[0] == '[' && text[1] == '*' && text[2] == ']')
+		{
+			segment->name = NULL;
+			segment->index = JPATH_ANY;
+			text += 3;
+		}
+		else if (text[0] == '[' && isdigit((unsigned char)text[1]))
+		{
+			segment->name = NULL;
+			segment->index = strtoul(text + 1, (char **)&text, 10);
+
+			if (*text++ != ']')
+				break;
+		}
+		else
+		{
+			break;
+		}
+
+		segment = NULL;
+	}
+
+	if (segment)
+	{
+		JPath_Free(path);
+		return 0;
+	}
+
+	return 1;
+}
+
+void JPath_Free(JPath * path)
+{
+	free(path->segments);
+	free(path->names);
+
+	path->segments = NULL;
+	path->names = NULL;
+	path->count = 0;
+}
+
+/******************************************************************************
+ *
+ * Walker
+ *
+ ******************************************************************************/
+
+static int JPath_SameName(const char * a, const char * b)
+{
+	while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b))
+	{
+		a++;
+		b++;
+	}
+
+	return *a == *b;
+}
+
+/* The current member or element of the innermost container is known */
+static void JPath_Update(JPath_Walker * walker, int match)
+{
+	JPath_Level * level = &walker->levels[walker->depth - 1];
+
+	level->match = (unsigned char)match;
+
+	if (walker->matched >= walker->depth - 1)
+		walker->matched = match ? walker->depth : walker->depth - 1;
+}
+
+JPath_Walker * JPath_WalkerNew(JSON_Reader * reader, const JPath * path)
+{
+	JPath_Walker * walker;
+
+	if ((walker = (JPath_Walker *)malloc(sizeof(JPath_Walker))) != NULL)
+	{
+		walker->reader = reader;
+		walker->path = path;
+		walker->levels = NULL;
+		walker->depth = 0;
+		walker->capacity = 0;
+		walker->matched = 0;
+		walker->prefix = JPATH_NONE;
+	}
+
+	return walker;
+}
+
+JSON_Token JPath_Next(JPath_Walker * walker, int * match)
+{
+	return JPath_Feed(walker, json_reader_next(walker->reader), match);
+}
+
+/* Several walkers may follow the same reader, the tokens read once */
+JSON_Token JPath_Feed(JPath_Walker * walker, JSON_Token token, int * match)
+{
+	const JPath_Segment * segment;
+	JPath_Level * level;
+	size_t depth = walker->depth;
+
+	*match = 0;
+	walker->prefix = JPATH_NONE;
+
+	switch (token)
+	{
+	case JSONTokenError:
+	case JSONTokenEnd:
+		return token;
+
+	case JSONTokenEndObject:
+	case JSONTokenEndArray:
+		walker->depth--;
+		if (walker->matched > walker->depth)
+			walker->matched = walker->depth;
+		return token;
+
+	case JSONTokenKey:
+		segment = depth <= walker->path->count ? &walker->path->segments[depth - 1] : NULL;
+		JPath_Update(walker, segment && segment->name &&
+			JPath_SameName(segment->name, json_reader_string(walker->reader)));
+		return token;
+	}
+
+	// A value, the next element when in an array
+
+	if (depth > 0 && !walker->levels[depth - 1].isObject)
+	{
+		level = &walker->levels[depth - 1];
+		level->index++;
+
+		segment = depth <= walker->path->count ? &walker->path->segments[depth - 1] : NULL;
+		JPath_Update(walker, segment && !segment->name &&
+			(segment->index == JPATH_ANY || segment->index == level->index));
+	}
+
+	if (walker->matched == depth)
+		walker->prefix = depth;
+
+	*match = walker->prefix == walker->path->count;
+
+	if (token == JSONTokenBeginObject || token == JSONTokenBeginArray)
+	{
+		if (depth == walker->capacity)
+		{
+			depth = walker->capacity ? walker->capacity * 2 : 16;
+			level = (JPath_Level *)realloc(walker->levels, depth * sizeof(JPath_Level));
+
+			if (!level)
+				return JSONTokenError;
+
+			walker->levels = level;
+			walker->capacity = depth;
+		}
+
+		level = &walker->levels[walker->depth++];
+		level->isObject = (unsigned char)(token == JSONTokenBeginObject);
+		level->match = 0;
+		level->index = JPATH_ANY;
+	}
+
+	return token;
+}
+
+int JPath_Prefix(const JPath_Walker * walker, size_t count)
+{
+	return walker->prefix == count;
+}
+
+/* Passes the rest of the container the last token opened */
+JSON_Token JPath_Skip(JPath_Walker * walker)
+{
+	JSON_Token token = json_reader_skip(walker->reader);
+
+	if (token == JSONTokenEndObject || token == JSONTokenEndArray)
+	{
+		walker->depth--;
+		if (walker->matched > walker->depth)
+			walker->matched = walker->depth;
+	}
+
+	return token;
+}
+
+unsigned long JPath_Index(const JPath_Walker * walker, size_t level)
+{
+	return level < walker->depth ? walker->levels[level].index : JPATH_ANY;
+}
+
+void JPath_WalkerFree(JPath_Walker * walker)
+{
+	if (walker)
+	{
+		free(walker->levels);
+		free(walker);
+	}
+}
+
+/******************************************************************************
+ *
+ * End of file
+ *
+ ******************************************************************************/
@@ -0,0 +1,60 @@
+/******************************************************************************
+ *
+ * File:    JPath.h
+ * Short:   JGet paths matched on the fly over a streaming JSON reader
+ * Author:  Philippe CARPENTIER, aka flype.
+ * Date:    March 2025
+ *
+ ******************************************************************************/
+
+#ifndef __JPATH_H__
+#define __JPATH_H__
+
+#include <stddef.h>
+
+#include "parson.h"
+
+/******************************************************************************
+ *
+ * A path is written as in JGet, ".colors[0].name", names being compared
+ * without case. "[*]" stands for every element of an array, and "." alone
+ * for the whole document.
+ *
+ * JPath_Next() returns the tokens of the reader one at a time, as
+ * json_reader_next() does, and tells when a token starts a value at the
+ * path. JPath_Prefix() tells when it starts a value at the first 'count'
+ * segments of the path instead, e.g. the elements of ".items[*]" on the way
+ * to ".items[*].date". JPath_Skip() passes the rest of a container, as
+ * json_reader_skip() does. JPath_Feed() takes a token already read instead,
+ * for several walkers to follow one reader. The walker keeps a few bytes
+ * per open container.
+ *
+ ******************************************************************************/
+
+#define JPATH_ANY ((unsigned long)~0UL)
+
+typedef struct {
+	const char *  name;   /* NULL for an array element */
+	unsigned long index;  /* of the element, JPATH_ANY for [*] */
+} JPath_Segment;
+
+typedef struct {
+	JPath_Segment * segments;
+	size_t          count;
+	char          * names;  /* the names, one after the other */
+} JPath;
+
+typedef struct JPath_Walker JPath_Walker;
+
+int            JPath_Parse       (JPath * path, const char * text);
+void           JPath_Free        (JPath * path);
+
+JPath_Walker * JPath_WalkerNew   (JSON_Reader * reader, const JPath * path);
+JSON_Token     JPath_Next        (JPath_Walker * walker, int * match);
+JSON_Token     JPath_Feed        (JPath_Walker * walker, JSON_Token token, int * match);
+JSON_Token     JPath_Skip        (JPath_Walker * walker);
+int            JPath_Prefix      (const JPath_Walker * walker, size_t count);
+unsigned long  JPath_Index       (const JPath_Walker * walker, size_t level);
+void           JPath_WalkerFree  (JPath_Walker * walker);
+
+#endif /* __JPATH_H__ */
@@ -0,0 +1,458 @@
+/******************************************************************************
+ *
+ * File:    JSet.c
+ * Short:   Sets a value in a JSON file, in place
+ * Author:  Philippe CARPENTIER, aka flype.
+ * Date:    March 2025
+ *
+ * The file is not parsed. It is read once with a JSON_Reader to find where
+ * the values at the path start and end, then copied with the new value
+ * written over these byte spans, the rest of the file left as it is, its
+ * layout and its numbers included.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dos/dos.h>
+#include <exec/exec.h>
+#include <proto/dos.h>
+#include <proto/exec.h>
+
+#include "JSet.h"
+#include "JPath.h"
+#include "parson.h"
+
+/******************************************************************************
+ *
+ * DEFINES
+ *
+ ******************************************************************************/
+
+#define TEMPLATE "H=HELP/S,F=FILE/A,P=PATH/A,V=VALUE/A,S=STRING/S,TO/K"
+
+#define COPY_BUFFER_SIZE 32768
+
+typedef enum {
+	OPT_HELP,
+	OPT_FILE,
+	OPT_PATH,
+	OPT_VALUE,
+	OPT_STRING,
+	OPT_TO,
+	OPT_COUNT
+} OPT_ARGS;
+
+typedef struct {
+	ULONG start;  // Offset of the first byte of the old value
+	ULONG end;    // Offset of the byte after it
+} JSET_SPAN;
+
+typedef struct {
+	JSET_SPAN * spans;
+	ULONG       count;
+	ULONG       capacity;
+} JSET_SPANS;
+
+/******************************************************************************
+ *
+ * GLOBALS
+ *
+ ******************************************************************************/
+
+static BOOL   outOfMemory = FALSE;
+static STRPTR verstring = APP_VERSTRING;
+
+extern struct ExecBase * SysBase;
+extern struct DosLibrary * DOSBase;
+
+/******************************************************************************
+ *
+ * PROTOTYPES
+ *
+ ******************************************************************************/
+
+VOID JSet_PrintHelp    (VOID);
+STRPTR JSet_ValueText  (LONG * opts);
+BOOL JSet_AddSpan      (JSET_SPANS * spans, ULONG start, ULONG end);
+JSON_Token JSet_Find   (CONST_STRPTR fileName, JPath * path, JSET_SPANS * spans);
+BOOL JSet_Splice       (CONST_STRPTR fromName, CONST_STRPTR toName, JSET_SPANS * spans, CONST_STRPTR text);
+BOOL JSet_Replace      (CONST_STRPTR fileName, CONST_STRPTR tempName);
+ULONG JSet_SetValue    (LONG * opts);
+
+/******************************************************************************
+ *
+ * JSet_PrintHelp()
+ *
+ ******************************************************************************/
+
+VOID JSet_PrintHelp(VOID)
+{
+	printf(APP_HELPSTRING);
+}
+
+/******************************************************************************
+ *
+ * JSet_ValueText()
+ *
+ * The new value as compact JSON text, numbers as written in the argument.
+ *
+ ******************************************************************************/
+
+STRPTR JSet_ValueText(LONG * opts)
+{
+	JSON_Value * value;
+	STRPTR text;
+
+	json_set_number_lexemes(TRUE);
+
+	if (opts[OPT_STRING])
+		value = json_value_init_string((STRPTR)opts[OPT_VALUE]);
+	else
+		value = json_parse_string((STRPTR)opts[OPT_VALUE]);
+
+	if (!value)
+		return NULL;
+
+	text = json_serialize_to_string(value);
+	json_value_free(value);
+
+	return text;
+}
+
+/******************************************************************************
+ *
+ * JSet_AddSpan()
+ *
+ ******************************************************************************/
+
+BOOL JSet_AddSpan(JSET_SPANS * spans, ULONG start, ULONG end)
+{
+	JSET_SPAN * newSpans;
+	ULONG capacity;
+
+	if (spans->count == spans->capacity)
+	{
+		capacity = spans->capacity ? spans->capacity * 2 : 16;
+
+		if (!(newSpans = (JSET_SPAN *)realloc(spans->spans, capacity * sizeof(JSET_SPAN))))
+		{
+			outOfMemory = TRUE;
+			return FALSE;
+		}
+
+		spans->spans = newSpans;
+		spans->capacity = capacity;
+	}
+
+	spans->spans[spans->count].start = start;
+	spans->spans[spans->count].end = end;
+	spans->count++;
+
+	return TRUE;
+}
+
+/******************************************************************************
+ *
+ * JSet_Find()
+ *
+ * Reads the whole file and records the span of each value at the path, in
+ * the file order. A container is passed at once, the spans never overlap.
+ * Returns JSONTokenEnd, or JSONTokenError when the file is not valid.
+ *
+ ******************************************************************************/
+
+JSON_Token JSet_Find(CONST_STRPTR fileName, JPath * path, JSET_SPANS * spans)
+{
+	JSON_Reader * reader;
+	JPath_Walker * walker;
+	JSON_Token token = JSONTokenError;
+	ULONG start;
+	int match;
+
+	if (!(reader = json_reader_new_file(NULL, fileName)))
+	{
+		printf("Cannot open the FILE.\n");
+		return token;
+	}
+
+	if (!(walker = JPath_WalkerNew(reader, path)))
+	{
+		outOfMemory = TRUE;
+	}
+	else
+	{
+		while ((token = JPath_Next(walker, &match)) != JSONTokenError && token != JSONTokenEnd)
+		{
+			if (!match)
+				continue;
+
+			start = (ULONG)json_reader_token_offset(reader);
+
+			if ((token == JSONTokenBeginObject || token == JSONTokenBeginArray) &&
+				JPath_Skip(walker) == JSONTokenError)
+			{
+				token = JSONTokenError;
+				break;
+			}
+
+			if (!JSet_AddSpan(spans, start, (ULONG)json_reader_offset(reader)))
+			{
+				token = JSONTokenError;
+				break;
+			}
+		}
+
+		if (token == JSONTokenError && !outOfMemory)
+			printf("The FILE is not valid at offset %lu.\n", (ULONG)json_reader_offset(reader));
+
+		JPath_WalkerFree(walker);
+	}
+
+	json_reader_free(reader);
+
+	return token;
+}
+
+/******************************************************************************
+ *
+ * JSet_Splice()
+ *
+ * Copies the file, writing the text over each span.
+ *
+ ******************************************************************************/
+
+BOOL JSet_Splice(CONST_STRPTR fromName, CONST_STRPTR toName, JSET_SPANS * spans, CONST_STRPTR text)
+{
+	FILE * from, * to;
+	STRPTR buffer;
+	ULONG position = 0, length, textLength = strlen(text), i = 0;
+	size_t count;
+	BOOL result = FALSE;
+
+	if (!(buffer = (STRPTR)malloc(COPY_BUFFER_SIZE)))
+	{
+		outOfMemory = TRUE;
+		return FALSE;
+	}
+
+	if (!(from = fopen(fromName, "rb")))
+	{
+		free(buffer);
+		return FALSE;
+	}
+
+	if (!(to = fopen(toName, "wb")))
+	{
+		fclose(from);
+		free(buffer);
+		return FALSE;
+	}
+
+	for (;;)
+	{
+		// Up to the next span, or the end of the file
+
+		length = i < spans->count ? spans->spans[i].start - position : COPY_BUFFER_SIZE;
+
+		if (length > COPY_BUFFER_SIZE)
+			length = COPY_BUFFER_SIZE;
+
+		if (length > 0)
+		{
+			count = fread(buffer, 1, length, from);
+
+			if (count > 0 && fwrite(buffer, 1, count, to) != count)
+				break;
+
+			position += count;
+
+			if (count < length)
+			{
+				result = (BOOL)(i == spans->count && !ferror(from));
+				break;
+			}
+
+			continue;
+		}
+
+		// At the span, the new text instead of the old
+
+		if (fwrite(text, 1, textLength, to) != textLength ||
+			fseek(from, spans->spans[i].end, SEEK_SET) != 0)
+			break;
+
+		position = spans->spans[i++].end;
+	}
+
+	if (fclose(to) != 0)
+		result = FALSE;
+
+	fclose(from);
+	free(buffer);
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * JSet_Replace()
+ *
+ * Puts the new file in place of the old one. The DOS does not rename over
+ * an existing file : the old one is kept aside until the new one has its
+ * name, so that one of them is always there.
+ *
+ ******************************************************************************/
+
+BOOL JSet_Replace(CONST_STRPTR fileName, CONST_STRPTR tempName)
+{
+	UBYTE oldName[256];
+
+	if (rename(tempName, fileName) == 0)
+		return TRUE;
+
+	if (strlen(fileName) + sizeof(".old") > sizeof(oldName))
+		return FALSE;
+
+	strcpy(oldName, fileName);
+	strcat(oldName, ".old");
+
+	remove(oldName);
+
+	if (rename(fileName, oldName) != 0)
+		return FALSE;
+
+	if (rename(tempName, fileName) != 0)
+	{
+		rename(oldName, fileName);
+		return FALSE;
+	}
+
+	remove(oldName);
+
+	return TRUE;
+}
+
+/******************************************************************************
+ *
+ * JSet_SetValue()
+ *
+ ******************************************************************************/
+
+ULONG JSet_SetValue(LONG * opts)
+{
+	ULONG result = RETURN_ERROR;
+	CONST_STRPTR fileName = (STRPTR)opts[OPT_FILE];
+	UBYTE tempName[256];
+	JSET_SPANS spans;
+	STRPTR text;
+	JPath path;
+
+	if (!JPath_Parse(&path, (STRPTR)opts[OPT_PATH]))
+	{
+		printf("The PATH is not valid.\n");
+		return RETURN_FAIL;
+	}
+
+	if (!(text = JSet_ValueText(opts)))
+	{
+		printf("The VALUE is not valid JSON, use STRING to set it as a string.\n");
+		JPath_Free(&path);
+		return RETURN_FAIL;
+	}
+
+	memset(&spans, 0, sizeof(spans));
+
+	if (JSet_Find(fileName, &path, &spans) == JSONTokenError)
+	{
+		if (outOfMemory)
+			printf("Not enough memory.\n");
+	}
+	else if (spans.count == 0)
+	{
+		result = RETURN_WARN;
+	}
+	else if (opts[OPT_TO])
+	{
+		if (JSet_Splice(fileName, (STRPTR)opts[OPT_TO], &spans, text))
+			result = RETURN_OK;
+		else
+			printf(outOfMemory ? "Not enough memory.\n" : "Cannot write the TO file.\n");
+	}
+	else if (strlen(fileName) + sizeof(".jset") > sizeof(tempName))
+	{
+		printf("The FILE name is too long.\n");
+	}
+	else
+	{
+		// Written next to the file, so that it may be renamed over it
+
+		strcpy(tempName, fileName);
+		strcat(tempName, ".jset");
+
+		if (!JSet_Splice(fileName, tempName, &spans, text))
+		{
+			printf(outOfMemory ? "Not enough memory.\n" : "Cannot write the file.\n");
+			remove(tempName);
+		}
+		else if (!JSet_Replace(fileName, tempName))
+		{
+			printf("Cannot replace the file, the result is in %s.\n", tempName);
+		}
+		else
+		{
+			result = RETURN_OK;
+		}
+	}
+
+	free(spans.spans);
+	json_free_serialized_string(text);
+	JPath_Free(&path);
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * Entry point
+ *
+ ******************************************************************************/
+
+ULONG main(ULONG argc, STRPTR * argv)
+{
+	ULONG result = RETURN_FAIL;
+	LONG opts[OPT_COUNT];
+	struct RDArgs * rdArgs;
+
+	memset(opts, 0, sizeof(opts));
+
+	if (rdArgs = (struct RDArgs *)ReadArgs(TEMPLATE, opts, NULL))
+	{
+		if (opts[OPT_HELP])
+		{
+			JSet_PrintHelp();
+
+			result = RETURN_OK;
+		}
+		else
+		{
+			result = JSet_SetValue(opts);
+		}
+
+		FreeArgs(rdArgs);
+	}
+	else
+	{
+		JSet_PrintHelp();
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * End of file
+ *
+ ******************************************************************************/
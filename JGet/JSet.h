@@ -0,0 +1,18 @@
+#ifndef __JSET_H__
+#define __JSET_H__
+
+#include <exec/types.h>
+#include <exec/execbase.h>
+
+#define APP_AUTHOR "Philippe CARPENTIER"
+#define APP_VERSTRING "$VER: JSet 1.0 (16.3.2025) [SAS/C 6.59] " APP_AUTHOR
+#define APP_HELPSTRING ("Usage: JSet <jsonfile> <jsonpath> <value> [TO <file>] [<options>]\n\n"\
+	" HELP            This help.\n"\
+	" FILE            The JSON file to modify (mandatory).\n"\
+	" PATH            The path of the JSON value to set (mandatory).\n"\
+	" VALUE           The new JSON value (mandatory).\n"\
+	" STRING          Set the VALUE as a string (optional).\n"\
+	" TO              The file to write, the FILE itself if omitted (optional).\n\n"\
+	"See JSet.help for a more detailed documentation.\n")
+
+#endif /* __JSET_H__ */
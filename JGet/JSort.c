@@ -0,0 +1,856 @@
+/******************************************************************************
+ *
+ * File:    JSort.c
+ * Short:   Sorts the elements of a JSON array by one of their values
+ * Author:  Philippe CARPENTIER, aka flype.
+ * Date:    March 2025
+ *
+ * The file is not parsed. It is read once with a JSON_Reader, keeping for
+ * each element of the array only its sort key and where it starts and ends
+ * in the file. These records are sorted by runs that fit the MEMORY given,
+ * the runs written to temporary files and merged, MERGE_WAYS at a time.
+ * The elements are then copied from the file in the sorted order, the rest
+ * of the file left as it is.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dos/dos.h>
+#include <exec/exec.h>
+#include <proto/dos.h>
+#include <proto/exec.h>
+
+#include "JSort.h"
+#include "JPath.h"
+#include "parson.h"
+
+/******************************************************************************
+ *
+ * DEFINES
+ *
+ ******************************************************************************/
+
+#define TEMPLATE "H=HELP/S,F=FILE/A,BY/A,TO/K,R=REVERSE/S,M=MEMORY/K/N,TEMP/K"
+
+#define DEFAULT_MEMORY   256     // KB for the records of a run
+#define MIN_MEMORY       4
+#define DEFAULT_TEMP     "T:"
+#define MERGE_WAYS       16      // Runs merged at once
+#define COPY_BUFFER_SIZE 32768
+#define SEPARATOR_SIZE   64
+
+#define NO_OFFSET        ((ULONG)~0UL)
+
+typedef enum {
+	OPT_HELP,
+	OPT_FILE,
+	OPT_BY,
+	OPT_TO,
+	OPT_REVERSE,
+	OPT_MEMORY,
+	OPT_TEMP,
+	OPT_COUNT
+} OPT_ARGS;
+
+typedef enum {
+	KEY_NULL,     // Also a missing key, or an object or array
+	KEY_FALSE,
+	KEY_TRUE,
+	KEY_NUMBER,
+	KEY_STRING
+} KEY_TYPE;
+
+typedef struct {
+	ULONG  start;    // Span of the element in the file
+	ULONG  end;
+	ULONG  length;   // Of the string
+	UBYTE  type;
+	double number;
+	STRPTR string;
+} JSORT_RECORD;
+
+typedef struct {
+	FILE *       file;
+	JSORT_RECORD record;
+	STRPTR       string;
+	ULONG        capacity;
+	BOOL         more;      // The record is the next one of the run
+} JSORT_RUN;
+
+typedef struct {
+	LONG *         opts;
+
+	// The records of the current run, from the start of the memory,
+	// and their strings, from its end
+
+	UBYTE *        memory;
+	ULONG          size;
+	JSORT_RECORD * records;
+	ULONG          count;
+	ULONG          stringsSize;
+
+	ULONG *        runs;       // Numbers of the run files
+	ULONG          runCount;
+	ULONG          runCapacity;
+	ULONG          runNumber;
+
+	ULONG          arrayStart; // Of the '[' of the array
+	ULONG          firstStart; // Of its first element
+	ULONG          lastEnd;    // After its last element
+
+	FILE *         input;
+	FILE *         output;
+	UBYTE *        buffer;
+	UBYTE          separator[SEPARATOR_SIZE + 1];
+	ULONG          separatorLength;
+	ULONG          written;
+	BOOL           failed;
+} JSORT;
+
+/******************************************************************************
+ *
+ * GLOBALS
+ *
+ ******************************************************************************/
+
+static BOOL   outOfMemory = FALSE;
+static BOOL   reverse = FALSE;
+static STRPTR verstring = APP_VERSTRING;
+
+extern struct ExecBase * SysBase;
+extern struct DosLibrary * DOSBase;
+
+/******************************************************************************
+ *
+ * PROTOTYPES
+ *
+ ******************************************************************************/
+
+VOID JSort_PrintHelp     (VOID);
+int JSort_Compare        (const VOID * a, const VOID * b);
+VOID JSort_RunName       (JSORT * sort, ULONG number, STRPTR name);
+BOOL JSort_AddRun        (JSORT * sort, ULONG * number);
+BOOL JSort_WriteRecord   (FILE * file, JSORT_RECORD * record);
+BOOL JSort_ReadRecord    (JSORT * sort, JSORT_RUN * run);
+BOOL JSort_Spill         (JSORT * sort);
+BOOL JSort_Reserve       (JSORT * sort, ULONG length);
+BOOL JSort_SetKey        (JSORT * sort, JSORT_RECORD * record, JSON_Reader * reader, JSON_Token token);
+JSON_Token JSort_Scan    (JSORT * sort, JPath * path, ULONG elementDepth);
+BOOL JSort_Copy          (JSORT * sort, ULONG start, ULONG end);
+BOOL JSort_WriteElement  (JSORT * sort, JSORT_RECORD * record);
+BOOL JSort_Merge         (JSORT * sort, ULONG first, ULONG count, FILE * to);
+BOOL JSort_Output        (JSORT * sort);
+ULONG JSort_SortFile     (LONG * opts);
+
+/******************************************************************************
+ *
+ * JSort_PrintHelp()
+ *
+ ******************************************************************************/
+
+VOID JSort_PrintHelp(VOID)
+{
+	printf(APP_HELPSTRING);
+}
+
+/******************************************************************************
+ *
+ * JSort_Compare()
+ *
+ * null, false, true, then the numbers and the strings. The elements with
+ * the same key keep their order in the file, even in REVERSE.
+ *
+ ******************************************************************************/
+
+int JSort_Compare(const VOID * a, const VOID * b)
+{
+	const JSORT_RECORD * ra = (const JSORT_RECORD *)a;
+	const JSORT_RECORD * rb = (const JSORT_RECORD *)b;
+	int result = 0;
+
+	if (ra->type != rb->type)
+	{
+		result = ra->type < rb->type ? -1 : 1;
+	}
+	else if (ra->type == KEY_NUMBER)
+	{
+		result = ra->number < rb->number ? -1 : (ra->number > rb->number ? 1 : 0);
+	}
+	else if (ra->type == KEY_STRING)
+	{
+		result = memcmp(ra->string, rb->string, ra->length < rb->length ? ra->length : rb->length);
+
+		if (result == 0 && ra->length != rb->length)
+			result = ra->length < rb->length ? -1 : 1;
+	}
+
+	if (reverse)
+		result = -result;
+
+	if (result == 0)
+		result = ra->start < rb->start ? -1 : 1;
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * JSort_RunName(), JSort_AddRun()
+ *
+ ******************************************************************************/
+
+VOID JSort_RunName(JSORT * sort, ULONG number, STRPTR name)
+{
+	CONST_STRPTR temp = sort->opts[OPT_TEMP] ? (STRPTR)sort->opts[OPT_TEMP] : DEFAULT_TEMP;
+	ULONG length = strlen(temp);
+
+	sprintf(name, "%s%sJSort.%lu", temp,
+		(length == 0 || temp[length - 1] == ':' || temp[length - 1] == '/') ? "" : "/", number);
+}
+
+BOOL JSort_AddRun(JSORT * sort, ULONG * number)
+{
+	ULONG * runs;
+	ULONG capacity;
+
+	if (sort->runCount == sort->runCapacity)
+	{
+		capacity = sort->runCapacity ? sort->runCapacity * 2 : 16;
+
+		if (!(runs = (ULONG *)realloc(sort->runs, capacity * sizeof(ULONG))))
+		{
+			outOfMemory = TRUE;
+			return FALSE;
+		}
+
+		sort->runs = runs;
+		sort->runCapacity = capacity;
+	}
+
+	*number = sort->runs[sort->runCount++] = ++sort->runNumber;
+
+	return TRUE;
+}
+
+/******************************************************************************
+ *
+ * JSort_WriteRecord(), JSort_ReadRecord()
+ *
+ * A record, then the bytes of its string. The run files are only read back
+ * by the same program, the records are written as they are in memory.
+ *
+ ******************************************************************************/
+
+BOOL JSort_WriteRecord(FILE * file, JSORT_RECORD * record)
+{
+	if (fwrite(record, sizeof(JSORT_RECORD), 1, file) != 1)
+		return FALSE;
+
+	if (record->type == KEY_STRING && record->length > 0)
+		return (BOOL)(fwrite(record->string, 1, record->length, file) == record->length);
+
+	return TRUE;
+}
+
+BOOL JSort_ReadRecord(JSORT * sort, JSORT_RUN * run)
+{
+	STRPTR string;
+
+	run->more = FALSE;
+
+	if (fread(&run->record, sizeof(JSORT_RECORD), 1, run->file) != 1)
+	{
+		if (ferror(run->file))
+			sort->failed = TRUE;
+
+		return FALSE;
+	}
+
+	if (run->record.type == KEY_STRING)
+	{
+		if (run->record.length > run->capacity)
+		{
+			if (!(string = (STRPTR)realloc(run->string, run->record.length)))
+			{
+				outOfMemory = sort->failed = TRUE;
+				return FALSE;
+			}
+
+			run->string = string;
+			run->capacity = run->record.length;
+		}
+
+		if (fread(run->string, 1, run->record.length, run->file) != run->record.length)
+		{
+			sort->failed = TRUE;
+			return FALSE;
+		}
+	}
+
+	run->record.string = run->string;
+	run->more = TRUE;
+
+	return TRUE;
+}
+
+/******************************************************************************
+ *
+ * JSort_Spill()
+ *
+ * Sorts the records in memory and writes them to a new run file.
+ *
+ ******************************************************************************/
+
+BOOL JSort_Spill(JSORT * sort)
+{
+	UBYTE name[256];
+	FILE * file;
+	ULONG number, i;
+	BOOL result = TRUE;
+
+	if (!JSort_AddRun(sort, &number))
+		return FALSE;
+
+	qsort(sort->records, sort->count, sizeof(JSORT_RECORD), JSort_Compare);
+
+	JSort_RunName(sort, number, name);
+
+	if (!(file = fopen(name, "wb")))
+	{
+		printf("Cannot write the temporary file %s.\n", name);
+		return FALSE;
+	}
+
+	for (i = 0; i < sort->count && result; i++)
+		result = JSort_WriteRecord(file, &sort->records[i]);
+
+	if (fclose(file) != 0 || !result)
+	{
+		printf("Cannot write the temporary file %s.\n", name);
+		return FALSE;
+	}
+
+	sort->count = 0;
+	sort->stringsSize = 0;
+
+	return TRUE;
+}
+
+/******************************************************************************
+ *
+ * JSort_Reserve()
+ *
+ * Makes room for one more record and a string of length bytes, spilling
+ * the run when the memory is full.
+ *
+ ******************************************************************************/
+
+BOOL JSort_Reserve(JSORT * sort, ULONG length)
+{
+	ULONG used = (sort->count + 1) * sizeof(JSORT_RECORD) + sort->stringsSize;
+
+	if (length <= sort->size && used <= sort->size - length)
+		return TRUE;
+
+	if (sort->count > 0 && !JSort_Spill(sort))
+		return FALSE;
+
+	if (length > sort->size - sizeof(JSORT_RECORD))
+	{
+		printf("The MEMORY is too small for a key of %lu bytes.\n", length);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/******************************************************************************
+ *
+ * JSort_SetKey()
+ *
+ ******************************************************************************/
+
+BOOL JSort_SetKey(JSORT * sort, JSORT_RECORD * record, JSON_Reader * reader, JSON_Token token)
+{
+	switch (token)
+	{
+	case JSONTokenString:
+		record->length = json_reader_string_len(reader);
+
+		if (!JSort_Reserve(sort, record->length))
+			return FALSE;
+
+		sort->stringsSize += record->length;
+		record->string = sort->memory + sort->size - sort->stringsSize;
+		memcpy(record->string, json_reader_string(reader), record->length);
+		record->type = KEY_STRING;
+		break;
+	case JSONTokenNumber:
+		record->number = json_reader_number(reader);
+		record->type = KEY_NUMBER;
+		break;
+	case JSONTokenBoolean:
+		record->type = json_reader_boolean(reader) ? KEY_TRUE : KEY_FALSE;
+		break;
+	default:
+		record->type = KEY_NULL;
+		break;
+	}
+
+	return TRUE;
+}
+
+/******************************************************************************
+ *
+ * JSort_Scan()
+ *
+ * Reads the file up to the end of the array, the elements being the values
+ * at the first elementDepth segments of the path and their keys the values
+ * at the whole path. Returns JSONTokenEnd, or JSONTokenError.
+ *
+ ******************************************************************************/
+
+JSON_Token JSort_Scan(JSORT * sort, JPath * path, ULONG elementDepth)
+{
+	JSON_Reader * reader;
+	JPath_Walker * walker;
+	JSON_Token token = JSONTokenError;
+	JSORT_RECORD current;
+	BOOL inElement = FALSE, hasKey = FALSE;
+	int match;
+
+	if (!(reader = json_reader_new_file(NULL, (STRPTR)sort->opts[OPT_FILE])))
+	{
+		printf("Cannot open the FILE.\n");
+		return token;
+	}
+
+	if (!(walker = JPath_WalkerNew(reader, path)))
+	{
+		outOfMemory = TRUE;
+		json_reader_free(reader);
+		return token;
+	}
+
+	while ((token = JPath_Next(walker, &match)) != JSONTokenError && token != JSONTokenEnd)
+	{
+		if (sort->arrayStart == NO_OFFSET)
+		{
+			if (token == JSONTokenBeginArray && JPath_Prefix(walker, elementDepth - 1))
+				sort->arrayStart = (ULONG)json_reader_token_offset(reader);
+
+			continue;
+		}
+
+		// Once the array is closed, the rest of the file is copied as it is
+
+		if (json_reader_depth(reader) < elementDepth)
+		{
+			token = JSONTokenEnd;
+			break;
+		}
+
+		if (JPath_Prefix(walker, elementDepth))
+		{
+			if (!JSort_Reserve(sort, 0))
+				break;
+
+			memset(&current, 0, sizeof(current));
+			current.start = (ULONG)json_reader_token_offset(reader);
+
+			if (sort->firstStart == NO_OFFSET)
+				sort->firstStart = current.start;
+
+			inElement = TRUE;
+			hasKey = FALSE;
+		}
+
+		if (match && inElement && !hasKey)
+		{
+			if (!JSort_SetKey(sort, &current, reader, token))
+				break;
+
+			hasKey = TRUE;
+		}
+
+		if (inElement && json_reader_depth(reader) == elementDepth)
+		{
+			current.end = sort->lastEnd = (ULONG)json_reader_offset(reader);
+			sort->records[sort->count++] = current;
+			inElement = FALSE;
+		}
+	}
+
+	if (token == JSONTokenError && !outOfMemory && !sort->failed && json_reader_next(reader) == JSONTokenError)
+		printf("The FILE is not valid at offset %lu.\n", (ULONG)json_reader_offset(reader));
+
+	if (token != JSONTokenError && token != JSONTokenEnd)
+		token = JSONTokenError;
+
+	JPath_WalkerFree(walker);
+	json_reader_free(reader);
+
+	return token;
+}
+
+/******************************************************************************
+ *
+ * JSort_Copy()
+ *
+ * Copies the bytes of the file from start to end, or to the end of the file
+ * when end is NO_OFFSET.
+ *
+ ******************************************************************************/
+
+BOOL JSort_Copy(JSORT * sort, ULONG start, ULONG end)
+{
+	ULONG length;
+	size_t count;
+
+	if (fseek(sort->input, start, SEEK_SET) != 0)
+		return FALSE;
+
+	while (start < end)
+	{
+		length = end - start < COPY_BUFFER_SIZE ? end - start : COPY_BUFFER_SIZE;
+		count = fread(sort->buffer, 1, length, sort->input);
+
+		if (count > 0 && fwrite(sort->buffer, 1, count, sort->output) != count)
+			return FALSE;
+
+		start += count;
+
+		if (count < length)
+			return (BOOL)(end == NO_OFFSET && !ferror(sort->input));
+	}
+
+	return TRUE;
+}
+
+/******************************************************************************
+ *
+ * JSort_WriteElement()
+ *
+ ******************************************************************************/
+
+BOOL JSort_WriteElement(JSORT * sort, JSORT_RECORD * record)
+{
+	if (sort->written++ > 0 &&
+		fwrite(sort->separator, 1, sort->separatorLength, sort->output) != sort->separatorLength)
+		return FALSE;
+
+	return JSort_Copy(sort, record->start, record->end);
+}
+
+/******************************************************************************
+ *
+ * JSort_Merge()
+ *
+ * Merges count runs from the first one into a new run, or into the output
+ * when to is NULL, then deletes them.
+ *
+ ******************************************************************************/
+
+BOOL JSort_Merge(JSORT * sort, ULONG first, ULONG count, FILE * to)
+{
+	JSORT_RUN runs[MERGE_WAYS];
+	JSORT_RUN * best;
+	UBYTE name[256];
+	ULONG i, active = 0;
+	BOOL result = TRUE;
+
+	memset(runs, 0, sizeof(runs));
+
+	for (i = 0; i < count && result; i++)
+	{
+		JSort_RunName(sort, sort->runs[first + i], name);
+
+		if (!(runs[i].file = fopen(name, "rb")))
+		{
+			printf("Cannot read the temporary file %s.\n", name);
+			result = FALSE;
+		}
+		else if (JSort_ReadRecord(sort, &runs[i]))
+		{
+			active++;
+		}
+		else
+		{
+			result = !sort->failed;
+		}
+	}
+
+	while (active > 0 && result)
+	{
+		// The smallest record of the runs, MERGE_WAYS being a few
+
+		for (best = NULL, i = 0; i < count; i++)
+		{
+			if (runs[i].more && (!best || JSort_Compare(&runs[i].record, &best->record) < 0))
+				best = &runs[i];
+		}
+
+		if (!best)
+			break;
+
+		if (to)
+			result = JSort_WriteRecord(to, &best->record);
+		else
+			result = JSort_WriteElement(sort, &best->record);
+
+		if (result && !JSort_ReadRecord(sort, best))
+		{
+			result = !sort->failed;
+			active--;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (runs[i].file)
+			fclose(runs[i].file);
+
+		free(runs[i].string);
+
+		JSort_RunName(sort, sort->runs[first + i], name);
+		remove(name);
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * JSort_Output()
+ *
+ * Writes the file with the elements of the array in the sorted order, the
+ * whitespace before the first element repeated after each comma.
+ *
+ ******************************************************************************/
+
+BOOL JSort_Output(JSORT * sort)
+{
+	UBYTE name[256];
+	FILE * file;
+	ULONG first = 0, number, length, i;
+	BOOL result;
+
+	if (sort->firstStart == NO_OFFSET)
+		return JSort_Copy(sort, 0, NO_OFFSET);
+
+	sort->separator[0] = ',';
+	sort->separatorLength = 1;
+	length = sort->firstStart - sort->arrayStart - 1;
+
+	if (length <= SEPARATOR_SIZE)
+	{
+		if (fseek(sort->input, sort->arrayStart + 1, SEEK_SET) != 0 ||
+			fread(&sort->separator[1], 1, length, sort->input) != length)
+			return FALSE;
+
+		sort->separatorLength += length;
+	}
+
+	if (!JSort_Copy(sort, 0, sort->firstStart))
+		return FALSE;
+
+	if (sort->runCount == 0)
+	{
+		// All in memory, no run files
+
+		qsort(sort->records, sort->count, sizeof(JSORT_RECORD), JSort_Compare);
+
+		for (i = 0; i < sort->count; i++)
+		{
+			if (!JSort_WriteElement(sort, &sort->records[i]))
+				return FALSE;
+		}
+	}
+	else
+	{
+		if (sort->count > 0 && !JSort_Spill(sort))
+			return FALSE;
+
+		while (sort->runCount - first > MERGE_WAYS)
+		{
+			if (!JSort_AddRun(sort, &number))
+				return FALSE;
+
+			JSort_RunName(sort, number, name);
+
+			if (!(file = fopen(name, "wb")))
+			{
+				printf("Cannot write the temporary file %s.\n", name);
+				return FALSE;
+			}
+
+			result = JSort_Merge(sort, first, MERGE_WAYS, file);
+
+			if (fclose(file) != 0 || !result)
+				return FALSE;
+
+			first += MERGE_WAYS;
+		}
+
+		if (!JSort_Merge(sort, first, sort->runCount - first, NULL))
+			return FALSE;
+	}
+
+	return JSort_Copy(sort, sort->lastEnd, NO_OFFSET);
+}
+
+/******************************************************************************
+ *
+ * JSort_SortFile()
+ *
+ ******************************************************************************/
+
+ULONG JSort_SortFile(LONG * opts)
+{
+	ULONG result = RETURN_ERROR, i;
+	CONST_STRPTR by = (STRPTR)opts[OPT_BY];
+	CONST_STRPTR keyText;
+	UBYTE name[256];
+	JPath path, keyPath;
+	JSORT sort;
+
+	// The elements are at the path up to its last [*], the key is the rest
+
+	keyText = strstr(by, "[*]");
+
+	if (!keyText || (keyText = strstr(keyText + 3, "[*]")) != NULL)
+	{
+		printf("The BY path must have one [*], for the elements of the array.\n");
+		return RETURN_FAIL;
+	}
+
+	keyText = strstr(by, "[*]") + 3;
+
+	if (opts[OPT_TEMP] && strlen((STRPTR)opts[OPT_TEMP]) > 200)
+	{
+		printf("The TEMP path is too long.\n");
+		return RETURN_FAIL;
+	}
+
+	if (!JPath_Parse(&path, by))
+	{
+		printf("The BY path is not valid.\n");
+		return RETURN_FAIL;
+	}
+
+	if (!JPath_Parse(&keyPath, keyText))
+	{
+		printf("The BY path is not valid.\n");
+		JPath_Free(&path);
+		return RETURN_FAIL;
+	}
+
+	memset(&sort, 0, sizeof(sort));
+
+	sort.opts = opts;
+	sort.size = (opts[OPT_MEMORY] ? *(LONG *)opts[OPT_MEMORY] : DEFAULT_MEMORY) * 1024;
+	sort.arrayStart = sort.firstStart = sort.lastEnd = NO_OFFSET;
+	reverse = (BOOL)opts[OPT_REVERSE];
+
+	if (sort.size < MIN_MEMORY * 1024)
+		sort.size = MIN_MEMORY * 1024;
+
+	sort.records = (JSORT_RECORD *)(sort.memory = (UBYTE *)malloc(sort.size));
+
+	if (!sort.memory || !(sort.buffer = (UBYTE *)malloc(COPY_BUFFER_SIZE)))
+	{
+		printf("Not enough memory.\n");
+	}
+	else if (JSort_Scan(&sort, &path, path.count - keyPath.count) == JSONTokenError)
+	{
+		if (outOfMemory)
+			printf("Not enough memory.\n");
+	}
+	else if (sort.arrayStart == NO_OFFSET)
+	{
+		result = RETURN_WARN;
+	}
+	else if (!(sort.input = fopen((STRPTR)opts[OPT_FILE], "rb")))
+	{
+		printf("Cannot open the FILE.\n");
+	}
+	else if (!(sort.output = opts[OPT_TO] ? fopen((STRPTR)opts[OPT_TO], "wb") : stdout))
+	{
+		printf("Cannot open the TO file.\n");
+	}
+	else
+	{
+		if (JSort_Output(&sort) && fflush(sort.output) == 0)
+			result = RETURN_OK;
+		else
+			printf(outOfMemory ? "\nNot enough memory.\n" : "\nCannot write the result.\n");
+	}
+
+	if (sort.output && sort.output != stdout && fclose(sort.output) != 0)
+		result = RETURN_ERROR;
+
+	if (sort.input)
+		fclose(sort.input);
+
+	// The run files left by a failure
+
+	for (i = 0; i < sort.runCount; i++)
+	{
+		JSort_RunName(&sort, sort.runs[i], name);
+		remove(name);
+	}
+
+	free(sort.runs);
+	free(sort.buffer);
+	free(sort.memory);
+	JPath_Free(&keyPath);
+	JPath_Free(&path);
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * Entry point
+ *
+ ******************************************************************************/
+
+ULONG main(ULONG argc, STRPTR * argv)
+{
+	ULONG result = RETURN_FAIL;
+	LONG opts[OPT_COUNT];
+	struct RDArgs * rdArgs;
+
+	memset(opts, 0, sizeof(opts));
+
+	if (rdArgs = (struct RDArgs *)ReadArgs(TEMPLATE, opts, NULL))
+	{
+		if (opts[OPT_HELP])
+		{
+			JSort_PrintHelp();
+
+			result = RETURN_OK;
+		}
+		else
+		{
+			result = JSort_SortFile(opts);
+		}
+
+		FreeArgs(rdArgs);
+	}
+	else
+	{
+		JSort_PrintHelp();
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * End of file
+ *
+ ******************************************************************************/
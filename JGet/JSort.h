@@ -0,0 +1,19 @@
+#ifndef __JSORT_H__
+#define __JSORT_H__
+
+#include <exec/types.h>
+#include <exec/execbase.h>
+
+#define APP_AUTHOR "Philippe CARPENTIER"
+#define APP_VERSTRING "$VER: JSort 1.0 (16.3.2025) [SAS/C 6.59] " APP_AUTHOR
+#define APP_HELPSTRING ("Usage: JSort <jsonfile> <jsonpath> [TO <file>] [<options>]\n\n"\
+	" HELP            This help.\n"\
+	" FILE            The JSON file to sort (mandatory).\n"\
+	" BY              The path of the sort key, e.g. .items[*].date (mandatory).\n"\
+	" TO              The file to write, the console if omitted (optional).\n"\
+	" REVERSE         Sort in descending order (optional).\n"\
+	" MEMORY          The KB to sort in memory at once, 256 by default (optional).\n"\
+	" TEMP            Where to write the temporary files, T: by default (optional).\n\n"\
+	"See JSort.help for a more detailed documentation.\n")
+
+#endif /* __JSORT_H__ */
@@ -0,0 +1,126 @@
+/******************************************************************************
+ *
+ * File:    JTimer.c
+ * Short:   High resolution timer for JGet and JBench
+ * Author:  Philippe CARPENTIER, aka flype.
+ * Date:    March 2025
+ *
+ ******************************************************************************/
+
+#if !defined(__SASC) && !defined(AMIGA) && !defined(__amigaos__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L /* clock_gettime() */
+#endif
+
+#include "JTimer.h"
+
+#ifdef JTIMER_AMIGA
+
+#include <exec/exec.h>
+#include <devices/timer.h>
+#include <proto/exec.h>
+#include <proto/timer.h>
+
+/******************************************************************************
+ *
+ * AmigaOS : timer.device EClock
+ *
+ ******************************************************************************/
+
+struct Device * TimerBase = NULL;
+
+static struct MsgPort     * timerPort = NULL;
+static struct timerequest * timerReq  = NULL;
+static double               timerFreq = 0.0;
+
+int JTimer_Open(void)
+{
+	struct EClockVal eclock;
+
+	if (TimerBase)
+		return 1;
+
+	if (timerPort = CreateMsgPort())
+	{
+		if (timerReq = (struct timerequest *)CreateIORequest(timerPort, sizeof(struct timerequest)))
+		{
+			if (OpenDevice(TIMERNAME, UNIT_ECLOCK, (struct IORequest *)timerReq, 0) == 0)
+			{
+				TimerBase = timerReq->tr_node.io_Device;
+				timerFreq = (double)ReadEClock(&eclock);
+				return 1;
+			}
+
+			DeleteIORequest(timerReq);
+			timerReq = NULL;
+		}
+
+		DeleteMsgPort(timerPort);
+		timerPort = NULL;
+	}
+
+	return 0;
+}
+
+void JTimer_Close(void)
+{
+	if (TimerBase)
+	{
+		CloseDevice((struct IORequest *)timerReq);
+		DeleteIORequest(timerReq);
+		DeleteMsgPort(timerPort);
+		TimerBase = NULL;
+		timerReq  = NULL;
+		timerPort = NULL;
+	}
+}
+
+double JTimer_Seconds(void)
+{
+	struct EClockVal eclock;
+
+	if (!TimerBase)
+		return 0.0;
+
+	ReadEClock(&eclock);
+
+	return ((double)eclock.ev_hi * 4294967296.0 + (double)eclock.ev_lo) / timerFreq;
+}
+
+#else
+
+#include <time.h>
+
+/******************************************************************************
+ *
+ * POSIX : clock_gettime(CLOCK_MONOTONIC), clock() as a last resort
+ *
+ ******************************************************************************/
+
+int JTimer_Open(void)
+{
+	return 1;
+}
+
+void JTimer_Close(void)
+{
+}
+
+double JTimer_Seconds(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+#endif
+
+	return (double)clock() / (double)CLOCKS_PER_SEC;
+}
+
+#endif /* JTIMER_AMIGA */
+
+/******************************************************************************
+ *
+ * End of file
+ *
+ ******************************************************************************/
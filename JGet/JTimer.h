@@ -0,0 +1,28 @@
+/******************************************************************************
+ *
+ * File:    JTimer.h
+ * Short:   High resolution timer for JGet and JBench
+ * Author:  Philippe CARPENTIER, aka flype.
+ * Date:    March 2025
+ *
+ ******************************************************************************/
+
+#ifndef __JTIMER_H__
+#define __JTIMER_H__
+
+/******************************************************************************
+ *
+ * The timer reads the timer.device EClock on AmigaOS and clock_gettime()
+ * on POSIX hosts. JTimer_Open() must be called once before JTimer_Seconds().
+ *
+ ******************************************************************************/
+
+#if defined(__SASC) || defined(AMIGA) || defined(__amigaos__)
+#define JTIMER_AMIGA
+#endif
+
+int    JTimer_Open    (void);
+void   JTimer_Close   (void);
+double JTimer_Seconds (void);
+
+#endif /* __JTIMER_H__ */
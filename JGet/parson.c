@@ -43,6 +43,11 @@
 
 #define STARTING_CAPACITY 16
 #define MAX_NESTING       2048
+#define MEMO_MIN_LENGTH   128   /* serialized documents kept by serialization_cache */
+#define MEMO_MAX_LENGTH   16384 /* larger containers are kept as runs of members */
+#define MEMO_RUN_LENGTH   4096  /* a run is closed once this long */
+#define MEMO_ALL          ((size_t)-1)
+#define MEMO_NONE         ((size_t)-1)
 
 #define FLOAT_FORMAT "%1.17g" /* do not increase precision without incresing NUM_BUF_SIZE */
 #define NUM_BUF_SIZE 64 /* double printed with "%1.17g" shouldn't be longer than 25 bytes so let's be paranoid and use 64 */
@@ -50,7 +55,9 @@
 #define SIZEOF_TOKEN(a)       (sizeof(a) - 1)
 #define SKIP_CHAR(str)        ((*str)++)
 #define SKIP_WHITESPACES(str) while (isspace((unsigned char)(**str))) { SKIP_CHAR(str); }
+#define IS_NUMBER_START(c)    ((c) == '-' || ((c) >= '0' && (c) <= '9'))
 #define MAX(a, b)             ((a) > (b) ? (a) : (b))
+#define MIN(a, b)             ((a) < (b) ? (a) : (b))
 
 #undef malloc
 #undef free
@@ -61,18 +68,90 @@
 #define IS_NUMBER_INVALID(x) (((x) * 0.0) != 0.0)
 #endif
 
-static JSON_Malloc_Function parson_malloc = malloc;
-static JSON_Free_Function parson_free = free;
+/* Parser and serializer settings. Everything that used to be a process-wide static lives
+   here, so that documents can be parsed and serialized on several threads with different
+   settings. The default context backs the original API. */
+struct json_context_t {
+    JSON_Malloc_Function         malloc_fun;
+    JSON_Free_Function           free_fun;
+    JSON_Context_Malloc_Function malloc_ex_fun; /* used instead of malloc_fun when set */
+    JSON_Context_Free_Function   free_ex_fun;
+    void                        *allocator_data;
+    int                          escape_slashes;
+    int                          with_comments;
+    int                          validate_utf8;
+    int                          number_lexemes;
+    int                          number_arrays;
+    int                          prescan;
+    int                          serialization_cache;
+    size_t                       max_nesting;
+    int                          use_scratch; /* never set on the shared default context */
+    char                        *scratch;
+    size_t                       scratch_capacity;
+#ifdef PARSON_STATS
+    int                          stats_enabled;
+    JSON_Stats                   stats;
+#endif
+};
+
+static JSON_Context parson_default_context = {
+    malloc, free, NULL, NULL, NULL, 1, 0, 0, 0, 1, 0, 0, MAX_NESTING, 0, NULL, 0
+#ifdef PARSON_STATS
+    , 0, {{0}, {0}, {0}, 0, 0, {0}}
+#endif
+};
 
-static int parson_escape_slashes = 1;
+#define PARSON_CONTEXT(ctx) ((ctx) != NULL ? (ctx) : &parson_default_context)
+#define CONTAINER_CONTEXT(container) ((container) != NULL ? (container)->ctx : &parson_default_context)
+
+/* Allocation statistics, compiled in with -DPARSON_STATS and switched on at run time
+   with json_set_stats_enabled(). When compiled in, every block carries a small header
+   holding its size and category so that frees can be accounted for. */
+#ifdef PARSON_STATS
+typedef union json_stats_header {
+    struct {
+        size_t size;
+        int    category;
+    } info;
+    double align_double;
+    void  *align_pointer;
+} JSON_Stats_Header;
+
+static void * parson_stats_malloc(JSON_Context *ctx, int category, size_t size);
+static void   parson_stats_free(JSON_Context *ctx, void *ptr);
+
+#define PARSON_MALLOC(ctx, category, size) parson_stats_malloc((ctx), (category), (size))
+#define PARSON_FREE(ctx, ptr)              parson_stats_free((ctx), (ptr))
+#else
+#define PARSON_MALLOC(ctx, category, size) ((void)(category), parson_malloc((ctx), (size)))
+#define PARSON_FREE(ctx, ptr)              parson_free((ctx), (ptr))
+#endif
 
 #define IS_CONT(b) (((unsigned char)(b) & 0xC0) == 0x80) /* is utf-8 continuation byte */
 
+/* SWAR tests on a machine word, exact as to whether any byte matches */
+#define SWAR_ONES           (~0UL / 0xFF)
+#define SWAR_HAS_ZERO(x)    (((x) - SWAR_ONES) & ~(x) & (SWAR_ONES * 0x80))
+#define SWAR_HAS_BYTE(x, b) SWAR_HAS_ZERO((x) ^ (SWAR_ONES * (b)))
+#define SWAR_HAS_LESS(x, n) (((x) - SWAR_ONES * (n)) & ~(x) & (SWAR_ONES * 0x80))
+#define SWAR_HAS_HIGH(x)    ((x) & (SWAR_ONES * 0x80))
+
 typedef struct json_string {
     char *chars;
     size_t length;
 } JSON_String;
 
+/* Numbers parsed with number_lexemes set keep their source text and are only converted by
+   json_value_get_number, unless it is one of the lenient forms such as "1.", see is_json_number.
+   They have internal types, json_value_get_type reports JSONNumber. */
+#define JSONNumberText  (JSONBoolean + 1) /* text in value.string */
+#define JSONNumberShort (JSONBoolean + 2) /* text in value.lexeme, when it fits */
+
+/* The text of a container also depends on the escaping of slashes and, when pretty, on its level */
+#define MEMO_KEY(ctx, is_pretty, level) (((is_pretty) ? (int)(level) * 2 + 2 : 0) + ((ctx)->escape_slashes ? 1 : 0))
+
+#define IS_NUMBER_ARRAY(value) ((value)->type == JSONArray && (value)->value.array->numbers != NULL)
+
 /* Type definitions */
 typedef union json_value_value {
     JSON_String  string;
@@ -81,84 +160,385 @@ typedef union json_value_value {
     JSON_Array  *array;
     int          boolean;
     int          null;
+    char         lexeme[sizeof(JSON_String)];
 } JSON_Value_Value;
 
 struct json_value_t {
+    JSON_Context    *ctx;    /* allocator the value and its contents were created with */
     JSON_Value      *parent;
     JSON_Value_Type  type;
     JSON_Value_Value value;
 };
 
+/* Text of the members [first, first + count) of a container, from the indentation of the
+   first one to the end of the last one, the separators between them included */
+typedef struct json_memo_run {
+    size_t  first;
+    size_t  count;
+    char   *text;
+    size_t  length;
+} JSON_Memo_Run;
+
+typedef struct json_memo_runs {
+    JSON_Memo_Run *runs;   /* ordered by first, not overlapping */
+    size_t         count;
+    size_t         capacity;
+} JSON_Memo_Runs;
+
+/* Serialized text of a container, kept when the context has serialization_cache set and
+   dropped by any change to the container or to its members, see json_value_invalidate */
+typedef struct json_memo {
+    char           *text[2];   /* compact, pretty */
+    size_t          length[2];
+    int             key[2];    /* what else the text and the runs depend on, see MEMO_KEY */
+    JSON_Memo_Runs  runs[2];   /* containers over MEMO_MAX_LENGTH */
+} JSON_Memo;
+
 struct json_object_t {
+    JSON_Context *ctx;
     JSON_Value  *wrapping_value;
+    JSON_Object *shared;     /* the object this one reads in place, see json_object_share */
+    JSON_Value **sharers;    /* the deep copies doing so with this one */
+    size_t       sharer_count;
     char       **names;
     JSON_Value **values;
     size_t       count;
     size_t       capacity;
+    JSON_Memo   *memo;
 };
 
 struct json_array_t {
+    JSON_Context *ctx;
     JSON_Value  *wrapping_value;
+    JSON_Array  *shared;
+    JSON_Value **sharers;
+    size_t       sharer_count;
     JSON_Value **items;
+    double      *numbers;    /* arrays of numbers only, see json_array_add_number */
     size_t       count;
     size_t       capacity;
+    JSON_Memo   *memo;
+};
+
+/* Explicit stack of the parser, serializer and deep copy, one frame per nesting level, so that
+   they do not recurse and use the same amount of C stack whatever the depth. The first frames
+   are part of the structure, deeper documents move them to the heap. */
+#define WALK_STACK_INLINE 16
+
+typedef struct json_walk_frame {
+    const JSON_Value *value;  /* container being read */
+    JSON_Value       *target; /* container being filled */
+    char             *key;    /* name of the member being parsed */
+    size_t            index;  /* next member */
+    size_t            offset; /* where the container's text starts, serializer */
+    size_t            member; /* where the member being written starts, or MEMO_NONE, serializer */
+    size_t            run_first;  /* first member of the run being formed, or MEMO_NONE */
+    size_t            run_offset; /* where its text starts */
+    size_t            pending;    /* where the container's runs start in the pending ones */
+} JSON_Walk_Frame;
+
+typedef struct json_walk_stack {
+    JSON_Context    *ctx;
+    JSON_Walk_Frame *frames;
+    size_t           count;
+    size_t           capacity;
+    JSON_Walk_Frame  inline_frames[WALK_STACK_INLINE];
+} JSON_Walk_Stack;
+
+/* Concatenated documents, parsed one after the other with the same walk stack */
+struct json_documents_t {
+    JSON_Context    *ctx;
+    char            *input;  /* private copy (file contents, comments stripped), or NULL */
+    const char      *start;
+    const char      *next;   /* where the next document starts */
+    int              failed;
+    JSON_Walk_Stack  stack;
+};
+
+/* Streaming writer, the state of each open container is a byte of levels[] */
+#define WRITER_BUFFER_SIZE 4096
+#define WRITER_CHUNK       (WRITER_BUFFER_SIZE / 8) /* string bytes escaped at once */
+
+#define WRITER_OBJECT  1 /* the container is an object */
+#define WRITER_MEMBERS 2 /* it has members, the next one needs a comma */
+#define WRITER_KEY     4 /* a key was written, its value comes next */
+
+struct json_writer_t {
+    JSON_Context        *ctx;
+    JSON_Writer_Function write_fun;
+    void                *sink_data;
+    FILE                *fp;        /* opened by json_writer_new_file */
+    int                  is_pretty;
+    int                  failed;    /* the sink or an allocation failed, final */
+    int                  done;      /* the top level value is complete */
+    unsigned char       *levels;
+    size_t               depth;
+    size_t               capacity;
+    char                *buffer;    /* WRITER_BUFFER_SIZE bytes after the structure */
+    size_t               length;
+    unsigned char        inline_levels[WALK_STACK_INLINE];
+};
+
+/* Streaming reader, the same levels as the writer, READER_KEY once the key's ':' is read */
+#define READER_BUFFER_SIZE 4096
+
+struct json_reader_t {
+    JSON_Context        *ctx;
+    JSON_Reader_Function read_fun;
+    void                *source_data;
+    FILE                *fp;        /* opened by json_reader_new_file */
+    int                  failed;    /* invalid input, the source or an allocation failed, final */
+    int                  done;      /* the top level value is complete */
+    int                  at_end;    /* the source has nothing more */
+    unsigned char       *levels;
+    size_t               depth;
+    size_t               capacity;
+    char                *text;      /* key, string or number of the last token, \0 terminated */
+    size_t               text_length;
+    size_t               text_capacity;
+    int                  boolean;
+    char                *buffer;    /* READER_BUFFER_SIZE bytes after the structure */
+    size_t               position;
+    size_t               length;
+    size_t               offset;    /* of buffer[0] in the input */
+    size_t               token_offset; /* where the last token starts */
+    unsigned char        inline_levels[WALK_STACK_INLINE];
 };
 
 /* Various */
-static char * read_file(const char *filename);
+static void * parson_malloc(JSON_Context *ctx, size_t size);
+static void   parson_free(JSON_Context *ctx, void *ptr);
+static char * read_file(JSON_Context *ctx, const char *filename);
 static void   remove_comments(char *string, const char *start_token, const char *end_token);
-static char * parson_strndup(const char *string, size_t n);
-static char * parson_strdup(const char *string);
+static char * parson_strndup(JSON_Context *ctx, const char *string, size_t n, int category);
+static char * parson_strdup(JSON_Context *ctx, const char *string, int category);
 static int    hex_char_to_int(char c);
 static int    parse_utf16_hex(const char *string, unsigned int *result);
 static int    num_bytes_in_utf8_sequence(unsigned char c);
-static int    verify_utf8_sequence(const unsigned char *string, int *len);
+static int    verify_utf8_sequence(const unsigned char *string, size_t available, int *len);
 static int    is_valid_utf8(const char *string, size_t string_len);
 static int    is_decimal(const char *string, size_t length);
+static size_t scan_number(const char *string);
+static int    is_json_number(const char *string, size_t length);
+static void   walk_stack_init(JSON_Walk_Stack *stack, JSON_Context *ctx);
+static JSON_Walk_Frame * walk_stack_push(JSON_Walk_Stack *stack);
+static void   walk_stack_free(JSON_Walk_Stack *stack);
 
 /* JSON Object */
-static JSON_Object * json_object_init(JSON_Value *wrapping_value);
+static JSON_Object * json_object_init(JSON_Context *ctx, JSON_Value *wrapping_value);
 static JSON_Status   json_object_add(JSON_Object *object, const char *name, JSON_Value *value);
 static JSON_Status   json_object_addn(JSON_Object *object, const char *name, size_t name_len, JSON_Value *value);
+static JSON_Status   json_object_push(JSON_Object *object, const char *name, size_t name_len, JSON_Value *value);
 static JSON_Status   json_object_resize(JSON_Object *object, size_t new_capacity);
 static JSON_Value  * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len);
 static JSON_Status   json_object_remove_internal(JSON_Object *object, const char *name, int free_value);
 static JSON_Status   json_object_dotremove_internal(JSON_Object *object, const char *name, int free_value);
 static void          json_object_free(JSON_Object *object);
+static JSON_Value *  json_object_share(JSON_Object *object);
+static JSON_Object * json_object_copy_level(JSON_Object *object, JSON_Value *value);
+static JSON_Object * json_object_unshare(JSON_Value *value);
+static int           json_object_release(JSON_Value *value);
+static JSON_Status   json_object_detach(JSON_Object *object);
 
 /* JSON Array */
-static JSON_Array * json_array_init(JSON_Value *wrapping_value);
+static JSON_Array * json_array_init(JSON_Context *ctx, JSON_Value *wrapping_value);
 static JSON_Status  json_array_add(JSON_Array *array, JSON_Value *value);
+static JSON_Status  json_array_add_number(JSON_Array *array, double number);
+static int          json_array_keeps_numbers(const JSON_Array *array);
+static JSON_Status  json_array_reserve_numbers(JSON_Array *array, size_t count);
+static JSON_Status  json_array_copy_numbers(JSON_Array *copy, const JSON_Array *array);
+static JSON_Value * json_array_number_value(JSON_Array *array, size_t index);
+static JSON_Status  json_array_box(JSON_Array *array);
 static JSON_Status  json_array_resize(JSON_Array *array, size_t new_capacity);
 static void         json_array_free(JSON_Array *array);
+static JSON_Value * json_array_share(JSON_Array *array);
+static JSON_Array * json_array_copy_level(JSON_Array *array, JSON_Value *value);
+static JSON_Array * json_array_unshare(JSON_Value *value);
+static int          json_array_release(JSON_Value *value);
+static JSON_Status  json_array_detach(JSON_Array *array);
 
 /* JSON Value */
-static JSON_Value * json_value_init_string_no_copy(char *string, size_t length);
+static JSON_Value * json_value_init_string_no_copy(JSON_Context *ctx, char *string, size_t length);
+static JSON_Value * json_value_init_number_lexeme(JSON_Context *ctx, const char *lexeme, size_t length);
+static JSON_Status  json_sharers_add(JSON_Context *ctx, int category, JSON_Value ***sharers, size_t *count, JSON_Value *value);
+static void         json_sharers_remove(JSON_Context *ctx, JSON_Value ***sharers, size_t *count, const JSON_Value *value);
+static size_t       json_value_sharer_count(const JSON_Value *value);
+static JSON_Status  json_value_detach(JSON_Value *value);
+static JSON_Memo ** json_value_memo(const JSON_Value *value);
+static void         json_value_invalidate(JSON_Value *value, size_t index);
+static void         json_value_memo_removed(JSON_Value *value, size_t index);
+static size_t       json_value_member_index(const JSON_Value *value, const JSON_Value *member);
+static void         json_value_memoize(const JSON_Value *value, const char *text, size_t length, int is_pretty, int key);
+static void         json_value_memoize_runs(const JSON_Value *value, const JSON_Memo_Runs *pending, size_t first, int is_pretty, int key);
+static const JSON_Memo_Run * json_value_memo_run(const JSON_Value *value, int is_pretty, int key, size_t index);
+static void         json_value_forget_members(const JSON_Value *value, size_t first, size_t count);
+static JSON_Memo *  json_memo_new(JSON_Context *ctx);
+static size_t       json_memo_find_run(const JSON_Memo_Runs *runs, size_t index);
+static void         json_memo_drop_run(JSON_Context *ctx, JSON_Memo_Runs *runs, size_t index);
+static void         json_memo_pend(JSON_Context *ctx, JSON_Memo_Runs *pending, size_t first, size_t count, const char *text, size_t length);
+static void         json_memo_free(JSON_Context *ctx, JSON_Memo *memo);
+static size_t       json_value_child_count(const JSON_Value *value);
+static JSON_Value * json_value_copy_node(JSON_Context *ctx, const JSON_Value *value);
+static JSON_Value * json_value_copy_tree(JSON_Context *ctx, const JSON_Value *value);
 static const JSON_String * json_value_get_string_desc(const JSON_Value *value);
 
 /* Parser */
 static JSON_Status  skip_quotes(const char **string);
 static int          parse_utf16(const char **unprocessed, char **processed);
-static char *       process_string(const char *input, size_t input_len, size_t *output_len);
-static char *       get_quoted_string(const char **string, size_t *output_string_len);
-static JSON_Value * parse_object_value(const char **string, size_t nesting);
-static JSON_Value * parse_array_value(const char **string, size_t nesting);
-static JSON_Value * parse_string_value(const char **string);
-static JSON_Value * parse_boolean_value(const char **string);
-static JSON_Value * parse_number_value(const char **string);
-static JSON_Value * parse_null_value(const char **string);
-static JSON_Value * parse_value(const char **string, size_t nesting);
+static char *       process_string(JSON_Context *ctx, const char *input, size_t input_len, size_t *output_len, int category);
+static char *       get_quoted_string(JSON_Context *ctx, const char **string, size_t *output_string_len, int category);
+static char *       parse_key(JSON_Context *ctx, const char **string);
+static JSON_Value * parse_string_value(JSON_Context *ctx, const char **string);
+static JSON_Value * parse_boolean_value(JSON_Context *ctx, const char **string);
+static JSON_Status  parse_number(const char **string, double *number);
+static JSON_Value * parse_number_value(JSON_Context *ctx, const char **string);
+static JSON_Value * parse_null_value(JSON_Context *ctx, const char **string);
+static const char * skip_string(const char *string);
+static size_t *     prescan_counts(JSON_Context *ctx, const char *string, size_t *containers);
+static JSON_Value * parse_value(JSON_Context *ctx, const char **string, JSON_Walk_Stack *stack);
+static JSON_Value * parse_string(JSON_Context *ctx, const char *string);
+static JSON_Value * parse_string_with_comments(JSON_Context *ctx, const char *string);
+static JSON_Value * parse_file(JSON_Context *ctx, const char *filename, int with_comments);
+static JSON_Documents * documents_init(JSON_Context *ctx, const char *string, char *input);
 
 /* Serialization */
-static int    json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int level, int is_pretty, char *num_buf);
-static int    json_serialize_string(const char *string, size_t len, char *buf);
-static int    append_indent(char *buf, int level);
-static int    append_string(char *buf, const char *string);
+static size_t json_serialize_value(const JSON_Context *ctx, const JSON_Value *value, char *buf, int is_pretty, size_t level, char *num_buf);
+static void   json_serialize_member_end(JSON_Context *ctx, JSON_Walk_Frame *frame, JSON_Memo_Runs *pending, const char *buf, size_t written_total, size_t count, size_t separator);
+static size_t json_serialize_string(const JSON_Context *ctx, const char *string, size_t len, char *buf);
+static size_t json_serialize_chars(const JSON_Context *ctx, const char *string, size_t len, char *buf);
+static size_t append_indent(char *buf, size_t level);
+static size_t append_string(char *buf, const char *string);
+static size_t append_number(char *buf, char *num_buf, double number);
+
+/* Streaming writer */
+static JSON_Status writer_fail(JSON_Writer *writer);
+static JSON_Status writer_flush(JSON_Writer *writer);
+static char *      writer_reserve(JSON_Writer *writer, size_t size);
+static JSON_Status writer_put(JSON_Writer *writer, const char *data, size_t length);
+static JSON_Status writer_newline(JSON_Writer *writer);
+static JSON_Status writer_begin(JSON_Writer *writer, int is_key);
+static void        writer_end(JSON_Writer *writer);
+static JSON_Status writer_open(JSON_Writer *writer, int is_object);
+static JSON_Status writer_close(JSON_Writer *writer, int is_object);
+static JSON_Status writer_string(JSON_Writer *writer, const char *string, size_t length);
+static JSON_Status writer_file_write(void *sink_data, const char *data, size_t length);
+
+/* Streaming reader */
+static JSON_Token  reader_fail(JSON_Reader *reader);
+static int         reader_fill(JSON_Reader *reader);
+static int         reader_peek(JSON_Reader *reader);
+static JSON_Status reader_put(JSON_Reader *reader, const char *data, size_t length);
+static JSON_Status reader_unescape(JSON_Reader *reader);
+static JSON_Status reader_string(JSON_Reader *reader);
+static JSON_Status reader_word(JSON_Reader *reader, int is_number);
+static JSON_Token  reader_value(JSON_Reader *reader);
+static size_t      reader_file_read(void *source_data, char *buffer, size_t size);
+
+/* Allocation */
+static void * parson_malloc(JSON_Context *ctx, size_t size) {
+    if (ctx->malloc_ex_fun != NULL) {
+        return ctx->malloc_ex_fun(ctx->allocator_data, size);
+    }
+    return ctx->malloc_fun(size);
+}
+
+static void parson_free(JSON_Context *ctx, void *ptr) {
+    if (ctx->free_ex_fun != NULL) {
+        ctx->free_ex_fun(ctx->allocator_data, ptr);
+    } else {
+        ctx->free_fun(ptr);
+    }
+}
+
+/* Allocation statistics */
+#ifdef PARSON_STATS
+static void * parson_stats_malloc(JSON_Context *ctx, int category, size_t size) {
+    JSON_Stats_Header *header = (JSON_Stats_Header*)parson_malloc(ctx, sizeof(JSON_Stats_Header) + size);
+    JSON_Stats *stats = &ctx->stats;
+    size_t bucket = 0;
+    if (header == NULL) {
+        return NULL;
+    }
+    header->info.size = size;
+    header->info.category = category;
+    if (ctx->stats_enabled) {
+        stats->allocations[category] += 1;
+        stats->bytes[category] += size;
+        stats->live_bytes += size;
+        if (stats->live_bytes > stats->peak_live_bytes) {
+            stats->peak_live_bytes = stats->live_bytes;
+        }
+        while (bucket < JSON_STATS_BUCKETS - 1 && size > ((size_t)8 << bucket)) {
+            bucket++;
+        }
+        stats->histogram[bucket] += 1;
+    }
+    return header + 1;
+}
+
+static void parson_stats_free(JSON_Context *ctx, void *ptr) {
+    JSON_Stats_Header *header = NULL;
+    if (ptr == NULL) {
+        return;
+    }
+    header = (JSON_Stats_Header*)ptr - 1;
+    if (ctx->stats_enabled) {
+        ctx->stats.frees[header->info.category] += 1;
+        /* blocks allocated before statistics were enabled are not in live_bytes */
+        ctx->stats.live_bytes -= MIN(header->info.size, ctx->stats.live_bytes);
+    }
+    parson_free(ctx, header);
+}
+#endif
+
+/* Walk stack */
+static void walk_stack_init(JSON_Walk_Stack *stack, JSON_Context *ctx) {
+    stack->ctx = ctx;
+    stack->frames = stack->inline_frames;
+    stack->count = 0;
+    stack->capacity = WALK_STACK_INLINE;
+}
+
+/* Returns the new top frame, cleared, or NULL when out of memory */
+static JSON_Walk_Frame * walk_stack_push(JSON_Walk_Stack *stack) {
+    JSON_Walk_Frame *new_frames = NULL, *frame = NULL;
+    if (stack->count >= stack->capacity) {
+        new_frames = (JSON_Walk_Frame*)PARSON_MALLOC(stack->ctx, JSONAllocStack, stack->capacity * 2 * sizeof(JSON_Walk_Frame));
+        if (new_frames == NULL) {
+            return NULL;
+        }
+        memcpy(new_frames, stack->frames, stack->count * sizeof(JSON_Walk_Frame));
+        if (stack->frames != stack->inline_frames) {
+            PARSON_FREE(stack->ctx, stack->frames);
+        }
+        stack->frames = new_frames;
+        stack->capacity *= 2;
+    }
+    frame = &stack->frames[stack->count];
+    stack->count++;
+    frame->value = NULL;
+    frame->target = NULL;
+    frame->key = NULL;
+    frame->index = 0;
+    frame->offset = 0;
+    frame->member = MEMO_NONE;
+    frame->run_first = MEMO_NONE;
+    frame->run_offset = 0;
+    frame->pending = 0;
+    return frame;
+}
+
+static void walk_stack_free(JSON_Walk_Stack *stack) {
+    if (stack->frames != stack->inline_frames) {
+        PARSON_FREE(stack->ctx, stack->frames);
+    }
+    walk_stack_init(stack, stack->ctx);
+}
 
 /* Various */
-static char * parson_strndup(const char *string, size_t n) {
+static char * parson_strndup(JSON_Context *ctx, const char *string, size_t n, int category) {
     /* We expect the caller has validated that 'n' fits within the input buffer. */
-    char *output_string = (char*)parson_malloc(n + 1);
+    char *output_string = (char*)PARSON_MALLOC(ctx, category, n + 1);
     if (!output_string) {
         return NULL;
     }
@@ -167,8 +547,8 @@ static char * parson_strndup(const char *string, size_t n) {
     return output_string;
 }
 
-static char * parson_strdup(const char *string) {
-    return parson_strndup(string, strlen(string));
+static char * parson_strdup(JSON_Context *ctx, const char *string, int category) {
+    return parson_strndup(ctx, string, strlen(string), category);
 }
 
 static int hex_char_to_int(char c) {
@@ -213,11 +593,13 @@ static int num_bytes_in_utf8_sequence(unsigned char c) {
     return 0; /* won't happen */
 }
 
-static int verify_utf8_sequence(const unsigned char *string, int *len) {
+static int verify_utf8_sequence(const unsigned char *string, size_t available, int *len) {
     unsigned int cp = 0;
     *len = num_bytes_in_utf8_sequence(string[0]);
 
-    if (*len == 1) {
+    if ((size_t)*len > available) { /* truncated sequence */
+        return 0;
+    } else if (*len == 1) {
         cp = string[0];
     } else if (*len == 2 && IS_CONT(string[1])) {
         cp = string[0] & 0x1F;
@@ -255,14 +637,30 @@ static int verify_utf8_sequence(const unsigned char *string, int *len) {
     return 1;
 }
 
+/* ASCII, the bulk of most JSON, is checked four words per step once the pointer is aligned
+   (16 bytes on the 68k), other bytes one sequence at a time. */
 static int is_valid_utf8(const char *string, size_t string_len) {
+    const unsigned char *ptr = (const unsigned char*)string;
+    const unsigned char *end = ptr + string_len;
+    const unsigned long *words = NULL;
     int len = 0;
-    const char *string_end =  string + string_len;
-    while (string < string_end) {
-        if (!verify_utf8_sequence((const unsigned char*)string, &len)) {
+    while (ptr < end) {
+        if (*ptr < 0x80) {
+            ptr++;
+            if (((size_t)ptr % sizeof(unsigned long)) == 0) {
+                words = (const unsigned long*)ptr;
+                while ((size_t)(end - ptr) >= 4 * sizeof(unsigned long) &&
+                       !SWAR_HAS_HIGH(words[0] | words[1] | words[2] | words[3])) {
+                    words += 4;
+                    ptr += 4 * sizeof(unsigned long);
+                }
+            }
+            continue;
+        }
+        if (!verify_utf8_sequence(ptr, end - ptr, &len)) {
             return 0;
         }
-        string += len;
+        ptr += len;
     }
     return 1;
 }
@@ -282,7 +680,91 @@ static int is_decimal(const char *string, size_t length) {
     return 1;
 }
 
-static char * read_file(const char * filename) {
+/* Length of the number at the start of string, 0 if there is none. Accepts what strtod and
+   is_decimal let through: no leading zeros nor hexadecimal, but "1." and "-.5". */
+static size_t scan_number(const char *string) {
+    const char *ptr = string, *exponent = NULL;
+    int leading_zero = 0;
+    if (*ptr == '-') {
+        ptr++;
+    }
+    if (*ptr == '0') {
+        leading_zero = 1;
+        ptr++;
+    } else if (*ptr >= '1' && *ptr <= '9') {
+        while (*ptr >= '0' && *ptr <= '9') {
+            ptr++;
+        }
+    } else if (*ptr != '.' || ptr[1] < '0' || ptr[1] > '9') {
+        return 0;
+    }
+    if (*ptr == '.') {
+        leading_zero = 0;
+        ptr++;
+        while (*ptr >= '0' && *ptr <= '9') {
+            ptr++;
+        }
+    } else if (leading_zero && ((*ptr >= '0' && *ptr <= '9') || *ptr == 'x' || *ptr == 'X')) {
+        return 0;
+    }
+    if (*ptr == 'e' || *ptr == 'E') {
+        exponent = ptr + 1;
+        if (*exponent == '+' || *exponent == '-') {
+            exponent++;
+        }
+        if (*exponent >= '0' && *exponent <= '9') { /* otherwise the number ends before the 'e' */
+            if (leading_zero) {
+                return 0;
+            }
+            ptr = exponent;
+            while (*ptr >= '0' && *ptr <= '9') {
+                ptr++;
+            }
+        }
+    }
+    return (size_t)(ptr - string);
+}
+
+/* Whether a number found by scan_number follows the grammar of RFC 8259, so that its text can
+   be written back as it is: digits on both sides of the point, no "1." nor "-.5" */
+static int is_json_number(const char *string, size_t length) {
+    const char *ptr = string, *end = string + length;
+    if (ptr < end && *ptr == '-') {
+        ptr++;
+    }
+    if (ptr == end || *ptr < '0' || *ptr > '9') {
+        return 0;
+    }
+    if (*ptr++ != '0') {
+        while (ptr < end && *ptr >= '0' && *ptr <= '9') {
+            ptr++;
+        }
+    }
+    if (ptr < end && *ptr == '.') {
+        ptr++;
+        if (ptr == end || *ptr < '0' || *ptr > '9') {
+            return 0;
+        }
+        while (ptr < end && *ptr >= '0' && *ptr <= '9') {
+            ptr++;
+        }
+    }
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+        ptr++;
+        if (ptr < end && (*ptr == '+' || *ptr == '-')) {
+            ptr++;
+        }
+        if (ptr == end || *ptr < '0' || *ptr > '9') {
+            return 0;
+        }
+        while (ptr < end && *ptr >= '0' && *ptr <= '9') {
+            ptr++;
+        }
+    }
+    return ptr == end;
+}
+
+static char * read_file(JSON_Context *ctx, const char * filename) {
     FILE *fp = fopen(filename, "r");
     size_t size_to_read = 0;
     size_t size_read = 0;
@@ -299,7 +781,7 @@ static char * read_file(const char * filename) {
     }
     size_to_read = pos;
     rewind(fp);
-    file_contents = (char*)parson_malloc(sizeof(char) * (size_to_read + 1));
+    file_contents = (char*)PARSON_MALLOC(ctx, JSONAllocInput, sizeof(char) * (size_to_read + 1));
     if (!file_contents) {
         fclose(fp);
         return NULL;
@@ -307,7 +789,7 @@ static char * read_file(const char * filename) {
     size_read = fread(file_contents, 1, size_to_read, fp);
     if (size_read == 0 || ferror(fp)) {
         fclose(fp);
-        parson_free(file_contents);
+        PARSON_FREE(ctx, file_contents);
         return NULL;
     }
     fclose(fp);
@@ -351,16 +833,21 @@ static void remove_comments(char *string, const char *start_token, const char *e
 }
 
 /* JSON Object */
-static JSON_Object * json_object_init(JSON_Value *wrapping_value) {
-    JSON_Object *new_obj = (JSON_Object*)parson_malloc(sizeof(JSON_Object));
+static JSON_Object * json_object_init(JSON_Context *ctx, JSON_Value *wrapping_value) {
+    JSON_Object *new_obj = (JSON_Object*)PARSON_MALLOC(ctx, JSONAllocObject, sizeof(JSON_Object));
     if (new_obj == NULL) {
         return NULL;
     }
+    new_obj->ctx = ctx;
     new_obj->wrapping_value = wrapping_value;
+    new_obj->shared = NULL;
+    new_obj->sharers = NULL;
+    new_obj->sharer_count = 0;
     new_obj->names = (char**)NULL;
     new_obj->values = (JSON_Value**)NULL;
     new_obj->capacity = 0;
     new_obj->count = 0;
+    new_obj->memo = NULL;
     return new_obj;
 }
 
@@ -372,13 +859,19 @@ static JSON_Status json_object_add(JSON_Object *object, const char *name, JSON_V
 }
 
 static JSON_Status json_object_addn(JSON_Object *object, const char *name, size_t name_len, JSON_Value *value) {
-    size_t index = 0;
     if (object == NULL || name == NULL || value == NULL) {
         return JSONFailure;
     }
     if (json_object_getn_value(object, name, name_len) != NULL) {
         return JSONFailure;
     }
+    return json_object_push(object, name, name_len, value);
+}
+
+/* Adds a member whose name is known not to be in the object yet */
+static JSON_Status json_object_push(JSON_Object *object, const char *name, size_t name_len, JSON_Value *value) {
+    size_t index = 0;
+    json_value_invalidate(object->wrapping_value, object->count);
     if (object->count >= object->capacity) {
         size_t new_capacity = MAX(object->capacity * 2, STARTING_CAPACITY);
         if (json_object_resize(object, new_capacity) == JSONFailure) {
@@ -386,7 +879,7 @@ static JSON_Status json_object_addn(JSON_Object *object, const char *name, size_
         }
     }
     index = object->count;
-    object->names[index] = parson_strndup(name, name_len);
+    object->names[index] = parson_strndup(object->ctx, name, name_len, JSONAllocKey);
     if (object->names[index] == NULL) {
         return JSONFailure;
     }
@@ -405,21 +898,21 @@ static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity)
         new_capacity == 0) {
             return JSONFailure; /* Shouldn't happen */
     }
-    temp_names = (char**)parson_malloc(new_capacity * sizeof(char*));
+    temp_names = (char**)PARSON_MALLOC(object->ctx, JSONAllocObject, new_capacity * sizeof(char*));
     if (temp_names == NULL) {
         return JSONFailure;
     }
-    temp_values = (JSON_Value**)parson_malloc(new_capacity * sizeof(JSON_Value*));
+    temp_values = (JSON_Value**)PARSON_MALLOC(object->ctx, JSONAllocObject, new_capacity * sizeof(JSON_Value*));
     if (temp_values == NULL) {
-        parson_free(temp_names);
+        PARSON_FREE(object->ctx, temp_names);
         return JSONFailure;
     }
     if (object->names != NULL && object->values != NULL && object->count > 0) {
         memcpy(temp_names, object->names, object->count * sizeof(char*));
         memcpy(temp_values, object->values, object->count * sizeof(JSON_Value*));
     }
-    parson_free(object->names);
-    parson_free(object->values);
+    PARSON_FREE(object->ctx, object->names);
+    PARSON_FREE(object->ctx, object->values);
     object->names = temp_names;
     object->values = temp_values;
     object->capacity = new_capacity;
@@ -448,7 +941,9 @@ static JSON_Status json_object_remove_internal(JSON_Object *object, const char *
     last_item_index = json_object_get_count(object) - 1;
     for (i = 0; i < json_object_get_count(object); i++) {
         if (strcmp(object->names[i], name) == 0) {
-            parson_free(object->names[i]);
+            json_value_invalidate(object->wrapping_value, i);
+            json_value_invalidate(object->wrapping_value, last_item_index); /* moved into its place */
+            PARSON_FREE(object->ctx, object->names[i]);
             if (free_value) {
                 json_value_free(object->values[i]);
             }
@@ -467,6 +962,9 @@ static JSON_Status json_object_dotremove_internal(JSON_Object *object, const cha
     JSON_Value *temp_value = NULL;
     JSON_Object *temp_object = NULL;
     const char *dot_pos = strchr(name, '.');
+    if (json_object_detach(object) == JSONFailure) { /* each level, the path is copied */
+        return JSONFailure;
+    }
     if (dot_pos == NULL) {
         return json_object_remove_internal(object, name, free_value);
     }
@@ -479,30 +977,168 @@ static JSON_Status json_object_dotremove_internal(JSON_Object *object, const cha
 }
 
 static void json_object_free(JSON_Object *object) {
+    JSON_Context *ctx = object->ctx;
     size_t i;
     for (i = 0; i < object->count; i++) {
-        parson_free(object->names[i]);
+        PARSON_FREE(ctx, object->names[i]);
         json_value_free(object->values[i]);
     }
-    parson_free(object->names);
-    parson_free(object->values);
-    parson_free(object);
+    PARSON_FREE(ctx, object->names);
+    PARSON_FREE(ctx, object->values);
+    PARSON_FREE(ctx, object->sharers);
+    json_memo_free(ctx, object->memo);
+    PARSON_FREE(ctx, object);
+}
+
+/* Copy-on-write. json_value_deep_copy gives the copy a JSON_Object of its own that reads the
+   names and values of the original in place: it is shared, and the original's object lists
+   the copy among its sharers. Reading either side never allocates nor changes anything, and
+   the members read through the copy are those of the original. The first change to the copy's
+   object duplicates one level (names, strings and numbers) while the containers below are
+   shared in turn. Before the original's object changes, json_value_detach does the same for
+   its sharers and for those of the containers above it: pointers taken on either side stay
+   valid and never see the changes of the other side. */
+static JSON_Value * json_object_share(JSON_Object *object) {
+    JSON_Value *copy = NULL;
+    JSON_Object *view = NULL;
+    if (object->shared != NULL) { /* a copy of a copy reads the same names and values */
+        object = object->shared;
+    }
+    copy = json_value_init_object_ex(object->ctx);
+    if (copy == NULL) {
+        return NULL;
+    }
+    if (json_sharers_add(object->ctx, JSONAllocObject, &object->sharers, &object->sharer_count, copy) == JSONFailure) {
+        json_value_free(copy);
+        return NULL;
+    }
+    view = copy->value.object;
+    view->shared = object;
+    view->names = object->names;
+    view->values = object->values;
+    view->count = object->count;
+    view->capacity = object->count;
+    return copy;
+}
+
+static JSON_Object * json_object_copy_level(JSON_Object *object, JSON_Value *value) {
+    JSON_Object *copy = NULL;
+    JSON_Value *temp_value = NULL;
+    size_t i;
+    copy = json_object_init(object->ctx, value);
+    if (copy == NULL) {
+        return NULL;
+    }
+    if (object->count > 0 && json_object_resize(copy, object->count) == JSONFailure) {
+        json_object_free(copy);
+        return NULL;
+    }
+    for (i = 0; i < object->count; i++) { /* names are unique already, skip json_object_add */
+        copy->names[i] = parson_strdup(object->ctx, object->names[i], JSONAllocKey);
+        if (copy->names[i] == NULL) {
+            json_object_free(copy);
+            return NULL;
+        }
+        temp_value = json_value_deep_copy_ex(object->ctx, object->values[i]);
+        if (temp_value == NULL) {
+            PARSON_FREE(object->ctx, copy->names[i]);
+            json_object_free(copy);
+            return NULL;
+        }
+        temp_value->parent = value;
+        copy->values[i] = temp_value;
+        copy->count++;
+    }
+    return copy;
+}
+
+/* Gives the object of a copy the level it reads in place. The object keeps its address and its
+   memo, the text being the same. */
+static JSON_Object * json_object_unshare(JSON_Value *value) {
+    JSON_Object *object = value->value.object, *copy = NULL;
+    if (object->shared == NULL) {
+        return object;
+    }
+    copy = json_object_copy_level(object->shared, value);
+    if (copy == NULL) {
+        return NULL;
+    }
+    json_sharers_remove(object->ctx, &object->shared->sharers, &object->shared->sharer_count, value);
+    object->shared = NULL;
+    object->names = copy->names;
+    object->values = copy->values;
+    object->count = copy->count;
+    object->capacity = copy->capacity;
+    PARSON_FREE(object->ctx, copy);
+    return object;
+}
+
+/* Lets go of the object of a value being freed. Returns 0 when the value held it alone and
+   the object is to be freed, otherwise the names and values go on in the object of a sharer. */
+static int json_object_release(JSON_Value *value) {
+    JSON_Object *object = value->value.object, *heir = NULL;
+    JSON_Value *owner = NULL;
+    size_t i;
+    if (object->shared != NULL) {
+        json_sharers_remove(object->ctx, &object->shared->sharers, &object->shared->sharer_count, value);
+        json_memo_free(object->ctx, object->memo);
+        PARSON_FREE(object->ctx, object);
+        return 1;
+    }
+    if (object->sharer_count == 0) {
+        return 0;
+    }
+    owner = object->sharers[object->sharer_count - 1];
+    json_sharers_remove(object->ctx, &object->sharers, &object->sharer_count, owner);
+    heir = owner->value.object;
+    heir->shared = NULL;
+    heir->capacity = object->capacity;
+    heir->sharers = object->sharers;
+    heir->sharer_count = object->sharer_count;
+    for (i = 0; i < heir->sharer_count; i++) {
+        heir->sharers[i]->value.object->shared = heir;
+    }
+    for (i = 0; i < heir->count; i++) {
+        heir->values[i]->parent = owner;
+    }
+    json_memo_free(object->ctx, object->memo);
+    PARSON_FREE(object->ctx, object);
+    return 1;
+}
+
+/* Before a change to object: the object of a copy gets its level first, then the copies
+   sharing the object or one above it get theirs */
+static JSON_Status json_object_detach(JSON_Object *object) {
+    if (object->shared != NULL && json_object_unshare(object->wrapping_value) == NULL) {
+        return JSONFailure;
+    }
+    return json_value_detach(object->wrapping_value);
 }
 
 /* JSON Array */
-static JSON_Array * json_array_init(JSON_Value *wrapping_value) {
-    JSON_Array *new_array = (JSON_Array*)parson_malloc(sizeof(JSON_Array));
+static JSON_Array * json_array_init(JSON_Context *ctx, JSON_Value *wrapping_value) {
+    JSON_Array *new_array = (JSON_Array*)PARSON_MALLOC(ctx, JSONAllocArray, sizeof(JSON_Array));
     if (new_array == NULL) {
         return NULL;
     }
+    new_array->ctx = ctx;
     new_array->wrapping_value = wrapping_value;
+    new_array->shared = NULL;
+    new_array->sharers = NULL;
+    new_array->sharer_count = 0;
     new_array->items = (JSON_Value**)NULL;
+    new_array->numbers = (double*)NULL;
     new_array->capacity = 0;
     new_array->count = 0;
+    new_array->memo = NULL;
     return new_array;
 }
 
 static JSON_Status json_array_add(JSON_Array *array, JSON_Value *value) {
+    json_value_invalidate(array->wrapping_value, array->count);
+    if (array->numbers != NULL && json_array_box(array) == JSONFailure) {
+        return JSONFailure;
+    }
     if (array->count >= array->capacity) {
         size_t new_capacity = MAX(array->capacity * 2, STARTING_CAPACITY);
         if (json_array_resize(array, new_capacity) == JSONFailure) {
@@ -515,39 +1151,286 @@ static JSON_Status json_array_add(JSON_Array *array, JSON_Value *value) {
     return JSONSuccess;
 }
 
+/* Arrays holding only numbers keep them unboxed, as doubles in numbers[], instead of one
+   JSON_Value each. json_array_get_value creates the values on demand and caches them in
+   items[], whose other entries stay NULL. Adding anything else boxes the whole array. */
+static JSON_Status json_array_add_number(JSON_Array *array, double number) {
+    JSON_Value *value = NULL;
+    if (IS_NUMBER_INVALID(number)) {
+        return JSONFailure;
+    }
+    if (!json_array_keeps_numbers(array)) {
+        value = json_value_init_number_ex(array->ctx, number);
+        if (value == NULL) {
+            return JSONFailure;
+        }
+        if (json_array_add(array, value) == JSONFailure) {
+            json_value_free(value);
+            return JSONFailure;
+        }
+        return JSONSuccess;
+    }
+    json_value_invalidate(array->wrapping_value, array->count);
+    if (json_array_reserve_numbers(array, array->numbers == NULL ? STARTING_CAPACITY : 1) == JSONFailure) {
+        return JSONFailure;
+    }
+    array->numbers[array->count] = number;
+    if (array->items != NULL) {
+        array->items[array->count] = NULL;
+    }
+    array->count++;
+    return JSONSuccess;
+}
+
+static int json_array_keeps_numbers(const JSON_Array *array) {
+    return array->numbers != NULL || (array->count == 0 && array->ctx->number_arrays);
+}
+
+/* Room for count more numbers, an empty array becomes unboxed */
+static JSON_Status json_array_reserve_numbers(JSON_Array *array, size_t count) {
+    size_t new_capacity = 0;
+    if (array->numbers == NULL) {
+        new_capacity = MAX(array->capacity, count);
+        array->numbers = (double*)PARSON_MALLOC(array->ctx, JSONAllocArray, new_capacity * sizeof(double));
+        if (array->numbers == NULL) {
+            return JSONFailure;
+        }
+        PARSON_FREE(array->ctx, array->items); /* empty */
+        array->items = NULL;
+        array->capacity = new_capacity;
+        return JSONSuccess;
+    }
+    if (array->capacity - array->count >= count) {
+        return JSONSuccess;
+    }
+    new_capacity = MAX(array->capacity * 2, array->count + count);
+    return json_array_resize(array, new_capacity);
+}
+
+/* Gives a new array the numbers of an unboxed one, the values are created again on demand */
+static JSON_Status json_array_copy_numbers(JSON_Array *copy, const JSON_Array *array) {
+    if (array->count == 0) {
+        return JSONSuccess;
+    }
+    copy->numbers = (double*)PARSON_MALLOC(copy->ctx, JSONAllocArray, array->count * sizeof(double));
+    if (copy->numbers == NULL) {
+        return JSONFailure;
+    }
+    memcpy(copy->numbers, array->numbers, array->count * sizeof(double));
+    copy->count = array->count;
+    copy->capacity = array->count;
+    return JSONSuccess;
+}
+
+static JSON_Value * json_array_number_value(JSON_Array *array, size_t index) {
+    JSON_Value *value = NULL;
+    size_t i;
+    if (array->items == NULL) {
+        array->items = (JSON_Value**)PARSON_MALLOC(array->ctx, JSONAllocArray, array->capacity * sizeof(JSON_Value*));
+        if (array->items == NULL) {
+            return NULL;
+        }
+        for (i = 0; i < array->count; i++) {
+            array->items[i] = NULL;
+        }
+    }
+    if (array->items[index] == NULL) {
+        value = json_value_init_number_ex(array->ctx, array->numbers[index]);
+        if (value == NULL) {
+            return NULL;
+        }
+        value->parent = array->wrapping_value;
+        array->items[index] = value;
+    }
+    return array->items[index];
+}
+
+/* Creates the values that are missing and drops the numbers, the array is then a plain one */
+static JSON_Status json_array_box(JSON_Array *array) {
+    size_t i;
+    for (i = 0; i < array->count; i++) {
+        if (json_array_number_value(array, i) == NULL) {
+            return JSONFailure;
+        }
+    }
+    PARSON_FREE(array->ctx, array->numbers);
+    array->numbers = NULL;
+    if (array->items == NULL) { /* was empty */
+        array->capacity = 0;
+    }
+    return JSONSuccess;
+}
+
 static JSON_Status json_array_resize(JSON_Array *array, size_t new_capacity) {
     JSON_Value **new_items = NULL;
+    double *new_numbers = NULL;
     if (new_capacity == 0) {
         return JSONFailure;
     }
-    new_items = (JSON_Value**)parson_malloc(new_capacity * sizeof(JSON_Value*));
-    if (new_items == NULL) {
-        return JSONFailure;
+    if (array->numbers != NULL) {
+        new_numbers = (double*)PARSON_MALLOC(array->ctx, JSONAllocArray, new_capacity * sizeof(double));
+        if (new_numbers == NULL) {
+            return JSONFailure;
+        }
+        memcpy(new_numbers, array->numbers, array->count * sizeof(double));
+    }
+    if (array->numbers == NULL || array->items != NULL) {
+        new_items = (JSON_Value**)PARSON_MALLOC(array->ctx, JSONAllocArray, new_capacity * sizeof(JSON_Value*));
+        if (new_items == NULL) {
+            PARSON_FREE(array->ctx, new_numbers);
+            return JSONFailure;
+        }
+        if (array->items != NULL && array->count > 0) {
+            memcpy(new_items, array->items, array->count * sizeof(JSON_Value*));
+        }
+        PARSON_FREE(array->ctx, array->items);
+        array->items = new_items;
     }
-    if (array->items != NULL && array->count > 0) {
-        memcpy(new_items, array->items, array->count * sizeof(JSON_Value*));
+    if (new_numbers != NULL) {
+        PARSON_FREE(array->ctx, array->numbers);
+        array->numbers = new_numbers;
     }
-    parson_free(array->items);
-    array->items = new_items;
     array->capacity = new_capacity;
     return JSONSuccess;
 }
 
 static void json_array_free(JSON_Array *array) {
+    JSON_Context *ctx = array->ctx;
     size_t i;
-    for (i = 0; i < array->count; i++) {
+    for (i = 0; array->items != NULL && i < array->count; i++) {
         json_value_free(array->items[i]);
     }
-    parson_free(array->items);
-    parson_free(array);
+    PARSON_FREE(ctx, array->items);
+    PARSON_FREE(ctx, array->numbers);
+    PARSON_FREE(ctx, array->sharers);
+    json_memo_free(ctx, array->memo);
+    PARSON_FREE(ctx, array);
+}
+
+/* Same as json_object_share. The values of an array of numbers are created in the array read
+   in place, see json_array_get_value. */
+static JSON_Value * json_array_share(JSON_Array *array) {
+    JSON_Value *copy = NULL;
+    JSON_Array *view = NULL;
+    if (array->shared != NULL) {
+        array = array->shared;
+    }
+    copy = json_value_init_array_ex(array->ctx);
+    if (copy == NULL) {
+        return NULL;
+    }
+    if (json_sharers_add(array->ctx, JSONAllocArray, &array->sharers, &array->sharer_count, copy) == JSONFailure) {
+        json_value_free(copy);
+        return NULL;
+    }
+    view = copy->value.array;
+    view->shared = array;
+    view->items = array->numbers != NULL ? NULL : array->items;
+    view->numbers = array->numbers;
+    view->count = array->count;
+    view->capacity = array->count;
+    return copy;
+}
+
+static JSON_Array * json_array_copy_level(JSON_Array *array, JSON_Value *value) {
+    JSON_Array *copy = NULL;
+    JSON_Value *temp_value = NULL;
+    size_t i;
+    copy = json_array_init(array->ctx, value);
+    if (copy == NULL) {
+        return NULL;
+    }
+    if (array->numbers != NULL) {
+        if (json_array_copy_numbers(copy, array) == JSONFailure) {
+            json_array_free(copy);
+            return NULL;
+        }
+        return copy;
+    }
+    if (array->count > 0 && json_array_resize(copy, array->count) == JSONFailure) {
+        json_array_free(copy);
+        return NULL;
+    }
+    for (i = 0; i < array->count; i++) {
+        temp_value = json_value_deep_copy_ex(array->ctx, array->items[i]);
+        if (temp_value == NULL) {
+            json_array_free(copy);
+            return NULL;
+        }
+        temp_value->parent = value;
+        copy->items[i] = temp_value;
+        copy->count++;
+    }
+    return copy;
+}
+
+static JSON_Array * json_array_unshare(JSON_Value *value) {
+    JSON_Array *array = value->value.array, *copy = NULL;
+    if (array->shared == NULL) {
+        return array;
+    }
+    copy = json_array_copy_level(array->shared, value);
+    if (copy == NULL) {
+        return NULL;
+    }
+    json_sharers_remove(array->ctx, &array->shared->sharers, &array->shared->sharer_count, value);
+    array->shared = NULL;
+    array->items = copy->items;
+    array->numbers = copy->numbers;
+    array->count = copy->count;
+    array->capacity = copy->capacity;
+    PARSON_FREE(array->ctx, copy);
+    return array;
+}
+
+static int json_array_release(JSON_Value *value) {
+    JSON_Array *array = value->value.array, *heir = NULL;
+    JSON_Value *owner = NULL;
+    size_t i;
+    if (array->shared != NULL) {
+        json_sharers_remove(array->ctx, &array->shared->sharers, &array->shared->sharer_count, value);
+        json_memo_free(array->ctx, array->memo);
+        PARSON_FREE(array->ctx, array);
+        return 1;
+    }
+    if (array->sharer_count == 0) {
+        return 0;
+    }
+    owner = array->sharers[array->sharer_count - 1];
+    json_sharers_remove(array->ctx, &array->sharers, &array->sharer_count, owner);
+    heir = owner->value.array;
+    heir->shared = NULL;
+    heir->items = array->items;
+    heir->capacity = array->capacity;
+    heir->sharers = array->sharers;
+    heir->sharer_count = array->sharer_count;
+    for (i = 0; i < heir->sharer_count; i++) {
+        heir->sharers[i]->value.array->shared = heir;
+    }
+    for (i = 0; heir->items != NULL && i < heir->count; i++) {
+        if (heir->items[i] != NULL) {
+            heir->items[i]->parent = owner;
+        }
+    }
+    json_memo_free(array->ctx, array->memo);
+    PARSON_FREE(array->ctx, array);
+    return 1;
+}
+
+static JSON_Status json_array_detach(JSON_Array *array) {
+    if (array->shared != NULL && json_array_unshare(array->wrapping_value) == NULL) {
+        return JSONFailure;
+    }
+    return json_value_detach(array->wrapping_value);
 }
 
 /* JSON Value */
-static JSON_Value * json_value_init_string_no_copy(char *string, size_t length) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+static JSON_Value * json_value_init_string_no_copy(JSON_Context *ctx, char *string, size_t length) {
+    JSON_Value *new_value = (JSON_Value*)PARSON_MALLOC(ctx, JSONAllocValue, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
+    new_value->ctx = ctx;
     new_value->parent = NULL;
     new_value->type = JSONString;
     new_value->value.string.chars = string;
@@ -555,33 +1438,561 @@ static JSON_Value * json_value_init_string_no_copy(char *string, size_t length)
     return new_value;
 }
 
-/* Parser */
-static JSON_Status skip_quotes(const char **string) {
-    if (**string != '\"') {
-        return JSONFailure;
+static JSON_Value * json_value_init_number_lexeme(JSON_Context *ctx, const char *lexeme, size_t length) {
+    JSON_Value *new_value = (JSON_Value*)PARSON_MALLOC(ctx, JSONAllocValue, sizeof(JSON_Value));
+    if (new_value == NULL) {
+        return NULL;
     }
-    SKIP_CHAR(string);
-    while (**string != '\"') {
-        if (**string == '\0') {
+    new_value->ctx = ctx;
+    new_value->parent = NULL;
+    if (length < sizeof(new_value->value.lexeme)) {
+        new_value->type = JSONNumberShort;
+        memcpy(new_value->value.lexeme, lexeme, length);
+        new_value->value.lexeme[length] = '\0';
+        return new_value;
+    }
+    new_value->type = JSONNumberText;
+    new_value->value.string.chars = parson_strndup(ctx, lexeme, length, JSONAllocString);
+    new_value->value.string.length = length;
+    if (new_value->value.string.chars == NULL) {
+        PARSON_FREE(ctx, new_value);
+        return NULL;
+    }
+    return new_value;
+}
+
+/* The sharers of a container, see json_object_share. The table is reallocated when its count
+   reaches a power of two and freed when it drops to zero. */
+static JSON_Status json_sharers_add(JSON_Context *ctx, int category, JSON_Value ***sharers, size_t *count, JSON_Value *value) {
+    JSON_Value **new_sharers = NULL;
+    if ((*count & (*count - 1)) == 0) {
+        new_sharers = (JSON_Value**)PARSON_MALLOC(ctx, category, (*count > 0 ? *count * 2 : 1) * sizeof(JSON_Value*));
+        if (new_sharers == NULL) {
             return JSONFailure;
-        } else if (**string == '\\') {
-            SKIP_CHAR(string);
-            if (**string == '\0') {
-                return JSONFailure;
-            }
         }
-        SKIP_CHAR(string);
+        if (*count > 0) {
+            memcpy(new_sharers, *sharers, *count * sizeof(JSON_Value*));
+        }
+        PARSON_FREE(ctx, *sharers);
+        *sharers = new_sharers;
     }
-    SKIP_CHAR(string);
+    (*sharers)[(*count)++] = value;
     return JSONSuccess;
 }
 
-static int parse_utf16(const char **unprocessed, char **processed) {
-    unsigned int cp, lead, trail;
-    int parse_succeeded = 0;
-    char *processed_ptr = *processed;
-    const char *unprocessed_ptr = *unprocessed;
-    unprocessed_ptr++; /* skips u */
+static void json_sharers_remove(JSON_Context *ctx, JSON_Value ***sharers, size_t *count, const JSON_Value *value) {
+    size_t i = 0;
+    while (i < *count && (*sharers)[i] != value) {
+        i++;
+    }
+    if (i == *count) {
+        return;
+    }
+    (*sharers)[i] = (*sharers)[--(*count)];
+    if (*count == 0) {
+        PARSON_FREE(ctx, *sharers);
+        *sharers = NULL;
+    }
+}
+
+static size_t json_value_sharer_count(const JSON_Value *value) {
+    switch (json_value_get_type(value)) {
+        case JSONObject:
+            return value->value.object->sharer_count;
+        case JSONArray:
+            return value->value.array->sharer_count;
+        default:
+            return 0;
+    }
+}
+
+/* Called before the container of value changes, value being its owner: the sharers of that
+   container and of those above it get a copy of their own, the topmost first since each copy
+   shares the level below it. Fails when out of memory, nothing having changed for the caller. */
+static JSON_Status json_value_detach(JSON_Value *value) {
+    JSON_Value *top = NULL, *temp_value = NULL, *sharer = NULL;
+    for (;;) {
+        top = NULL;
+        for (temp_value = value; temp_value != NULL; temp_value = temp_value->parent) {
+            if (json_value_sharer_count(temp_value) > 0) {
+                top = temp_value;
+            }
+        }
+        if (top == NULL) {
+            return JSONSuccess;
+        }
+        while (json_value_sharer_count(top) > 0) {
+            if (top->type == JSONObject) {
+                sharer = top->value.object->sharers[top->value.object->sharer_count - 1];
+                if (json_object_unshare(sharer) == NULL) {
+                    return JSONFailure;
+                }
+            } else {
+                sharer = top->value.array->sharers[top->value.array->sharer_count - 1];
+                if (json_array_unshare(sharer) == NULL) {
+                    return JSONFailure;
+                }
+            }
+        }
+    }
+}
+
+/* Serialization cache. The serializer keeps the text of a document of MEMO_MIN_LENGTH to
+   MEMO_MAX_LENGTH and copies it the next time. Larger containers are kept as runs of about
+   MEMO_RUN_LENGTH, small members together, so that a change to one member costs its run
+   only; a member over MEMO_MAX_LENGTH has runs of its own. A memo replaces those of the
+   members it covers, so that the document is held once at most for each of the compact and
+   pretty forms. */
+static JSON_Memo ** json_value_memo(const JSON_Value *value) {
+    switch (json_value_get_type(value)) {
+        case JSONObject:
+            return &value->value.object->memo;
+        case JSONArray:
+            return &value->value.array->memo;
+        default:
+            return NULL;
+    }
+}
+
+/* Called before member index of a container changes, MEMO_ALL before all of them do: the
+   text of the container and the run of that member are outdated, and so are those of the
+   containers above it. The other members have not changed. */
+static void json_value_invalidate(JSON_Value *value, size_t index) {
+    JSON_Memo **memo = NULL;
+    const JSON_Value *member = NULL;
+    for (; value != NULL; member = value, value = value->parent) {
+        memo = json_value_memo(value);
+        if (memo == NULL || *memo == NULL) {
+            continue;
+        }
+        PARSON_FREE(value->ctx, (*memo)->text[0]);
+        PARSON_FREE(value->ctx, (*memo)->text[1]);
+        (*memo)->text[0] = NULL;
+        (*memo)->text[1] = NULL;
+        if ((*memo)->runs[0].count == 0 && (*memo)->runs[1].count == 0) {
+            continue;
+        }
+        if (member != NULL) {
+            index = json_value_member_index(value, member);
+        }
+        json_memo_drop_run(value->ctx, &(*memo)->runs[0], index);
+        json_memo_drop_run(value->ctx, &(*memo)->runs[1], index);
+    }
+}
+
+/* Called once member index has been removed, after json_value_invalidate: the runs after it
+   move down */
+static void json_value_memo_removed(JSON_Value *value, size_t index) {
+    JSON_Memo **memo = json_value_memo(value);
+    JSON_Memo_Runs *runs = NULL;
+    size_t form, i;
+    if (memo == NULL || *memo == NULL) {
+        return;
+    }
+    for (form = 0; form < 2; form++) {
+        runs = &(*memo)->runs[form];
+        for (i = json_memo_find_run(runs, index); i < runs->count; i++) {
+            runs->runs[i].first--;
+        }
+    }
+}
+
+/* Index of member in value, MEMO_ALL when it cannot be found */
+static size_t json_value_member_index(const JSON_Value *value, const JSON_Value *member) {
+    const JSON_Object *object = NULL;
+    const JSON_Array *array = NULL;
+    size_t i;
+    if (value->type == JSONObject) {
+        object = value->value.object;
+        for (i = 0; i < object->count; i++) {
+            if (object->values[i] == member) {
+                return i;
+            }
+        }
+    } else {
+        array = value->value.array;
+        for (i = 0; array->items != NULL && i < array->count; i++) {
+            if (array->items[i] == member) {
+                return i;
+            }
+        }
+    }
+    return MEMO_ALL;
+}
+
+/* Keeps the text of a document, written as a whole */
+static void json_value_memoize(const JSON_Value *value, const char *text, size_t length, int is_pretty, int key) {
+    JSON_Memo **memo = json_value_memo(value);
+    char *copy = NULL;
+    if (length < MEMO_MIN_LENGTH || length > MEMO_MAX_LENGTH) {
+        return;
+    }
+    if (*memo == NULL) {
+        *memo = json_memo_new(value->ctx);
+        if (*memo == NULL) {
+            return; /* written again next time */
+        }
+    }
+    copy = (char*)PARSON_MALLOC(value->ctx, JSONAllocSerializer, length);
+    if (copy == NULL) {
+        return;
+    }
+    memcpy(copy, text, length);
+    PARSON_FREE(value->ctx, (*memo)->text[is_pretty]);
+    (*memo)->text[is_pretty] = copy;
+    (*memo)->length[is_pretty] = length;
+    (*memo)->key[is_pretty] = key;
+    json_memo_drop_run(value->ctx, &(*memo)->runs[is_pretty], MEMO_ALL);
+    json_value_forget_members(value, 0, json_value_child_count(value));
+}
+
+/* Keeps the runs formed while writing a large container, pending[first] onwards, in place of
+   those they were made of. The other runs were copied unchanged and stay. */
+static void json_value_memoize_runs(const JSON_Value *value, const JSON_Memo_Runs *pending, size_t first, int is_pretty, int key) {
+    JSON_Memo **memo = json_value_memo(value);
+    JSON_Memo_Runs *runs = NULL;
+    JSON_Memo_Run *merged = NULL, *kept = NULL;
+    const JSON_Memo_Run *run = NULL;
+    char *copy = NULL;
+    size_t i = 0, count = 0;
+    if (*memo == NULL) {
+        *memo = json_memo_new(value->ctx);
+        if (*memo == NULL) {
+            return;
+        }
+    }
+    PARSON_FREE(value->ctx, (*memo)->text[is_pretty]); /* outgrown */
+    (*memo)->text[is_pretty] = NULL;
+    (*memo)->length[is_pretty] = 0;
+    runs = &(*memo)->runs[is_pretty];
+    if ((*memo)->key[is_pretty] != key) {
+        json_memo_drop_run(value->ctx, runs, MEMO_ALL);
+        (*memo)->key[is_pretty] = key;
+    }
+    if (first >= pending->count) {
+        return;
+    }
+    merged = (JSON_Memo_Run*)PARSON_MALLOC(value->ctx, JSONAllocSerializer, (runs->count + pending->count - first) * sizeof(JSON_Memo_Run));
+    if (merged == NULL) {
+        return;
+    }
+    kept = runs->runs;
+    for (run = &pending->runs[first]; run < &pending->runs[pending->count]; run++) {
+        for (; i < runs->count && kept[i].first < run->first; i++) {
+            merged[count++] = kept[i];
+        }
+        for (; i < runs->count && kept[i].first < run->first + run->count; i++) {
+            PARSON_FREE(value->ctx, kept[i].text); /* taken in by the new run */
+        }
+        copy = (char*)PARSON_MALLOC(value->ctx, JSONAllocSerializer, run->length);
+        if (copy == NULL) {
+            continue; /* written again next time */
+        }
+        memcpy(copy, run->text, run->length);
+        merged[count] = *run;
+        merged[count].text = copy;
+        count++;
+        json_value_forget_members(value, run->first, run->count);
+    }
+    for (; i < runs->count; i++) {
+        merged[count++] = kept[i];
+    }
+    PARSON_FREE(value->ctx, kept);
+    runs->runs = merged;
+    runs->count = count;
+    runs->capacity = count;
+}
+
+/* The run of value starting at member index, if its text is still right at this level */
+static const JSON_Memo_Run * json_value_memo_run(const JSON_Value *value, int is_pretty, int key, size_t index) {
+    const JSON_Memo *memo = *json_value_memo(value);
+    const JSON_Memo_Runs *runs = NULL;
+    size_t i;
+    if (memo == NULL || memo->key[is_pretty] != key) {
+        return NULL;
+    }
+    runs = &memo->runs[is_pretty];
+    i = json_memo_find_run(runs, index);
+    return i < runs->count && runs->runs[i].first == index ? &runs->runs[i] : NULL;
+}
+
+/* Drops the memos of members [first, first + count), now covered by those of value */
+static void json_value_forget_members(const JSON_Value *value, size_t first, size_t count) {
+    const JSON_Object *object = NULL;
+    const JSON_Array *array = NULL;
+    JSON_Value *member = NULL;
+    JSON_Memo **memo = NULL;
+    size_t i;
+    if (value->type == JSONArray && value->value.array->numbers != NULL) {
+        return; /* nothing but numbers */
+    }
+    for (i = first; i < first + count; i++) {
+        if (value->type == JSONObject) {
+            object = value->value.object;
+            member = object->values[i];
+        } else {
+            array = value->value.array;
+            member = array->items[i];
+        }
+        memo = json_value_memo(member);
+        if (memo != NULL && *memo != NULL) {
+            json_memo_free(member->ctx, *memo);
+            *memo = NULL;
+        }
+    }
+}
+
+static JSON_Memo * json_memo_new(JSON_Context *ctx) {
+    JSON_Memo *memo = (JSON_Memo*)PARSON_MALLOC(ctx, JSONAllocSerializer, sizeof(JSON_Memo));
+    if (memo == NULL) {
+        return NULL;
+    }
+    memset(memo, 0, sizeof(JSON_Memo));
+    return memo;
+}
+
+/* Position of the run holding member index, or of the first one after it */
+static size_t json_memo_find_run(const JSON_Memo_Runs *runs, size_t index) {
+    size_t low = 0, high = runs->count, middle = 0;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (runs->runs[middle].first + runs->runs[middle].count <= index) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/* Drops the run holding member index, all of them for MEMO_ALL */
+static void json_memo_drop_run(JSON_Context *ctx, JSON_Memo_Runs *runs, size_t index) {
+    size_t i;
+    if (index == MEMO_ALL) {
+        for (i = 0; i < runs->count; i++) {
+            PARSON_FREE(ctx, runs->runs[i].text);
+        }
+        PARSON_FREE(ctx, runs->runs);
+        runs->runs = NULL;
+        runs->count = 0;
+        runs->capacity = 0;
+        return;
+    }
+    i = json_memo_find_run(runs, index);
+    if (i == runs->count || runs->runs[i].first > index) {
+        return;
+    }
+    PARSON_FREE(ctx, runs->runs[i].text);
+    memmove(&runs->runs[i], &runs->runs[i + 1], (runs->count - i - 1) * sizeof(JSON_Memo_Run));
+    runs->count--;
+}
+
+/* Adds a run to those formed while serializing, its text still in the output. One that
+   cannot be added is only missing. */
+static void json_memo_pend(JSON_Context *ctx, JSON_Memo_Runs *pending, size_t first, size_t count, const char *text, size_t length) {
+    JSON_Memo_Run *new_runs = NULL;
+    size_t new_capacity = 0;
+    if (pending->count >= pending->capacity) {
+        new_capacity = MAX(pending->capacity * 2, STARTING_CAPACITY);
+        new_runs = (JSON_Memo_Run*)PARSON_MALLOC(ctx, JSONAllocSerializer, new_capacity * sizeof(JSON_Memo_Run));
+        if (new_runs == NULL) {
+            return;
+        }
+        if (pending->count > 0) {
+            memcpy(new_runs, pending->runs, pending->count * sizeof(JSON_Memo_Run));
+        }
+        PARSON_FREE(ctx, pending->runs);
+        pending->runs = new_runs;
+        pending->capacity = new_capacity;
+    }
+    pending->runs[pending->count].first = first;
+    pending->runs[pending->count].count = count;
+    pending->runs[pending->count].text = (char*)text;
+    pending->runs[pending->count].length = length;
+    pending->count++;
+}
+
+static void json_memo_free(JSON_Context *ctx, JSON_Memo *memo) {
+    if (memo == NULL) {
+        return;
+    }
+    PARSON_FREE(ctx, memo->text[0]);
+    PARSON_FREE(ctx, memo->text[1]);
+    json_memo_drop_run(ctx, &memo->runs[0], MEMO_ALL);
+    json_memo_drop_run(ctx, &memo->runs[1], MEMO_ALL);
+    PARSON_FREE(ctx, memo);
+}
+
+static size_t json_value_child_count(const JSON_Value *value) {
+    switch (json_value_get_type(value)) {
+        case JSONObject:
+            return value->value.object->count;
+        case JSONArray:
+            return value->value.array->count;
+        default:
+            return 0;
+    }
+}
+
+/* Copies a value without its members, objects and arrays come back empty but sized for them */
+static JSON_Value * json_value_copy_node(JSON_Context *ctx, const JSON_Value *value) {
+    JSON_Value *return_value = NULL;
+    const JSON_String *temp_string = NULL;
+    const char *lexeme = NULL;
+    char *temp_string_copy = NULL;
+    size_t count = json_value_child_count(value);
+    JSON_Status status = JSONSuccess;
+    switch (json_value_get_type(value)) {
+        case JSONArray:
+            return_value = json_value_init_array_ex(ctx);
+            if (return_value == NULL) {
+                return NULL;
+            }
+            if (value->value.array->numbers != NULL) { /* copied whole, nothing left to walk */
+                status = json_array_copy_numbers(return_value->value.array, value->value.array);
+            } else if (count > 0) {
+                status = json_array_resize(return_value->value.array, count);
+            }
+            if (status == JSONFailure) {
+                json_value_free(return_value);
+                return NULL;
+            }
+            return return_value;
+        case JSONObject:
+            return_value = json_value_init_object_ex(ctx);
+            if (return_value != NULL && count > 0 &&
+                json_object_resize(return_value->value.object, count) == JSONFailure) {
+                json_value_free(return_value);
+                return NULL;
+            }
+            return return_value;
+        case JSONBoolean:
+            return json_value_init_boolean_ex(ctx, value->value.boolean);
+        case JSONNumber:
+            lexeme = json_value_get_number_lexeme(value);
+            if (lexeme != NULL) {
+                return json_value_init_number_lexeme(ctx, lexeme, strlen(lexeme));
+            }
+            return json_value_init_number_ex(ctx, value->value.number);
+        case JSONString:
+            temp_string = &value->value.string;
+            temp_string_copy = parson_strndup(ctx, temp_string->chars, temp_string->length, JSONAllocString);
+            if (temp_string_copy == NULL) {
+                return NULL;
+            }
+            return_value = json_value_init_string_no_copy(ctx, temp_string_copy, temp_string->length);
+            if (return_value == NULL) {
+                PARSON_FREE(ctx, temp_string_copy);
+            }
+            return return_value;
+        case JSONNull:
+            return json_value_init_null_ex(ctx);
+        case JSONError:
+            return NULL;
+        default:
+            return NULL;
+    }
+}
+
+/* Full copy of a tree, nothing shared. Each frame holds a source container and its copy. */
+static JSON_Value * json_value_copy_tree(JSON_Context *ctx, const JSON_Value *value) {
+    JSON_Walk_Stack stack;
+    JSON_Walk_Frame *frame = NULL;
+    JSON_Value *root = NULL, *copy = NULL;
+    const JSON_Object *object = NULL;
+    JSON_Object *object_copy = NULL;
+    JSON_Array *array_copy = NULL;
+    char *key_copy = NULL;
+
+    root = json_value_copy_node(ctx, value);
+    if (root == NULL) {
+        return NULL;
+    }
+    walk_stack_init(&stack, ctx);
+    copy = root;
+    for (;;) {
+        if (json_value_child_count(value) > 0 && !IS_NUMBER_ARRAY(value)) {
+            frame = walk_stack_push(&stack);
+            if (frame == NULL) {
+                goto error;
+            }
+            frame->value = value;
+            frame->target = copy;
+        }
+        /* next member to copy, leaving the containers that are complete */
+        for (;;) {
+            if (stack.count == 0) {
+                walk_stack_free(&stack);
+                return root;
+            }
+            frame = &stack.frames[stack.count - 1];
+            if (frame->index < json_value_child_count(frame->value)) {
+                break;
+            }
+            stack.count--;
+        }
+        if (frame->value->type == JSONObject) {
+            object = frame->value->value.object;
+            value = object->values[frame->index];
+            copy = json_value_copy_node(ctx, value);
+            if (copy == NULL) {
+                goto error;
+            }
+            key_copy = parson_strdup(ctx, object->names[frame->index], JSONAllocKey);
+            if (key_copy == NULL) {
+                json_value_free(copy);
+                goto error;
+            }
+            object_copy = frame->target->value.object; /* sized by json_value_copy_node */
+            object_copy->names[object_copy->count] = key_copy;
+            object_copy->values[object_copy->count] = copy;
+            object_copy->count++;
+        } else {
+            value = frame->value->value.array->items[frame->index];
+            copy = json_value_copy_node(ctx, value);
+            if (copy == NULL) {
+                goto error;
+            }
+            array_copy = frame->target->value.array;
+            array_copy->items[array_copy->count] = copy;
+            array_copy->count++;
+        }
+        copy->parent = frame->target;
+        frame->index++;
+    }
+error:
+    json_value_free(root);
+    walk_stack_free(&stack);
+    return NULL;
+}
+
+/* Parser */
+static JSON_Status skip_quotes(const char **string) {
+    if (**string != '\"') {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    while (**string != '\"') {
+        if (**string == '\0') {
+            return JSONFailure;
+        } else if (**string == '\\') {
+            SKIP_CHAR(string);
+            if (**string == '\0') {
+                return JSONFailure;
+            }
+        }
+        SKIP_CHAR(string);
+    }
+    SKIP_CHAR(string);
+    return JSONSuccess;
+}
+
+static int parse_utf16(const char **unprocessed, char **processed) {
+    unsigned int cp, lead, trail;
+    int parse_succeeded = 0;
+    char *processed_ptr = *processed;
+    const char *unprocessed_ptr = *unprocessed;
+    unprocessed_ptr++; /* skips u */
     parse_succeeded = parse_utf16_hex(unprocessed_ptr, &cp);
     if (!parse_succeeded) {
         return JSONFailure;
@@ -625,12 +2036,25 @@ static int parse_utf16(const char **unprocessed, char **processed) {
 
 /* Copies and processes passed string up to supplied length.
 Example: "\u006Corem ipsum" -> lorem ipsum */
-static char* process_string(const char *input, size_t input_len, size_t *output_len) {
+static char* process_string(JSON_Context *ctx, const char *input, size_t input_len, size_t *output_len, int category) {
     const char *input_ptr = input;
     size_t initial_size = (input_len + 1) * sizeof(char);
     size_t final_size = 0;
     char *output = NULL, *output_ptr = NULL, *resized_output = NULL;
-    output = (char*)parson_malloc(initial_size);
+    if (ctx->use_scratch) { /* decode in the reusable scratch buffer, then allocate once */
+        if (ctx->scratch_capacity < initial_size) {
+            PARSON_FREE(ctx, ctx->scratch);
+            ctx->scratch_capacity = 0;
+            ctx->scratch = (char*)PARSON_MALLOC(ctx, JSONAllocInput, MAX(initial_size, 256));
+            if (ctx->scratch == NULL) {
+                return NULL;
+            }
+            ctx->scratch_capacity = MAX(initial_size, 256);
+        }
+        output = ctx->scratch;
+    } else {
+        output = (char*)PARSON_MALLOC(ctx, category, initial_size);
+    }
     if (output == NULL) {
         goto error;
     }
@@ -667,22 +2091,26 @@ static char* process_string(const char *input, size_t input_len, size_t *output_
     /* resize to new length */
     final_size = (size_t)(output_ptr-output) + 1;
     /* todo: don't resize if final_size == initial_size */
-    resized_output = (char*)parson_malloc(final_size);
+    resized_output = (char*)PARSON_MALLOC(ctx, category, final_size);
     if (resized_output == NULL) {
         goto error;
     }
     memcpy(resized_output, output, final_size);
     *output_len = final_size - 1;
-    parson_free(output);
+    if (output != ctx->scratch) {
+        PARSON_FREE(ctx, output);
+    }
     return resized_output;
 error:
-    parson_free(output);
+    if (output != ctx->scratch) {
+        PARSON_FREE(ctx, output);
+    }
     return NULL;
 }
 
 /* Return processed contents of a string between quotes and
    skips passed argument to a matching quote. */
-static char * get_quoted_string(const char **string, size_t *output_string_len) {
+static char * get_quoted_string(JSON_Context *ctx, const char **string, size_t *output_string_len, int category) {
     const char *string_start = *string;
     size_t input_string_len = 0;
     JSON_Status status = skip_quotes(string);
@@ -690,517 +2118,952 @@ static char * get_quoted_string(const char **string, size_t *output_string_len)
         return NULL;
     }
     input_string_len = *string - string_start - 2; /* length without quotes */
-    return process_string(string_start + 1, input_string_len, output_string_len);
+    return process_string(ctx, string_start + 1, input_string_len, output_string_len, category);
 }
 
-static JSON_Value * parse_value(const char **string, size_t nesting) {
-    if (nesting > MAX_NESTING) {
+/* Parses a member name and the ':' that follows it */
+static char * parse_key(JSON_Context *ctx, const char **string) {
+    size_t key_len = 0;
+    char *new_key = get_quoted_string(ctx, string, &key_len, JSONAllocKey);
+    if (new_key == NULL) {
         return NULL;
     }
-    SKIP_WHITESPACES(string);
-    switch (**string) {
-        case '{':
-            return parse_object_value(string, nesting + 1);
-        case '[':
-            return parse_array_value(string, nesting + 1);
-        case '\"':
-            return parse_string_value(string);
-        case 'f': case 't':
-            return parse_boolean_value(string);
-        case '-':
-        case '0': case '1': case '2': case '3': case '4':
-        case '5': case '6': case '7': case '8': case '9':
-            return parse_number_value(string);
-        case 'n':
-            return parse_null_value(string);
-        default:
-            return NULL;
-    }
-}
-
-static JSON_Value * parse_object_value(const char **string, size_t nesting) {
-    JSON_Value *output_value = NULL, *new_value = NULL;
-    JSON_Object *output_object = NULL;
-    char *new_key = NULL;
-    output_value = json_value_init_object();
-    if (output_value == NULL) {
+    /* We do not support key names with embedded \0 chars */
+    if (key_len != strlen(new_key)) {
+        PARSON_FREE(ctx, new_key);
         return NULL;
     }
-    if (**string != '{') {
-        json_value_free(output_value);
+    SKIP_WHITESPACES(string);
+    if (**string != ':') {
+        PARSON_FREE(ctx, new_key);
         return NULL;
     }
-    output_object = json_value_get_object(output_value);
     SKIP_CHAR(string);
-    SKIP_WHITESPACES(string);
-    if (**string == '}') { /* empty object */
-        SKIP_CHAR(string);
-        return output_value;
-    }
-    while (**string != '\0') {
-        size_t key_len = 0;
-        new_key = get_quoted_string(string, &key_len);
-        /* We do not support key names with embedded \0 chars */
-        if (new_key == NULL || key_len != strlen(new_key)) {
-            json_value_free(output_value);
-            return NULL;
-        }
-        SKIP_WHITESPACES(string);
-        if (**string != ':') {
-            parson_free(new_key);
-            json_value_free(output_value);
-            return NULL;
-        }
-        SKIP_CHAR(string);
-        new_value = parse_value(string, nesting);
-        if (new_value == NULL) {
-            parson_free(new_key);
-            json_value_free(output_value);
-            return NULL;
-        }
-        if (json_object_add(output_object, new_key, new_value) == JSONFailure) {
-            parson_free(new_key);
-            json_value_free(new_value);
-            json_value_free(output_value);
-            return NULL;
-        }
-        parson_free(new_key);
-        SKIP_WHITESPACES(string);
-        if (**string != ',') {
-            break;
+    return new_key;
+}
+
+/* Returns the closing quote of the string starting at string, or its null character */
+static const char * skip_string(const char *string) {
+    for (string++; *string != '\"' && *string != '\0'; string++) {
+        if (*string == '\\' && string[1] != '\0') {
+            string++;
         }
-        SKIP_CHAR(string);
-        SKIP_WHITESPACES(string);
-    }
-    SKIP_WHITESPACES(string);
-    if (**string != '}' || /* Trim object after parsing is over */
-        json_object_resize(output_object, json_object_get_count(output_object)) == JSONFailure) {
-            json_value_free(output_value);
-            return NULL;
     }
-    SKIP_CHAR(string);
-    return output_value;
+    return string;
 }
 
-static JSON_Value * parse_array_value(const char **string, size_t nesting) {
-    JSON_Value *output_value = NULL, *new_array_value = NULL;
-    JSON_Array *output_array = NULL;
-    output_value = json_value_init_array();
-    if (output_value == NULL) {
+/* Optional first pass over the input, counting the members of each object and array in the
+   order they open so that parse_value allocates them at their final size. The counts are only
+   hints: on malformed input they may be wrong, the parser still decides what is valid. The
+   end of the block is the stack of the containers open while counting. Counting stops at the
+   end of the value, what follows it is another document or ignored. */
+static size_t * prescan_counts(JSON_Context *ctx, const char *string, size_t *containers) {
+    const char *s = NULL, *end = NULL;
+    size_t *counts = NULL, *open = NULL;
+    size_t count = 0, depth = 0, max_depth = 0, opened = 0;
+    int first = 0;
+    while (isspace((unsigned char)*string)) {
+        string++;
+    }
+    if (*string != '{' && *string != '[') {
         return NULL;
     }
-    if (**string != '[') {
-        json_value_free(output_value);
+    for (s = string; *s != '\0'; s++) {
+        if (*s == '\"') {
+            s = skip_string(s);
+            if (*s == '\0') {
+                break;
+            }
+        } else if (*s == '{' || *s == '[') {
+            count++;
+            depth++;
+            max_depth = MAX(max_depth, depth);
+        } else if ((*s == '}' || *s == ']') && depth > 0) {
+            depth--;
+            if (depth == 0) {
+                s++;
+                break;
+            }
+        }
+    }
+    end = s;
+    if (count == 0 || count > (size_t)-1 / (2 * sizeof(size_t))) {
         return NULL;
     }
-    output_array = json_value_get_array(output_value);
-    SKIP_CHAR(string);
-    SKIP_WHITESPACES(string);
-    if (**string == ']') { /* empty array */
-        SKIP_CHAR(string);
-        return output_value;
+    counts = (size_t*)PARSON_MALLOC(ctx, JSONAllocStack, (count + max_depth) * sizeof(size_t));
+    if (counts == NULL) {
+        return NULL;
     }
-    while (**string != '\0') {
-        new_array_value = parse_value(string, nesting);
-        if (new_array_value == NULL) {
-            json_value_free(output_value);
-            return NULL;
+    open = counts + count;
+    depth = 0;
+    for (s = string; s < end; s++) {
+        if (isspace((unsigned char)*s)) {
+            continue;
         }
-        if (json_array_add(output_array, new_array_value) == JSONFailure) {
-            json_value_free(new_array_value);
-            json_value_free(output_value);
-            return NULL;
+        if (first) { /* anything but the closing bracket is a first member */
+            first = 0;
+            if (*s != '}' && *s != ']') {
+                counts[open[depth - 1]]++;
+            }
         }
-        SKIP_WHITESPACES(string);
-        if (**string != ',') {
-            break;
+        switch (*s) {
+            case '\"':
+                s = skip_string(s);
+                if (*s == '\0') {
+                    s--;
+                }
+                break;
+            case '{': case '[':
+                counts[opened] = 0;
+                open[depth++] = opened++;
+                first = 1;
+                break;
+            case ',':
+                if (depth > 0) {
+                    counts[open[depth - 1]]++;
+                }
+                break;
+            case '}': case ']':
+                if (depth > 0) {
+                    depth--;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    *containers = opened;
+    return counts;
+}
+
+/* The objects and arrays being filled are kept on a walk stack rather than in recursive calls.
+   Like the recursive parser did, a container joins its parent once it is complete. The stack is
+   the caller's, it is left empty with its frames allocated for the next document. */
+static JSON_Value * parse_value(JSON_Context *ctx, const char **string, JSON_Walk_Stack *stack) {
+    JSON_Walk_Frame *frame = NULL;
+    JSON_Value *new_value = NULL, *container = NULL;
+    JSON_Status status = JSONFailure;
+    double number = 0;
+    size_t *counts = NULL, containers = 0, opened = 0, count = 0;
+
+    if (ctx->prescan) {
+        counts = prescan_counts(ctx, *string, &containers); /* NULL: containers grow as usual */
+    }
+    for (;;) {
+        if (stack->count > ctx->max_nesting) {
+            goto error;
         }
-        SKIP_CHAR(string);
         SKIP_WHITESPACES(string);
+        container = stack->count > 0 ? stack->frames[stack->count - 1].target : NULL;
+        if (container != NULL && container->type == JSONArray && !ctx->number_lexemes &&
+            IS_NUMBER_START(**string)) {
+            /* array members that are numbers go straight in, the array decides on a value */
+            if (parse_number(string, &number) == JSONFailure ||
+                json_array_add_number(container->value.array, number) == JSONFailure) {
+                goto error;
+            }
+            new_value = NULL;
+            goto next_member;
+        }
+        switch (**string) {
+            case '{':
+                new_value = json_value_init_object_ex(ctx);
+                break;
+            case '[':
+                new_value = json_value_init_array_ex(ctx);
+                break;
+            case '\"':
+                new_value = parse_string_value(ctx, string);
+                break;
+            case 'f': case 't':
+                new_value = parse_boolean_value(ctx, string);
+                break;
+            case '-':
+            case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9':
+                new_value = parse_number_value(ctx, string);
+                break;
+            case 'n':
+                new_value = parse_null_value(ctx, string);
+                break;
+            default:
+                new_value = NULL;
+                break;
+        }
+        if (new_value == NULL) {
+            goto error;
+        }
+        if (new_value->type == JSONObject || new_value->type == JSONArray) {
+            count = opened < containers ? counts[opened] : 0;
+            opened++;
+            SKIP_CHAR(string);
+            SKIP_WHITESPACES(string);
+            if (**string == (new_value->type == JSONObject ? '}' : ']')) { /* empty */
+                SKIP_CHAR(string);
+            } else {
+                frame = walk_stack_push(stack);
+                if (frame == NULL) {
+                    json_value_free(new_value);
+                    goto error;
+                }
+                frame->target = new_value;
+                if (count > 0) { /* prescanned, allocated once at its size */
+                    if (new_value->type == JSONObject) {
+                        status = json_object_resize(new_value->value.object, count);
+                    } else if (json_array_keeps_numbers(new_value->value.array) && !ctx->number_lexemes &&
+                               IS_NUMBER_START(**string)) {
+                        status = json_array_reserve_numbers(new_value->value.array, count);
+                    } else {
+                        status = json_array_resize(new_value->value.array, count);
+                    }
+                    if (status == JSONFailure) {
+                        goto error;
+                    }
+                }
+                if (new_value->type == JSONObject) {
+                    frame->key = parse_key(ctx, string);
+                    if (frame->key == NULL) {
+                        goto error;
+                    }
+                }
+                continue;
+            }
+        }
+        /* The value is complete: add it to its container, go on with the next member or close
+           the container, which completes a value one level up */
+next_member:
+        for (;;) {
+            if (stack->count == 0) {
+                PARSON_FREE(ctx, counts);
+                return new_value;
+            }
+            frame = &stack->frames[stack->count - 1];
+            container = frame->target;
+            if (new_value == NULL) { /* number already in its array */
+                status = JSONSuccess;
+            } else if (container->type == JSONObject) {
+                status = json_object_add(container->value.object, frame->key, new_value);
+                PARSON_FREE(ctx, frame->key);
+                frame->key = NULL;
+            } else {
+                status = json_array_add(container->value.array, new_value);
+            }
+            if (status == JSONFailure) {
+                json_value_free(new_value);
+                goto error;
+            }
+            SKIP_WHITESPACES(string);
+            if (**string == ',') {
+                SKIP_CHAR(string);
+                SKIP_WHITESPACES(string);
+                if (container->type == JSONObject) {
+                    frame->key = parse_key(ctx, string);
+                    if (frame->key == NULL) {
+                        goto error;
+                    }
+                }
+                break;
+            }
+            if (container->type == JSONObject) {
+                if (**string != '}' || /* Trim object after parsing is over */
+                    (container->value.object->count < container->value.object->capacity &&
+                     json_object_resize(container->value.object, container->value.object->count) == JSONFailure)) {
+                    goto error;
+                }
+            } else {
+                if (**string != ']' || /* Trim array after parsing is over */
+                    (container->value.array->count < container->value.array->capacity &&
+                     json_array_resize(container->value.array, container->value.array->count) == JSONFailure)) {
+                    goto error;
+                }
+            }
+            SKIP_CHAR(string);
+            new_value = container;
+            stack->count--;
+        }
     }
-    SKIP_WHITESPACES(string);
-    if (**string != ']' || /* Trim array after parsing is over */
-        json_array_resize(output_array, json_array_get_count(output_array)) == JSONFailure) {
-            json_value_free(output_value);
-            return NULL;
+error:
+    while (stack->count > 0) { /* containers not added to their parent yet */
+        frame = &stack->frames[stack->count - 1];
+        PARSON_FREE(ctx, frame->key);
+        json_value_free(frame->target);
+        stack->count--;
     }
-    SKIP_CHAR(string);
-    return output_value;
+    PARSON_FREE(ctx, counts);
+    return NULL;
 }
 
-static JSON_Value * parse_string_value(const char **string) {
+static JSON_Value * parse_string_value(JSON_Context *ctx, const char **string) {
     JSON_Value *value = NULL;
     size_t new_string_len = 0;
-    char *new_string = get_quoted_string(string, &new_string_len);
+    char *new_string = get_quoted_string(ctx, string, &new_string_len, JSONAllocString);
     if (new_string == NULL) {
         return NULL;
     }
-    value = json_value_init_string_no_copy(new_string, new_string_len);
+    value = json_value_init_string_no_copy(ctx, new_string, new_string_len);
     if (value == NULL) {
-        parson_free(new_string);
+        PARSON_FREE(ctx, new_string);
         return NULL;
     }
     return value;
 }
 
-static JSON_Value * parse_boolean_value(const char **string) {
+static JSON_Value * parse_boolean_value(JSON_Context *ctx, const char **string) {
     size_t true_token_size = SIZEOF_TOKEN("true");
     size_t false_token_size = SIZEOF_TOKEN("false");
     if (strncmp("true", *string, true_token_size) == 0) {
         *string += true_token_size;
-        return json_value_init_boolean(1);
+        return json_value_init_boolean_ex(ctx, 1);
     } else if (strncmp("false", *string, false_token_size) == 0) {
         *string += false_token_size;
-        return json_value_init_boolean(0);
+        return json_value_init_boolean_ex(ctx, 0);
     }
     return NULL;
 }
 
-static JSON_Value * parse_number_value(const char **string) {
+static JSON_Status parse_number(const char **string, double *number) {
     char *end;
-    double number = 0;
     errno = 0;
-    number = strtod(*string, &end);
+    *number = strtod(*string, &end);
     if (errno || !is_decimal(*string, end - *string)) {
-        return NULL;
+        return JSONFailure;
     }
     *string = end;
-    return json_value_init_number(number);
+    return JSONSuccess;
 }
 
-static JSON_Value * parse_null_value(const char **string) {
+static JSON_Value * parse_number_value(JSON_Context *ctx, const char **string) {
+    JSON_Value *value = NULL;
+    size_t length = 0;
+    double number = 0;
+    if (ctx->number_lexemes) { /* no conversion, json_value_get_number does it */
+        length = scan_number(*string);
+        if (length == 0) {
+            return NULL;
+        }
+        if (is_json_number(*string, length)) { /* otherwise converted, "1." is not written back */
+            value = json_value_init_number_lexeme(ctx, *string, length);
+            if (value != NULL) {
+                *string += length;
+            }
+            return value;
+        }
+    }
+    if (parse_number(string, &number) == JSONFailure) {
+        return NULL;
+    }
+    return json_value_init_number_ex(ctx, number);
+}
+
+static JSON_Value * parse_null_value(JSON_Context *ctx, const char **string) {
     size_t token_size = SIZEOF_TOKEN("null");
     if (strncmp("null", *string, token_size) == 0) {
         *string += token_size;
-        return json_value_init_null();
+        return json_value_init_null_ex(ctx);
     }
     return NULL;
 }
 
-/* Serialization */
+/* Serialization. Sizes are counted in size_t, so that a document of more than 2 GB is measured
+   and written as a whole where the address space allows it, SERIALIZE_FAILED on failure. */
+#define SERIALIZE_FAILED ((size_t)-1)
+
 #define APPEND_STRING(str) do { written = append_string(buf, (str));\
-                                if (written < 0) { return -1; }\
+                                if (written == SERIALIZE_FAILED) { return SERIALIZE_FAILED; }\
                                 if (buf != NULL) { buf += written; }\
                                 written_total += written; } while(0)
 
-#define APPEND_INDENT(level) do { written = append_indent(buf, (level));\
-                                  if (written < 0) { return -1; }\
-                                  if (buf != NULL) { buf += written; }\
-                                  written_total += written; } while(0)
-
-static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int level, int is_pretty, char *num_buf)
+#define WALK_APPEND(written_expr) do { written = (written_expr);\
+                                     if (written == SERIALIZE_FAILED) { goto error; }\
+                                     if (buf != NULL) { buf += written; }\
+                                     written_total += written; } while(0)
+
+/* The containers being written are kept on a walk stack rather than in recursive calls, the
+   indentation level is the depth of the stack plus level, that of value. With serialization_cache set, a document that
+   has not changed since it was last written is copied from its memo instead, and so are the
+   runs of members of large containers that have not changed. The runs written meanwhile are
+   pending until their container is known to be large, see json_value_memoize_runs. */
+static size_t json_serialize_value(const JSON_Context *ctx, const JSON_Value *value, char *buf, int is_pretty, size_t level, char *num_buf)
 {
-    const char *key = NULL, *string = NULL;
-    JSON_Value *temp_value = NULL;
-    JSON_Array *array = NULL;
-    JSON_Object *object = NULL;
-    size_t i = 0, count = 0;
-    double num = 0.0;
-    int written = -1, written_total = 0;
-    size_t len = 0;
-
-    switch (json_value_get_type(value)) {
-        case JSONArray:
-            array = json_value_get_array(value);
-            count = json_array_get_count(array);
-            APPEND_STRING("[");
-            if (count > 0 && is_pretty) {
-                APPEND_STRING("\n");
-            }
-            for (i = 0; i < count; i++) {
-                if (is_pretty) {
-                    APPEND_INDENT(level+1);
-                }
-                temp_value = json_array_get_value(array, i);
-                written = json_serialize_to_buffer_r(temp_value, buf, level+1, is_pretty, num_buf);
-                if (written < 0) {
-                    return -1;
-                }
-                if (buf != NULL) {
-                    buf += written;
+    JSON_Walk_Stack stack;
+    JSON_Walk_Frame *frame = NULL;
+    const JSON_Object *object = NULL;
+    const JSON_Array *array = NULL;
+    const double *number = NULL;
+    const JSON_Memo *memo = NULL;
+    const JSON_Memo_Run *run = NULL;
+    JSON_Memo_Runs pending;
+    size_t count = 0, separator = is_pretty ? 2 : 1; /* ",\n" between members */
+    size_t written = SERIALIZE_FAILED, written_total = 0, start = 0;
+    int caching = ctx->serialization_cache && buf != NULL;
+
+    walk_stack_init(&stack, (JSON_Context*)ctx); /* only its statistics are updated */
+    pending.runs = NULL;
+    pending.count = 0;
+    pending.capacity = 0;
+    for (;;) {
+        if (number != NULL) { /* member of an unboxed array */
+            WALK_APPEND(append_number(buf, num_buf, *number));
+            number = NULL;
+        } else switch (json_value_get_type(value)) {
+            case JSONArray:
+            case JSONObject: /* read in place, even when shared */
+                if (json_value_child_count(value) == 0) {
+                    WALK_APPEND(append_string(buf, value->type == JSONArray ? "[]" : "{}"));
+                    break;
                 }
-                written_total += written;
-                if (i < (count - 1)) {
-                    APPEND_STRING(",");
+                memo = ctx->serialization_cache ? *json_value_memo(value) : NULL;
+                if (memo != NULL && memo->text[is_pretty] != NULL &&
+                    memo->key[is_pretty] == MEMO_KEY(ctx, is_pretty, level + stack.count)) {
+                    if (buf != NULL) { /* terminated as the appends are */
+                        memcpy(buf, memo->text[is_pretty], memo->length[is_pretty]);
+                        buf[memo->length[is_pretty]] = '\0';
+                    }
+                    WALK_APPEND(memo->length[is_pretty]);
+                    break;
                 }
+                start = written_total;
+                WALK_APPEND(append_string(buf, value->type == JSONArray ? "[" : "{"));
                 if (is_pretty) {
-                    APPEND_STRING("\n");
+                    WALK_APPEND(append_string(buf, "\n"));
                 }
-            }
-            if (count > 0 && is_pretty) {
-                APPEND_INDENT(level);
-            }
-            APPEND_STRING("]");
-            return written_total;
-        case JSONObject:
-            object = json_value_get_object(value);
-            count  = json_object_get_count(object);
-            APPEND_STRING("{");
-            if (count > 0 && is_pretty) {
-                APPEND_STRING("\n");
-            }
-            for (i = 0; i < count; i++) {
-                key = json_object_get_name(object, i);
-                if (key == NULL) {
-                    return -1;
+                frame = walk_stack_push(&stack);
+                if (frame == NULL) {
+                    goto error;
                 }
-                if (is_pretty) {
-                    APPEND_INDENT(level+1);
+                frame->value = value;
+                frame->offset = start;
+                frame->pending = pending.count;
+                break;
+            case JSONString:
+                WALK_APPEND(json_serialize_string(ctx, value->value.string.chars, value->value.string.length, buf));
+                break;
+            case JSONBoolean:
+                WALK_APPEND(append_string(buf, value->value.boolean ? "true" : "false"));
+                break;
+            case JSONNumber:
+                if (value->type != JSONNumber) { /* written back as it was read */
+                    WALK_APPEND(append_string(buf, json_value_get_number_lexeme(value)));
+                    break;
                 }
-                /* We do not support key names with embedded \0 chars */
-                written = json_serialize_string(key, strlen(key), buf);
-                if (written < 0) {
-                    return -1;
+                WALK_APPEND(append_number(buf, num_buf, value->value.number));
+                break;
+            case JSONNull:
+                WALK_APPEND(append_string(buf, "null"));
+                break;
+            default:
+                goto error;
+        }
+        /* The value is complete: go on with the next member, closing the containers it ends */
+        for (;;) {
+            if (stack.count == 0) {
+                PARSON_FREE((JSON_Context*)ctx, pending.runs);
+                walk_stack_free(&stack);
+                return written_total;
+            }
+            frame = &stack.frames[stack.count - 1];
+            count = json_value_child_count(frame->value);
+            if (frame->index > 0) {
+                if (caching) {
+                    json_serialize_member_end((JSON_Context*)ctx, frame, &pending, buf, written_total, count, separator);
                 }
-                if (buf != NULL) {
-                    buf += written;
+                if (frame->index < count) {
+                    WALK_APPEND(append_string(buf, ","));
                 }
-                written_total += written;
-                APPEND_STRING(":");
                 if (is_pretty) {
-                    APPEND_STRING(" ");
+                    WALK_APPEND(append_string(buf, "\n"));
                 }
-                temp_value = json_object_get_value(object, key);
-                written = json_serialize_to_buffer_r(temp_value, buf, level+1, is_pretty, num_buf);
-                if (written < 0) {
-                    return -1;
+            }
+            if (frame->index < count) {
+                run = ctx->serialization_cache ? json_value_memo_run(frame->value, is_pretty, MEMO_KEY(ctx, is_pretty, level + stack.count - 1), frame->index) : NULL;
+                if (run == NULL) {
+                    frame->member = written_total;
+                    break;
                 }
+                start = written_total;
                 if (buf != NULL) {
-                    buf += written;
+                    memcpy(buf, run->text, run->length);
+                    buf[run->length] = '\0';
                 }
-                written_total += written;
-                if (i < (count - 1)) {
-                    APPEND_STRING(",");
-                }
-                if (is_pretty) {
-                    APPEND_STRING("\n");
+                WALK_APPEND(run->length);
+                if (caching && run->length < MEMO_RUN_LENGTH) { /* short, taken into the run being formed */
+                    if (frame->run_first == MEMO_NONE) {
+                        frame->run_first = frame->index;
+                        frame->run_offset = start;
+                    }
+                } else if (caching && frame->run_first != MEMO_NONE) {
+                    json_memo_pend((JSON_Context*)ctx, &pending, frame->run_first, frame->index - frame->run_first,
+                                   buf - (written_total - frame->run_offset), start - separator - frame->run_offset);
+                    frame->run_first = MEMO_NONE;
                 }
+                frame->index += run->count;
+                frame->member = MEMO_NONE;
+                continue;
             }
-            if (count > 0 && is_pretty) {
-                APPEND_INDENT(level);
-            }
-            APPEND_STRING("}");
-            return written_total;
-        case JSONString:
-            string = json_value_get_string(value);
-            if (string == NULL) {
-                return -1;
-            }
-            len = json_value_get_string_len(value);
-            written = json_serialize_string(string, len, buf);
-            if (written < 0) {
-                return -1;
+            if (is_pretty) {
+                WALK_APPEND(append_indent(buf, level + stack.count - 1));
             }
-            if (buf != NULL) {
-                buf += written;
+            WALK_APPEND(append_string(buf, frame->value->type == JSONArray ? "]" : "}"));
+            if (caching) { /* a memo that fails is only missing */
+                count = written_total - frame->offset;
+                if (count > MEMO_MAX_LENGTH) {
+                    json_value_memoize_runs(frame->value, &pending, frame->pending, is_pretty, MEMO_KEY(ctx, is_pretty, level + stack.count - 1));
+                } else if (stack.count == 1) {
+                    json_value_memoize(frame->value, buf - count, count, is_pretty, MEMO_KEY(ctx, is_pretty, level));
+                }
+                pending.count = frame->pending;
             }
-            written_total += written;
-            return written_total;
-        case JSONBoolean:
-            if (json_value_get_boolean(value)) {
-                APPEND_STRING("true");
+            stack.count--;
+        }
+        if (is_pretty) {
+            WALK_APPEND(append_indent(buf, level + stack.count));
+        }
+        if (frame->value->type == JSONArray) {
+            array = frame->value->value.array;
+            if (array->numbers != NULL) {
+                number = &array->numbers[frame->index];
             } else {
-                APPEND_STRING("false");
-            }
-            return written_total;
-        case JSONNumber:
-            num = json_value_get_number(value);
-            if (buf != NULL) {
-                num_buf = buf;
-            }
-            written = sprintf(num_buf, FLOAT_FORMAT, num);
-            if (written < 0) {
-                return -1;
-            }
-            if (buf != NULL) {
-                buf += written;
+                value = array->items[frame->index];
             }
-            written_total += written;
-            return written_total;
-        case JSONNull:
-            APPEND_STRING("null");
-            return written_total;
-        case JSONError:
-            return -1;
-        default:
-            return -1;
+        } else {
+            object = frame->value->value.object;
+            /* We do not support key names with embedded \0 chars */
+            WALK_APPEND(json_serialize_string(ctx, object->names[frame->index], strlen(object->names[frame->index]), buf));
+            WALK_APPEND(append_string(buf, is_pretty ? ": " : ":"));
+            value = object->values[frame->index];
+        }
+        frame->index++;
+    }
+error:
+    PARSON_FREE((JSON_Context*)ctx, pending.runs);
+    walk_stack_free(&stack);
+    return SERIALIZE_FAILED;
+}
+
+/* Member frame->index - 1 has just been written, ending at written_total, where buf is: it
+   joins the run being formed, closed once long enough or at the last member. A large member
+   has runs of its own and ends the run before it. */
+static void json_serialize_member_end(JSON_Context *ctx, JSON_Walk_Frame *frame, JSON_Memo_Runs *pending, const char *buf, size_t written_total, size_t count, size_t separator) {
+    size_t last = frame->index - 1;
+    if (frame->member != MEMO_NONE && written_total - frame->member > MEMO_MAX_LENGTH) {
+        if (frame->run_first != MEMO_NONE) {
+            json_memo_pend(ctx, pending, frame->run_first, last - frame->run_first,
+                           buf - (written_total - frame->run_offset), frame->member - separator - frame->run_offset);
+        }
+        frame->run_first = MEMO_NONE;
+        return;
+    }
+    if (frame->run_first == MEMO_NONE) {
+        if (frame->member == MEMO_NONE) {
+            return; /* a long run, copied */
+        }
+        frame->run_first = last;
+        frame->run_offset = frame->member;
+    }
+    if (written_total - frame->run_offset >= MEMO_RUN_LENGTH || frame->index == count) {
+        json_memo_pend(ctx, pending, frame->run_first, frame->index - frame->run_first,
+                       buf - (written_total - frame->run_offset), written_total - frame->run_offset);
+        frame->run_first = MEMO_NONE;
     }
 }
 
-static int json_serialize_string(const char *string, size_t len, char *buf) {
-    size_t i = 0;
-    char c = '\0';
-    int written = -1, written_total = 0;
+/* Escapes of the control characters, the other bytes that need one are '"', '\\' and '/' */
+static const char * const control_escapes[0x20] = {
+    "\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005", "\\u0006", "\\u0007",
+    "\\b",     "\\t",     "\\n",     "\\u000b", "\\f",     "\\r",     "\\u000e", "\\u000f",
+    "\\u0010", "\\u0011", "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017",
+    "\\u0018", "\\u0019", "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f"
+};
+
+/* 1 for bytes that are always escaped, 2 for the slash which is escaped on request */
+static const unsigned char escape_classes[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0
+    /* 0x60 and above: 0 */
+};
+
+static size_t json_serialize_string(const JSON_Context *ctx, const char *string, size_t len, char *buf) {
+    size_t written = SERIALIZE_FAILED, written_total = 0;
+    APPEND_STRING("\"");
+    written = json_serialize_chars(ctx, string, len, buf);
+    if (buf != NULL) {
+        buf += written;
+    }
+    written_total += written;
     APPEND_STRING("\"");
-    for (i = 0; i < len; i++) {
-        c = string[i];
-        switch (c) {
-            case '\"': APPEND_STRING("\\\""); break;
-            case '\\': APPEND_STRING("\\\\"); break;
-            case '\b': APPEND_STRING("\\b"); break;
-            case '\f': APPEND_STRING("\\f"); break;
-            case '\n': APPEND_STRING("\\n"); break;
-            case '\r': APPEND_STRING("\\r"); break;
-            case '\t': APPEND_STRING("\\t"); break;
-            case '\x00': APPEND_STRING("\\u0000"); break;
-            case '\x01': APPEND_STRING("\\u0001"); break;
-            case '\x02': APPEND_STRING("\\u0002"); break;
-            case '\x03': APPEND_STRING("\\u0003"); break;
-            case '\x04': APPEND_STRING("\\u0004"); break;
-            case '\x05': APPEND_STRING("\\u0005"); break;
-            case '\x06': APPEND_STRING("\\u0006"); break;
-            case '\x07': APPEND_STRING("\\u0007"); break;
-            /* '\x08' duplicate: '\b' */
-            /* '\x09' duplicate: '\t' */
-            /* '\x0a' duplicate: '\n' */
-            case '\x0b': APPEND_STRING("\\u000b"); break;
-            /* '\x0c' duplicate: '\f' */
-            /* '\x0d' duplicate: '\r' */
-            case '\x0e': APPEND_STRING("\\u000e"); break;
-            case '\x0f': APPEND_STRING("\\u000f"); break;
-            case '\x10': APPEND_STRING("\\u0010"); break;
-            case '\x11': APPEND_STRING("\\u0011"); break;
-            case '\x12': APPEND_STRING("\\u0012"); break;
-            case '\x13': APPEND_STRING("\\u0013"); break;
-            case '\x14': APPEND_STRING("\\u0014"); break;
-            case '\x15': APPEND_STRING("\\u0015"); break;
-            case '\x16': APPEND_STRING("\\u0016"); break;
-            case '\x17': APPEND_STRING("\\u0017"); break;
-            case '\x18': APPEND_STRING("\\u0018"); break;
-            case '\x19': APPEND_STRING("\\u0019"); break;
-            case '\x1a': APPEND_STRING("\\u001a"); break;
-            case '\x1b': APPEND_STRING("\\u001b"); break;
-            case '\x1c': APPEND_STRING("\\u001c"); break;
-            case '\x1d': APPEND_STRING("\\u001d"); break;
-            case '\x1e': APPEND_STRING("\\u001e"); break;
-            case '\x1f': APPEND_STRING("\\u001f"); break;
-            case '/':
-                if (parson_escape_slashes) {
-                    APPEND_STRING("\\/");  /* to make json embeddable in xml\/html */
-                } else {
-                    APPEND_STRING("/");
+    return written_total;
+}
+
+/* Escapes string without the quotes, 6 bytes per byte at most. Long clean runs are scanned a
+   word at a time and copied in bulk, escapes come from tables instead of going through sprintf. */
+static size_t json_serialize_chars(const JSON_Context *ctx, const char *string, size_t len, char *buf) {
+    const unsigned char *ptr = (const unsigned char*)string;
+    const unsigned char *end = ptr + len, *run = NULL;
+    unsigned char mask = ctx->escape_slashes ? 3 : 1;
+    unsigned long word = 0;
+    size_t run_len = 0, escape_len = 0;
+    const char *escape = NULL;
+    size_t written_total = 0;
+    while (ptr < end) {
+        run = ptr;
+        while (ptr < end && !(escape_classes[*ptr] & mask)) {
+            ptr++;
+            /* a long run, switch to whole words once aligned (the 68000 needs it) */
+            if ((size_t)(ptr - run) >= 8 && ((size_t)ptr % sizeof(unsigned long)) == 0) {
+                while ((size_t)(end - ptr) >= sizeof(unsigned long)) {
+                    word = *(const unsigned long*)ptr;
+                    if (SWAR_HAS_LESS(word, 0x20) || SWAR_HAS_BYTE(word, '\"') || SWAR_HAS_BYTE(word, '\\') ||
+                        (mask == 3 && SWAR_HAS_BYTE(word, '/'))) {
+                        break;
+                    }
+                    ptr += sizeof(unsigned long);
                 }
-                break;
-            default:
-                if (buf != NULL) {
-                    buf[0] = c;
-                    buf += 1;
+            }
+        }
+        run_len = ptr - run;
+        if (buf != NULL) {
+            if (run_len > 16) {
+                memcpy(buf, run, run_len);
+                buf += run_len;
+            } else { /* short runs between escapes, not worth a call */
+                while (run < ptr) {
+                    *buf++ = (char)*run++;
                 }
-                written_total += 1;
-                break;
+            }
+        }
+        written_total += run_len;
+        if (ptr == end) {
+            break;
         }
+        if (*ptr < 0x20) {
+            escape = control_escapes[*ptr];
+        } else if (*ptr == '\"') {
+            escape = "\\\"";
+        } else if (*ptr == '\\') {
+            escape = "\\\\";
+        } else {
+            escape = "\\/"; /* to make json embeddable in xml\/html */
+        }
+        escape_len = escape[1] == 'u' ? 6 : 2;
+        if (buf != NULL) {
+            while (*escape != '\0') {
+                *buf++ = *escape++;
+            }
+        }
+        written_total += escape_len;
+        ptr++;
     }
-    APPEND_STRING("\"");
     return written_total;
 }
 
-static int append_indent(char *buf, int level) {
-    int i;
-    int written = -1, written_total = 0;
+static size_t append_indent(char *buf, size_t level) {
+    size_t i;
+    size_t written = SERIALIZE_FAILED, written_total = 0;
     for (i = 0; i < level; i++) {
         APPEND_STRING("    ");
     }
     return written_total;
 }
 
-static int append_string(char *buf, const char *string) {
-    if (buf == NULL) {
-        return (int)strlen(string);
+static size_t append_string(char *buf, const char *string) {
+    size_t len = strlen(string);
+    if (buf != NULL) {
+        memcpy(buf, string, len + 1); /* terminated like sprintf did */
     }
-    return sprintf(buf, "%s", string);
+    return len;
 }
 
-#undef APPEND_STRING
-#undef APPEND_INDENT
+static size_t append_number(char *buf, char *num_buf, double number) {
+    int written = sprintf(buf != NULL ? buf : num_buf, FLOAT_FORMAT, number);
+    return written < 0 ? SERIALIZE_FAILED : (size_t)written;
+}
 
-/* Parser API */
-JSON_Value * json_parse_file(const char *filename) {
-    char *file_contents = read_file(filename);
-    JSON_Value *output_value = NULL;
-    if (file_contents == NULL) {
-        return NULL;
+/* Parallel serialization: the members of the top level container are shared out between jobs,
+   measured by all the jobs first, then written by all of them at their place in the one output
+   buffer. The jobs work on copies of the context without the cache and the statistics, which
+   are not safe to update from several tasks. */
+typedef struct json_serialize_job_t {
+    JSON_Context      ctx;
+    const JSON_Value *value;
+    size_t            first;  /* members [first, last) */
+    size_t            last;
+    int               is_pretty;
+    char             *buf;    /* NULL while measuring */
+    size_t            length;
+    int               failed;
+} JSON_Serialize_Job;
+
+/* Writes a separator without the null character, which would land on the next job's text */
+static size_t append_separator(char *buf, const char *separator, size_t len) {
+    if (buf != NULL) {
+        memcpy(buf, separator, len);
     }
-    output_value = json_parse_string(file_contents);
-    parson_free(file_contents);
-    return output_value;
+    return len;
 }
 
-JSON_Value * json_parse_file_with_comments(const char *filename) {
-    char *file_contents = read_file(filename);
+static void serialize_job(void *job_data) {
+    JSON_Serialize_Job *job = (JSON_Serialize_Job*)job_data;
+    const JSON_Array *array = NULL;
+    const JSON_Object *object = NULL;
+    char num_buf[NUM_BUF_SIZE];
+    char *buf = job->buf;
+    size_t i, count = json_value_child_count(job->value);
+    size_t written = SERIALIZE_FAILED, written_total = 0;
+    int is_pretty = job->is_pretty;
+
+    if (job->value->type == JSONArray) {
+        array = job->value->value.array;
+    } else {
+        object = job->value->value.object;
+    }
+    for (i = job->first; i < job->last; i++) {
+        if (is_pretty) {
+            WALK_APPEND(append_indent(buf, 1));
+        }
+        if (object != NULL) {
+            WALK_APPEND(json_serialize_string(&job->ctx, object->names[i], strlen(object->names[i]), buf));
+            WALK_APPEND(append_string(buf, is_pretty ? ": " : ":"));
+            WALK_APPEND(json_serialize_value(&job->ctx, object->values[i], buf, is_pretty, 1, num_buf));
+        } else if (array->numbers != NULL) {
+            WALK_APPEND(append_number(buf, num_buf, array->numbers[i]));
+        } else {
+            WALK_APPEND(json_serialize_value(&job->ctx, array->items[i], buf, is_pretty, 1, num_buf));
+        }
+        if (i + 1 < count) {
+            WALK_APPEND(append_separator(buf, ",", 1));
+        }
+        if (is_pretty) {
+            WALK_APPEND(append_separator(buf, "\n", 1));
+        }
+    }
+    job->length = written_total;
+    return;
+error:
+    job->failed = 1;
+}
+
+#undef APPEND_STRING
+#undef WALK_APPEND
+
+/* Parser API */
+static JSON_Value * parse_file(JSON_Context *ctx, const char *filename, int with_comments) {
+    char *file_contents = read_file(ctx, filename);
     JSON_Value *output_value = NULL;
     if (file_contents == NULL) {
         return NULL;
     }
-    output_value = json_parse_string_with_comments(file_contents);
-    parson_free(file_contents);
+    if (with_comments) {
+        json_strip_comments(file_contents); /* read_file returns a private copy */
+    }
+    output_value = parse_string(ctx, file_contents);
+    PARSON_FREE(ctx, file_contents);
     return output_value;
 }
 
-JSON_Value * json_parse_string(const char *string) {
+static JSON_Value * parse_string(JSON_Context *ctx, const char *string) {
+    JSON_Walk_Stack stack;
+    JSON_Value *value = NULL;
     if (string == NULL) {
         return NULL;
     }
+    if (ctx->validate_utf8 && !is_valid_utf8(string, strlen(string))) { /* whole input, once */
+        return NULL;
+    }
     if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
         string = string + 3; /* Support for UTF-8 BOM */
     }
-    return parse_value((const char**)&string, 0);
+    walk_stack_init(&stack, ctx);
+    value = parse_value(ctx, (const char**)&string, &stack);
+    walk_stack_free(&stack);
+    return value;
 }
 
-JSON_Value * json_parse_string_with_comments(const char *string) {
+static JSON_Value * parse_string_with_comments(JSON_Context *ctx, const char *string) {
     JSON_Value *result = NULL;
-    char *string_mutable_copy = NULL, *string_mutable_copy_ptr = NULL;
-    string_mutable_copy = parson_strdup(string);
-    if (string_mutable_copy == NULL) {
+    char *string_mutable_copy = NULL;
+    if (string == NULL) {
         return NULL;
     }
-    remove_comments(string_mutable_copy, "/*", "*/");
-    remove_comments(string_mutable_copy, "//", "\n");
-    string_mutable_copy_ptr = string_mutable_copy;
-    result = parse_value((const char**)&string_mutable_copy_ptr, 0);
-    parson_free(string_mutable_copy);
-    return result;
-}
-
-/* JSON Object API */
-
-JSON_Value * json_object_get_value(const JSON_Object *object, const char *name) {
-    if (object == NULL || name == NULL) {
+    string_mutable_copy = parson_strdup(ctx, string, JSONAllocInput);
+    if (string_mutable_copy == NULL) {
         return NULL;
     }
-    return json_object_getn_value(object, name, strlen(name));
+    json_strip_comments(string_mutable_copy);
+    result = parse_string(ctx, string_mutable_copy);
+    PARSON_FREE(ctx, string_mutable_copy);
+    return result;
 }
 
-const char * json_object_get_string(const JSON_Object *object, const char *name) {
-    return json_value_get_string(json_object_get_value(object, name));
+JSON_Value * json_parse_file(const char *filename) {
+    return parse_file(&parson_default_context, filename, 0);
 }
 
-size_t json_object_get_string_len(const JSON_Object *object, const char *name) {
-    return json_value_get_string_len(json_object_get_value(object, name));
+JSON_Value * json_parse_file_with_comments(const char *filename) {
+    return parse_file(&parson_default_context, filename, 1);
 }
 
-double json_object_get_number(const JSON_Object *object, const char *name) {
-    return json_value_get_number(json_object_get_value(object, name));
+JSON_Value * json_parse_string(const char *string) {
+    return parse_string(&parson_default_context, string);
 }
 
-JSON_Object * json_object_get_object(const JSON_Object *object, const char *name) {
-    return json_value_get_object(json_object_get_value(object, name));
+JSON_Value * json_parse_string_with_comments(const char *string) {
+    return parse_string_with_comments(&parson_default_context, string);
 }
 
-JSON_Array * json_object_get_array(const JSON_Object *object, const char *name) {
-    return json_value_get_array(json_object_get_value(object, name));
+JSON_Value * json_parse_file_ex(JSON_Context *ctx, const char *filename) {
+    ctx = PARSON_CONTEXT(ctx);
+    return parse_file(ctx, filename, ctx->with_comments);
 }
 
-int json_object_get_boolean(const JSON_Object *object, const char *name) {
-    return json_value_get_boolean(json_object_get_value(object, name));
+JSON_Value * json_parse_string_ex(JSON_Context *ctx, const char *string) {
+    ctx = PARSON_CONTEXT(ctx);
+    if (ctx->with_comments) {
+        return parse_string_with_comments(ctx, string);
+    }
+    return parse_string(ctx, string);
 }
 
-JSON_Value * json_object_dotget_value(const JSON_Object *object, const char *name) {
-    const char *dot_position = strchr(name, '.');
-    if (!dot_position) {
-        return json_object_get_value(object, name);
+/* Concatenated documents. The checks and skips of parse_string are done once for the input. */
+static JSON_Documents * documents_init(JSON_Context *ctx, const char *string, char *input) {
+    JSON_Documents *documents = NULL;
+    if (ctx->validate_utf8 && !is_valid_utf8(string, strlen(string))) {
+        PARSON_FREE(ctx, input);
+        return NULL;
     }
-    object = json_value_get_object(json_object_getn_value(object, name, dot_position - name));
-    return json_object_dotget_value(object, dot_position + 1);
+    documents = (JSON_Documents*)PARSON_MALLOC(ctx, JSONAllocStack, sizeof(JSON_Documents));
+    if (documents == NULL) {
+        PARSON_FREE(ctx, input);
+        return NULL;
+    }
+    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+        string = string + 3; /* Support for UTF-8 BOM */
+    }
+    documents->ctx = ctx;
+    documents->input = input;
+    documents->start = string;
+    documents->next = string;
+    documents->failed = 0;
+    walk_stack_init(&documents->stack, ctx);
+    return documents;
+}
+
+JSON_Documents * json_documents_new(JSON_Context *ctx, const char *string) {
+    char *input = NULL;
+    ctx = PARSON_CONTEXT(ctx);
+    if (string == NULL) {
+        return NULL;
+    }
+    if (ctx->with_comments) {
+        input = parson_strdup(ctx, string, JSONAllocInput);
+        if (input == NULL) {
+            return NULL;
+        }
+        json_strip_comments(input);
+        string = input;
+    }
+    return documents_init(ctx, string, input);
+}
+
+JSON_Documents * json_documents_new_file(JSON_Context *ctx, const char *filename) {
+    char *input = NULL;
+    ctx = PARSON_CONTEXT(ctx);
+    input = read_file(ctx, filename);
+    if (input == NULL) {
+        return NULL;
+    }
+    if (ctx->with_comments) {
+        json_strip_comments(input); /* read_file returns a private copy */
+    }
+    return documents_init(ctx, input, input);
+}
+
+JSON_Value * json_documents_next(JSON_Documents *documents) {
+    JSON_Value *value = NULL;
+    const char *string = NULL;
+    if (documents == NULL || documents->failed) {
+        return NULL;
+    }
+    string = documents->next;
+    SKIP_WHITESPACES(&string);
+    documents->next = string;
+    if (*string == '\0') {
+        return NULL;
+    }
+    value = parse_value(documents->ctx, &string, &documents->stack);
+    if (value == NULL) {
+        documents->failed = 1; /* the end of the document is unknown, no way to go on */
+        return NULL;
+    }
+    documents->next = string;
+    return value;
+}
+
+int json_documents_failed(const JSON_Documents *documents) {
+    return documents == NULL || documents->failed;
+}
+
+size_t json_documents_offset(const JSON_Documents *documents) {
+    return documents != NULL ? (size_t)(documents->next - documents->start) : 0;
+}
+
+void json_documents_free(JSON_Documents *documents) {
+    if (documents == NULL) {
+        return;
+    }
+    walk_stack_free(&documents->stack);
+    PARSON_FREE(documents->ctx, documents->input);
+    PARSON_FREE(documents->ctx, documents);
+}
+
+void json_strip_comments(char *string) {
+    if (string == NULL) {
+        return;
+    }
+    remove_comments(string, "/*", "*/");
+    remove_comments(string, "//", "\n");
+}
+
+/* JSON Object API */
+
+JSON_Value * json_object_get_value(const JSON_Object *object, const char *name) {
+    if (object == NULL || name == NULL) {
+        return NULL;
+    }
+    return json_object_getn_value(object, name, strlen(name));
+}
+
+const char * json_object_get_string(const JSON_Object *object, const char *name) {
+    return json_value_get_string(json_object_get_value(object, name));
+}
+
+size_t json_object_get_string_len(const JSON_Object *object, const char *name) {
+    return json_value_get_string_len(json_object_get_value(object, name));
+}
+
+double json_object_get_number(const JSON_Object *object, const char *name) {
+    return json_value_get_number(json_object_get_value(object, name));
+}
+
+JSON_Object * json_object_get_object(const JSON_Object *object, const char *name) {
+    return json_value_get_object(json_object_get_value(object, name));
+}
+
+JSON_Array * json_object_get_array(const JSON_Object *object, const char *name) {
+    return json_value_get_array(json_object_get_value(object, name));
+}
+
+int json_object_get_boolean(const JSON_Object *object, const char *name) {
+    return json_value_get_boolean(json_object_get_value(object, name));
+}
+
+JSON_Value * json_object_dotget_value(const JSON_Object *object, const char *name) {
+    const char *dot_position = strchr(name, '.');
+    if (!dot_position) {
+        return json_object_get_value(object, name);
+    }
+    object = json_value_get_object(json_object_getn_value(object, name, dot_position - name));
+    return json_object_dotget_value(object, dot_position + 1);
 }
 
 const char * json_object_dotget_string(const JSON_Object *object, const char *name) {
@@ -1272,6 +3135,9 @@ JSON_Value * json_array_get_value(const JSON_Array *array, size_t index) {
     if (array == NULL || index >= json_array_get_count(array)) {
         return NULL;
     }
+    if (array->numbers != NULL) { /* casting away const: the value only stands for the number */
+        return json_array_number_value(array->shared != NULL ? array->shared : (JSON_Array*)array, index);
+    }
     return array->items[index];
 }
 
@@ -1284,6 +3150,9 @@ size_t json_array_get_string_len(const JSON_Array *array, size_t index) {
 }
 
 double json_array_get_number(const JSON_Array *array, size_t index) {
+    if (array != NULL && array->numbers != NULL) {
+        return index < array->count ? array->numbers[index] : 0;
+    }
     return json_value_get_number(json_array_get_value(array, index));
 }
 
@@ -1307,9 +3176,32 @@ JSON_Value * json_array_get_wrapping_value(const JSON_Array *array) {
     return array->wrapping_value;
 }
 
+JSON_Status json_array_get_numbers(const JSON_Array *array, size_t index, double *numbers, size_t count) {
+    const JSON_Value *value = NULL;
+    size_t i;
+    if (array == NULL || numbers == NULL || index > array->count || count > array->count - index) {
+        return JSONFailure;
+    }
+    if (array->numbers != NULL) {
+        memcpy(numbers, array->numbers + index, count * sizeof(double));
+        return JSONSuccess;
+    }
+    for (i = 0; i < count; i++) {
+        value = array->items[index + i];
+        if (json_value_get_type(value) != JSONNumber) {
+            return JSONFailure;
+        }
+        numbers[i] = json_value_get_number(value);
+    }
+    return JSONSuccess;
+}
+
 /* JSON Value API */
 JSON_Value_Type json_value_get_type(const JSON_Value *value) {
-    return value ? value->type : JSONError;
+    if (value == NULL) {
+        return JSONError;
+    }
+    return value->type > JSONBoolean ? JSONNumber : value->type; /* number lexemes */
 }
 
 JSON_Object * json_value_get_object(const JSON_Value *value) {
@@ -1335,9 +3227,27 @@ size_t json_value_get_string_len(const JSON_Value *value) {
 }
 
 double json_value_get_number(const JSON_Value *value) {
+    const char *lexeme = json_value_get_number_lexeme(value);
+    if (lexeme != NULL) {
+        return strtod(lexeme, NULL);
+    }
     return json_value_get_type(value) == JSONNumber ? value->value.number : 0;
 }
 
+const char * json_value_get_number_lexeme(const JSON_Value *value) {
+    if (value == NULL) {
+        return NULL;
+    }
+    switch (value->type) {
+        case JSONNumberShort:
+            return value->value.lexeme;
+        case JSONNumberText:
+            return value->value.string.chars;
+        default:
+            return NULL;
+    }
+}
+
 int json_value_get_boolean(const JSON_Value *value) {
     return json_value_get_type(value) == JSONBoolean ? value->value.boolean : -1;
 }
@@ -1346,61 +3256,136 @@ JSON_Value * json_value_get_parent (const JSON_Value *value) {
     return value ? value->parent : NULL;
 }
 
+/* Frees the members before their container without recursing: the walk goes down to the last
+   member of the containers it empties and back up through the parent links. The containers
+   emptied this way are held by the value alone, shared ones are released to their sharers. */
 void json_value_free(JSON_Value *value) {
-    switch (json_value_get_type(value)) {
-        case JSONObject:
-            json_object_free(value->value.object);
-            break;
-        case JSONString:
-            parson_free(value->value.string.chars);
-            break;
-        case JSONArray:
-            json_array_free(value->value.array);
-            break;
-        default:
-            break;
+    JSON_Context *ctx = NULL;
+    JSON_Value *member = NULL, *parent = NULL;
+    JSON_Object *object = NULL;
+    JSON_Array *array = NULL;
+    if (value == NULL) {
+        return;
+    }
+    value->parent = NULL; /* where the walk ends */
+    while (value != NULL) {
+        ctx = value->ctx;
+        member = NULL;
+        if (value->type == JSONObject) {
+            object = value->value.object;
+            if (object->shared == NULL && object->sharer_count == 0 && object->count > 0) {
+                object->count--;
+                PARSON_FREE(ctx, object->names[object->count]);
+                member = object->values[object->count];
+            }
+        } else if (value->type == JSONArray) {
+            array = value->value.array;
+            while (member == NULL && array->shared == NULL && array->sharer_count == 0 &&
+                   array->count > 0 && array->items != NULL) {
+                array->count--;
+                member = array->items[array->count]; /* NULL for numbers never asked for */
+            }
+        }
+        if (member != NULL) {
+            value = member;
+            continue;
+        }
+        switch (value->type) {
+            case JSONObject:
+                if (!json_object_release(value)) {
+                    json_object_free(value->value.object); /* emptied */
+                }
+                break;
+            case JSONString:
+            case JSONNumberText:
+                PARSON_FREE(ctx, value->value.string.chars);
+                break;
+            case JSONArray:
+                if (!json_array_release(value)) {
+                    json_array_free(value->value.array);
+                }
+                break;
+            default:
+                break;
+        }
+        parent = value->parent;
+        PARSON_FREE(ctx, value);
+        value = parent;
     }
-    parson_free(value);
 }
 
 JSON_Value * json_value_init_object(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    return json_value_init_object_ex(NULL);
+}
+
+JSON_Value * json_value_init_array(void) {
+    return json_value_init_array_ex(NULL);
+}
+
+JSON_Value * json_value_init_string(const char *string) {
+    return json_value_init_string_ex(NULL, string);
+}
+
+JSON_Value * json_value_init_string_with_len(const char *string, size_t length) {
+    return json_value_init_string_with_len_ex(NULL, string, length);
+}
+
+JSON_Value * json_value_init_number(double number) {
+    return json_value_init_number_ex(NULL, number);
+}
+
+JSON_Value * json_value_init_boolean(int boolean) {
+    return json_value_init_boolean_ex(NULL, boolean);
+}
+
+JSON_Value * json_value_init_null(void) {
+    return json_value_init_null_ex(NULL);
+}
+
+JSON_Value * json_value_init_object_ex(JSON_Context *ctx) {
+    JSON_Value *new_value = NULL;
+    ctx = PARSON_CONTEXT(ctx);
+    new_value = (JSON_Value*)PARSON_MALLOC(ctx, JSONAllocValue, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
+    new_value->ctx = ctx;
     new_value->parent = NULL;
     new_value->type = JSONObject;
-    new_value->value.object = json_object_init(new_value);
+    new_value->value.object = json_object_init(ctx, new_value);
     if (!new_value->value.object) {
-        parson_free(new_value);
+        PARSON_FREE(ctx, new_value);
         return NULL;
     }
     return new_value;
 }
 
-JSON_Value * json_value_init_array(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+JSON_Value * json_value_init_array_ex(JSON_Context *ctx) {
+    JSON_Value *new_value = NULL;
+    ctx = PARSON_CONTEXT(ctx);
+    new_value = (JSON_Value*)PARSON_MALLOC(ctx, JSONAllocValue, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
+    new_value->ctx = ctx;
     new_value->parent = NULL;
     new_value->type = JSONArray;
-    new_value->value.array = json_array_init(new_value);
+    new_value->value.array = json_array_init(ctx, new_value);
     if (!new_value->value.array) {
-        parson_free(new_value);
+        PARSON_FREE(ctx, new_value);
         return NULL;
     }
     return new_value;
 }
 
-JSON_Value * json_value_init_string(const char *string) {
+JSON_Value * json_value_init_string_ex(JSON_Context *ctx, const char *string) {
     if (string == NULL) {
         return NULL;
     }
-    return json_value_init_string_with_len(string, strlen(string));
+    return json_value_init_string_with_len_ex(ctx, string, strlen(string));
 }
 
-JSON_Value * json_value_init_string_with_len(const char *string, size_t length) {
+JSON_Value * json_value_init_string_with_len_ex(JSON_Context *ctx, const char *string, size_t length) {
     char *copy = NULL;
     JSON_Value *value;
     if (string == NULL) {
@@ -1409,263 +3394,1077 @@ JSON_Value * json_value_init_string_with_len(const char *string, size_t length)
     if (!is_valid_utf8(string, length)) {
         return NULL;
     }
-    copy = parson_strndup(string, length);
+    ctx = PARSON_CONTEXT(ctx);
+    copy = parson_strndup(ctx, string, length, JSONAllocString);
     if (copy == NULL) {
         return NULL;
     }
-    value = json_value_init_string_no_copy(copy, length);
+    value = json_value_init_string_no_copy(ctx, copy, length);
     if (value == NULL) {
-        parson_free(copy);
+        PARSON_FREE(ctx, copy);
     }
     return value;
 }
 
-JSON_Value * json_value_init_number(double number) {
+char * json_alloc_input_ex(JSON_Context *ctx, size_t length) {
+    if (length == (size_t)-1) {
+        return NULL;
+    }
+    ctx = PARSON_CONTEXT(ctx);
+    return (char*)PARSON_MALLOC(ctx, JSONAllocInput, length + 1);
+}
+
+char * json_alloc_string_ex(JSON_Context *ctx, size_t length) {
+    if (length == (size_t)-1) {
+        return NULL;
+    }
+    ctx = PARSON_CONTEXT(ctx);
+    return (char*)PARSON_MALLOC(ctx, JSONAllocString, length + 1);
+}
+
+JSON_Value * json_value_init_string_no_copy_ex(JSON_Context *ctx, char *string, size_t length) {
+    if (string == NULL) {
+        return NULL;
+    }
+    string[length] = '\0';
+    return json_value_init_string_no_copy(PARSON_CONTEXT(ctx), string, length);
+}
+
+JSON_Value * json_value_init_number_ex(JSON_Context *ctx, double number) {
     JSON_Value *new_value = NULL;
     if (IS_NUMBER_INVALID(number)) {
         return NULL;
     }
-    new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    ctx = PARSON_CONTEXT(ctx);
+    new_value = (JSON_Value*)PARSON_MALLOC(ctx, JSONAllocValue, sizeof(JSON_Value));
     if (new_value == NULL) {
         return NULL;
     }
+    new_value->ctx = ctx;
     new_value->parent = NULL;
     new_value->type = JSONNumber;
     new_value->value.number = number;
     return new_value;
 }
 
-JSON_Value * json_value_init_boolean(int boolean) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+JSON_Value * json_value_init_boolean_ex(JSON_Context *ctx, int boolean) {
+    JSON_Value *new_value = NULL;
+    ctx = PARSON_CONTEXT(ctx);
+    new_value = (JSON_Value*)PARSON_MALLOC(ctx, JSONAllocValue, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
+    new_value->ctx = ctx;
     new_value->parent = NULL;
     new_value->type = JSONBoolean;
     new_value->value.boolean = boolean ? 1 : 0;
     return new_value;
 }
 
-JSON_Value * json_value_init_null(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+JSON_Value * json_value_init_null_ex(JSON_Context *ctx) {
+    JSON_Value *new_value = NULL;
+    ctx = PARSON_CONTEXT(ctx);
+    new_value = (JSON_Value*)PARSON_MALLOC(ctx, JSONAllocValue, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
+    new_value->ctx = ctx;
     new_value->parent = NULL;
     new_value->type = JSONNull;
     return new_value;
 }
 
 JSON_Value * json_value_deep_copy(const JSON_Value *value) {
-    size_t i = 0;
-    JSON_Value *return_value = NULL, *temp_value_copy = NULL, *temp_value = NULL;
-    const JSON_String *temp_string = NULL;
-    const char *temp_key = NULL;
-    char *temp_string_copy = NULL;
-    JSON_Array *temp_array = NULL, *temp_array_copy = NULL;
-    JSON_Object *temp_object = NULL, *temp_object_copy = NULL;
+    return json_value_deep_copy_ex(NULL, value);
+}
 
+JSON_Value * json_value_deep_copy_ex(JSON_Context *ctx, const JSON_Value *value) {
+    ctx = PARSON_CONTEXT(ctx);
     switch (json_value_get_type(value)) {
         case JSONArray:
-            temp_array = json_value_get_array(value);
-            return_value = json_value_init_array();
-            if (return_value == NULL) {
-                return NULL;
+            if (ctx == value->value.array->ctx) { /* copy-on-write */
+                return json_array_share(value->value.array);
             }
-            temp_array_copy = json_value_get_array(return_value);
-            for (i = 0; i < json_array_get_count(temp_array); i++) {
-                temp_value = json_array_get_value(temp_array, i);
-                temp_value_copy = json_value_deep_copy(temp_value);
-                if (temp_value_copy == NULL) {
-                    json_value_free(return_value);
-                    return NULL;
-                }
-                if (json_array_add(temp_array_copy, temp_value_copy) == JSONFailure) {
-                    json_value_free(return_value);
-                    json_value_free(temp_value_copy);
-                    return NULL;
-                }
-            }
-            return return_value;
+            return json_value_copy_tree(ctx, value);
         case JSONObject:
-            temp_object = json_value_get_object(value);
-            return_value = json_value_init_object();
-            if (return_value == NULL) {
-                return NULL;
+            if (ctx == value->value.object->ctx) {
+                return json_object_share(value->value.object);
             }
-            temp_object_copy = json_value_get_object(return_value);
-            for (i = 0; i < json_object_get_count(temp_object); i++) {
-                temp_key = json_object_get_name(temp_object, i);
-                temp_value = json_object_get_value(temp_object, temp_key);
-                temp_value_copy = json_value_deep_copy(temp_value);
-                if (temp_value_copy == NULL) {
-                    json_value_free(return_value);
-                    return NULL;
-                }
-                if (json_object_add(temp_object_copy, temp_key, temp_value_copy) == JSONFailure) {
-                    json_value_free(return_value);
-                    json_value_free(temp_value_copy);
-                    return NULL;
-                }
-            }
-            return return_value;
-        case JSONBoolean:
-            return json_value_init_boolean(json_value_get_boolean(value));
-        case JSONNumber:
-            return json_value_init_number(json_value_get_number(value));
-        case JSONString:
-            temp_string = json_value_get_string_desc(value);
-            if (temp_string == NULL) {
-                return NULL;
-            }
-            temp_string_copy = parson_strndup(temp_string->chars, temp_string->length);
-            if (temp_string_copy == NULL) {
-                return NULL;
-            }
-            return_value = json_value_init_string_no_copy(temp_string_copy, temp_string->length);
-            if (return_value == NULL) {
-                parson_free(temp_string_copy);
-            }
-            return return_value;
-        case JSONNull:
-            return json_value_init_null();
-        case JSONError:
-            return NULL;
+            return json_value_copy_tree(ctx, value);
         default:
-            return NULL;
+            return json_value_copy_node(ctx, value);
     }
 }
 
-size_t json_serialization_size(const JSON_Value *value) {
-    char num_buf[NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
-    int res = json_serialize_to_buffer_r(value, NULL, 0, 0, num_buf);
-    return res < 0 ? 0 : (size_t)(res) + 1;
+/* Serialization API */
+static size_t serialization_size(const JSON_Context *ctx, const JSON_Value *value, int is_pretty) {
+    char num_buf[NUM_BUF_SIZE];
+    size_t res = json_serialize_value(ctx, value, NULL, is_pretty, 0, num_buf);
+    return res == SERIALIZE_FAILED ? 0 : res + 1;
+}
+
+static JSON_Status serialize_to_buffer(const JSON_Context *ctx, const JSON_Value *value, char *buf, size_t buf_size_in_bytes, int is_pretty) {
+    size_t written = SERIALIZE_FAILED;
+    size_t needed_size_in_bytes = serialization_size(ctx, value, is_pretty);
+    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
+        return JSONFailure;
+    }
+    written = json_serialize_value(ctx, value, buf, is_pretty, 0, NULL);
+    if (written == SERIALIZE_FAILED) {
+        return JSONFailure;
+    }
+    return JSONSuccess;
+}
+
+static char * serialize_to_string(JSON_Context *ctx, const JSON_Value *value, int is_pretty) {
+    JSON_Status serialization_result = JSONFailure;
+    size_t buf_size_bytes = serialization_size(ctx, value, is_pretty);
+    char *buf = NULL;
+    if (buf_size_bytes == 0) {
+        return NULL;
+    }
+    buf = (char*)PARSON_MALLOC(ctx, JSONAllocSerializer, buf_size_bytes);
+    if (buf == NULL) {
+        return NULL;
+    }
+    serialization_result = serialize_to_buffer(ctx, value, buf, buf_size_bytes, is_pretty);
+    if (serialization_result == JSONFailure) {
+        PARSON_FREE(ctx, buf);
+        return NULL;
+    }
+    return buf;
+}
+
+static JSON_Status serialize_to_file(JSON_Context *ctx, const JSON_Value *value, const char *filename, int is_pretty) {
+    JSON_Status return_code = JSONSuccess;
+    FILE *fp = NULL;
+    char *serialized_string = serialize_to_string(ctx, value, is_pretty);
+    if (serialized_string == NULL) {
+        return JSONFailure;
+    }
+    fp = fopen(filename, "w");
+    if (fp == NULL) {
+        PARSON_FREE(ctx, serialized_string);
+        return JSONFailure;
+    }
+    if (fputs(serialized_string, fp) == EOF) {
+        return_code = JSONFailure;
+    }
+    if (fclose(fp) == EOF) {
+        return_code = JSONFailure;
+    }
+    PARSON_FREE(ctx, serialized_string);
+    return return_code;
+}
+
+static void run_jobs_in_order(void *runner_data, JSON_Job_Function job_fun, void **jobs, size_t count) {
+    size_t i;
+    (void)runner_data;
+    for (i = 0; i < count; i++) {
+        job_fun(jobs[i]);
+    }
+}
+
+static char * serialize_to_string_parallel(JSON_Context *ctx, const JSON_Value *value, int is_pretty,
+                                           size_t job_count, JSON_Job_Runner run_fun, void *runner_data) {
+    JSON_Serialize_Job *jobs = NULL;
+    void **job_ptrs = NULL;
+    size_t i, count = 0, size = 0, first = 0;
+    char *buf = NULL, *out = NULL;
+    int failed = 0;
+
+    if (value != NULL && (value->type == JSONArray || value->type == JSONObject)) {
+        count = json_value_child_count(value);
+    }
+    if (job_count > count) {
+        job_count = count;
+    }
+    if (job_count < 2) {
+        return serialize_to_string(ctx, value, is_pretty);
+    }
+    jobs = (JSON_Serialize_Job*)PARSON_MALLOC(ctx, JSONAllocSerializer, job_count * sizeof(JSON_Serialize_Job));
+    job_ptrs = (void**)PARSON_MALLOC(ctx, JSONAllocSerializer, job_count * sizeof(void*));
+    if (jobs == NULL || job_ptrs == NULL) {
+        goto done;
+    }
+    for (i = 0; i < job_count; i++) { /* count / job_count members each, one more for the first ones */
+        jobs[i].ctx = *ctx;
+        jobs[i].ctx.serialization_cache = 0;
+        jobs[i].ctx.scratch = NULL;
+        jobs[i].ctx.scratch_capacity = 0;
+#ifdef PARSON_STATS
+        jobs[i].ctx.stats_enabled = 0;
+#endif
+        jobs[i].value = value;
+        jobs[i].first = first;
+        jobs[i].last = first = first + count / job_count + (i < count % job_count ? 1 : 0);
+        jobs[i].is_pretty = is_pretty;
+        jobs[i].buf = NULL;
+        jobs[i].length = 0;
+        jobs[i].failed = 0;
+        job_ptrs[i] = &jobs[i];
+    }
+    if (run_fun == NULL) {
+        run_fun = run_jobs_in_order;
+    }
+    run_fun(runner_data, serialize_job, job_ptrs, job_count);
+    size = is_pretty ? 4 : 3; /* "[\n", "]" and the null character */
+    for (i = 0; i < job_count; i++) {
+        failed |= jobs[i].failed;
+        size += jobs[i].length;
+    }
+    if (failed || (buf = (char*)PARSON_MALLOC(ctx, JSONAllocSerializer, size)) == NULL) {
+        goto done;
+    }
+    out = buf;
+    *out++ = value->type == JSONArray ? '[' : '{';
+    if (is_pretty) {
+        *out++ = '\n';
+    }
+    for (i = 0; i < job_count; i++) {
+        jobs[i].buf = out;
+        out += jobs[i].length;
+    }
+    run_fun(runner_data, serialize_job, job_ptrs, job_count);
+    for (i = 0; i < job_count; i++) {
+        failed |= jobs[i].failed || jobs[i].buf + jobs[i].length != (i + 1 < job_count ? jobs[i + 1].buf : out);
+    }
+    if (failed) {
+        PARSON_FREE(ctx, buf);
+        buf = NULL;
+        goto done;
+    }
+    *out++ = value->type == JSONArray ? ']' : '}';
+    *out = '\0';
+done:
+    PARSON_FREE(ctx, job_ptrs);
+    PARSON_FREE(ctx, jobs);
+    return buf;
+}
+
+size_t json_serialization_size(const JSON_Value *value) {
+    return serialization_size(&parson_default_context, value, 0);
+}
+
+JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
+    return serialize_to_buffer(&parson_default_context, value, buf, buf_size_in_bytes, 0);
+}
+
+JSON_Status json_serialize_to_file(const JSON_Value *value, const char *filename) {
+    return serialize_to_file(&parson_default_context, value, filename, 0);
+}
+
+char * json_serialize_to_string(const JSON_Value *value) {
+    return serialize_to_string(&parson_default_context, value, 0);
+}
+
+size_t json_serialization_size_pretty(const JSON_Value *value) {
+    return serialization_size(&parson_default_context, value, 1);
+}
+
+JSON_Status json_serialize_to_buffer_pretty(const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
+    return serialize_to_buffer(&parson_default_context, value, buf, buf_size_in_bytes, 1);
+}
+
+JSON_Status json_serialize_to_file_pretty(const JSON_Value *value, const char *filename) {
+    return serialize_to_file(&parson_default_context, value, filename, 1);
+}
+
+char * json_serialize_to_string_pretty(const JSON_Value *value) {
+    return serialize_to_string(&parson_default_context, value, 1);
+}
+
+void json_free_serialized_string(char *string) {
+    PARSON_FREE(&parson_default_context, string);
+}
+
+size_t json_serialization_size_ex(const JSON_Context *ctx, const JSON_Value *value, int is_pretty) {
+    return serialization_size(PARSON_CONTEXT(ctx), value, is_pretty);
+}
+
+JSON_Status json_serialize_to_buffer_ex(const JSON_Context *ctx, const JSON_Value *value, char *buf, size_t buf_size_in_bytes, int is_pretty) {
+    return serialize_to_buffer(PARSON_CONTEXT(ctx), value, buf, buf_size_in_bytes, is_pretty);
+}
+
+JSON_Status json_serialize_to_file_ex(JSON_Context *ctx, const JSON_Value *value, const char *filename, int is_pretty) {
+    return serialize_to_file(PARSON_CONTEXT(ctx), value, filename, is_pretty);
+}
+
+char * json_serialize_to_string_ex(JSON_Context *ctx, const JSON_Value *value, int is_pretty) {
+    return serialize_to_string(PARSON_CONTEXT(ctx), value, is_pretty);
+}
+
+void json_free_serialized_string_ex(JSON_Context *ctx, char *string) {
+    PARSON_FREE(PARSON_CONTEXT(ctx), string);
+}
+
+char * json_serialize_to_string_parallel_ex(JSON_Context *ctx, const JSON_Value *value, int is_pretty,
+                                            size_t jobs, JSON_Job_Runner run_fun, void *runner_data) {
+    return serialize_to_string_parallel(PARSON_CONTEXT(ctx), value, is_pretty, jobs, run_fun, runner_data);
+}
+
+/* Streaming writer */
+static JSON_Status writer_fail(JSON_Writer *writer) {
+    writer->failed = 1;
+    return JSONFailure;
+}
+
+static JSON_Status writer_flush(JSON_Writer *writer) {
+    size_t length = writer->length;
+    writer->length = 0;
+    if (length > 0 && writer->write_fun(writer->sink_data, writer->buffer, length) != JSONSuccess) {
+        return writer_fail(writer);
+    }
+    return JSONSuccess;
+}
+
+/* Room for size bytes in the buffer, size is WRITER_BUFFER_SIZE at most */
+static char * writer_reserve(JSON_Writer *writer, size_t size) {
+    if (WRITER_BUFFER_SIZE - writer->length < size && writer_flush(writer) == JSONFailure) {
+        return NULL;
+    }
+    return writer->buffer + writer->length;
+}
+
+static JSON_Status writer_put(JSON_Writer *writer, const char *data, size_t length) {
+    char *out = NULL;
+    if (length > WRITER_BUFFER_SIZE) { /* not worth copying */
+        if (writer_flush(writer) == JSONFailure) {
+            return JSONFailure;
+        }
+        if (writer->write_fun(writer->sink_data, data, length) != JSONSuccess) {
+            return writer_fail(writer);
+        }
+        return JSONSuccess;
+    }
+    out = writer_reserve(writer, length);
+    if (out == NULL) {
+        return JSONFailure;
+    }
+    memcpy(out, data, length);
+    writer->length += length;
+    return JSONSuccess;
+}
+
+static JSON_Status writer_newline(JSON_Writer *writer) {
+    size_t i;
+    if (writer_put(writer, "\n", 1) == JSONFailure) {
+        return JSONFailure;
+    }
+    for (i = 0; i < writer->depth; i++) {
+        if (writer_put(writer, "    ", 4) == JSONFailure) {
+            return JSONFailure;
+        }
+    }
+    return JSONSuccess;
+}
+
+/* Checks that a key or a value can come next and writes what goes before it. Nothing is written
+   when it cannot. */
+static JSON_Status writer_begin(JSON_Writer *writer, int is_key) {
+    unsigned char *level = NULL;
+    if (writer->failed) {
+        return JSONFailure;
+    }
+    if (writer->depth == 0) {
+        return is_key || writer->done ? JSONFailure : JSONSuccess;
+    }
+    level = &writer->levels[writer->depth - 1];
+    if (*level & WRITER_KEY) { /* value of the key */
+        if (is_key) {
+            return JSONFailure;
+        }
+        *level &= ~WRITER_KEY;
+        return JSONSuccess;
+    }
+    if (((*level & WRITER_OBJECT) != 0) != (is_key != 0)) {
+        return JSONFailure;
+    }
+    if ((*level & WRITER_MEMBERS) && writer_put(writer, ",", 1) == JSONFailure) {
+        return JSONFailure;
+    }
+    *level |= is_key ? WRITER_MEMBERS | WRITER_KEY : WRITER_MEMBERS;
+    if (writer->is_pretty) {
+        return writer_newline(writer);
+    }
+    return JSONSuccess;
+}
+
+static void writer_end(JSON_Writer *writer) {
+    if (writer->depth == 0) {
+        writer->done = 1;
+    }
+}
+
+static JSON_Status writer_open(JSON_Writer *writer, int is_object) {
+    unsigned char *new_levels = NULL;
+    if (writer->failed || writer->depth >= writer->ctx->max_nesting) {
+        return JSONFailure;
+    }
+    if (writer->depth >= writer->capacity) {
+        new_levels = (unsigned char*)PARSON_MALLOC(writer->ctx, JSONAllocStack, writer->capacity * 2);
+        if (new_levels == NULL) {
+            return writer_fail(writer);
+        }
+        memcpy(new_levels, writer->levels, writer->depth);
+        if (writer->levels != writer->inline_levels) {
+            PARSON_FREE(writer->ctx, writer->levels);
+        }
+        writer->levels = new_levels;
+        writer->capacity *= 2;
+    }
+    if (writer_begin(writer, 0) == JSONFailure ||
+        writer_put(writer, is_object ? "{" : "[", 1) == JSONFailure) {
+        return JSONFailure;
+    }
+    writer->levels[writer->depth] = is_object ? WRITER_OBJECT : 0;
+    writer->depth++;
+    return JSONSuccess;
+}
+
+static JSON_Status writer_close(JSON_Writer *writer, int is_object) {
+    unsigned char level = 0;
+    if (writer->failed || writer->depth == 0) {
+        return JSONFailure;
+    }
+    level = writer->levels[writer->depth - 1];
+    if (((level & WRITER_OBJECT) != 0) != (is_object != 0) || (level & WRITER_KEY)) {
+        return JSONFailure;
+    }
+    writer->depth--;
+    if ((level & WRITER_MEMBERS) && writer->is_pretty && writer_newline(writer) == JSONFailure) {
+        return JSONFailure;
+    }
+    if (writer_put(writer, is_object ? "}" : "]", 1) == JSONFailure) {
+        return JSONFailure;
+    }
+    writer_end(writer);
+    return JSONSuccess;
+}
+
+/* Escaped in chunks straight into the buffer, whatever the length of the string */
+static JSON_Status writer_string(JSON_Writer *writer, const char *string, size_t length) {
+    size_t chunk = 0;
+    char *out = NULL;
+    if (writer_put(writer, "\"", 1) == JSONFailure) {
+        return JSONFailure;
+    }
+    while (length > 0) {
+        chunk = MIN(length, WRITER_CHUNK);
+        out = writer_reserve(writer, chunk * 6);
+        if (out == NULL) {
+            return JSONFailure;
+        }
+        writer->length += json_serialize_chars(writer->ctx, string, chunk, out);
+        string += chunk;
+        length -= chunk;
+    }
+    return writer_put(writer, "\"", 1);
+}
+
+static JSON_Status writer_file_write(void *sink_data, const char *data, size_t length) {
+    return fwrite(data, 1, length, (FILE*)sink_data) == length ? JSONSuccess : JSONFailure;
+}
+
+JSON_Writer * json_writer_new(JSON_Context *ctx, JSON_Writer_Function write_fun, void *sink_data, int is_pretty) {
+    JSON_Writer *writer = NULL;
+    ctx = PARSON_CONTEXT(ctx);
+    if (write_fun == NULL) {
+        return NULL;
+    }
+    writer = (JSON_Writer*)PARSON_MALLOC(ctx, JSONAllocSerializer, sizeof(JSON_Writer) + WRITER_BUFFER_SIZE);
+    if (writer == NULL) {
+        return NULL;
+    }
+    writer->ctx = ctx;
+    writer->write_fun = write_fun;
+    writer->sink_data = sink_data;
+    writer->fp = NULL;
+    writer->is_pretty = is_pretty;
+    writer->failed = 0;
+    writer->done = 0;
+    writer->levels = writer->inline_levels;
+    writer->depth = 0;
+    writer->capacity = WALK_STACK_INLINE;
+    writer->buffer = (char*)(writer + 1);
+    writer->length = 0;
+    return writer;
+}
+
+JSON_Writer * json_writer_new_file(JSON_Context *ctx, const char *filename, int is_pretty) {
+    JSON_Writer *writer = NULL;
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL) {
+        return NULL;
+    }
+    writer = json_writer_new(ctx, writer_file_write, fp, is_pretty);
+    if (writer == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    writer->fp = fp;
+    return writer;
+}
+
+JSON_Status json_writer_begin_object(JSON_Writer *writer) {
+    return writer != NULL ? writer_open(writer, 1) : JSONFailure;
+}
+
+JSON_Status json_writer_end_object(JSON_Writer *writer) {
+    return writer != NULL ? writer_close(writer, 1) : JSONFailure;
+}
+
+JSON_Status json_writer_begin_array(JSON_Writer *writer) {
+    return writer != NULL ? writer_open(writer, 0) : JSONFailure;
+}
+
+JSON_Status json_writer_end_array(JSON_Writer *writer) {
+    return writer != NULL ? writer_close(writer, 0) : JSONFailure;
+}
+
+JSON_Status json_writer_key(JSON_Writer *writer, const char *name) {
+    size_t len = 0;
+    if (writer == NULL || name == NULL) {
+        return JSONFailure;
+    }
+    len = strlen(name);
+    if (!is_valid_utf8(name, len) || writer_begin(writer, 1) == JSONFailure ||
+        writer_string(writer, name, len) == JSONFailure) {
+        return JSONFailure;
+    }
+    return writer_put(writer, writer->is_pretty ? ": " : ":", writer->is_pretty ? 2 : 1);
+}
+
+JSON_Status json_writer_string(JSON_Writer *writer, const char *string) {
+    if (string == NULL) {
+        return JSONFailure;
+    }
+    return json_writer_string_with_len(writer, string, strlen(string));
+}
+
+JSON_Status json_writer_string_with_len(JSON_Writer *writer, const char *string, size_t len) {
+    if (writer == NULL || string == NULL || !is_valid_utf8(string, len) ||
+        writer_begin(writer, 0) == JSONFailure || writer_string(writer, string, len) == JSONFailure) {
+        return JSONFailure;
+    }
+    writer_end(writer);
+    return JSONSuccess;
+}
+
+JSON_Status json_writer_number(JSON_Writer *writer, double number) {
+    char *out = NULL;
+    if (writer == NULL || IS_NUMBER_INVALID(number) || writer_begin(writer, 0) == JSONFailure) {
+        return JSONFailure;
+    }
+    out = writer_reserve(writer, NUM_BUF_SIZE);
+    if (out == NULL) {
+        return JSONFailure;
+    }
+    writer->length += sprintf(out, FLOAT_FORMAT, number);
+    writer_end(writer);
+    return JSONSuccess;
+}
+
+/* Checked like the parser checks lexemes, so that a number read from a document is written back
+   unchanged, or converted when it is one of the forms the parser lets through, such as "1." */
+JSON_Status json_writer_number_text(JSON_Writer *writer, const char *text, size_t len) {
+    if (writer == NULL || text == NULL || len == 0 || scan_number(text) != len) {
+        return JSONFailure;
+    }
+    if (!is_json_number(text, len)) {
+        return json_writer_number(writer, strtod(text, NULL));
+    }
+    if (writer_begin(writer, 0) == JSONFailure || writer_put(writer, text, len) == JSONFailure) {
+        return JSONFailure;
+    }
+    writer_end(writer);
+    return JSONSuccess;
+}
+
+JSON_Status json_writer_boolean(JSON_Writer *writer, int boolean) {
+    if (writer == NULL || writer_begin(writer, 0) == JSONFailure ||
+        writer_put(writer, boolean ? "true" : "false", boolean ? 4 : 5) == JSONFailure) {
+        return JSONFailure;
+    }
+    writer_end(writer);
+    return JSONSuccess;
+}
+
+JSON_Status json_writer_null(JSON_Writer *writer) {
+    if (writer == NULL || writer_begin(writer, 0) == JSONFailure || writer_put(writer, "null", 4) == JSONFailure) {
+        return JSONFailure;
+    }
+    writer_end(writer);
+    return JSONSuccess;
+}
+
+/* Serialized at the depth of the writer, so that pretty output is indented alike */
+JSON_Status json_writer_value(JSON_Writer *writer, const JSON_Value *value) {
+    char num_buf[NUM_BUF_SIZE];
+    char *out = NULL, *temp = NULL;
+    size_t size = SERIALIZE_FAILED;
+    JSON_Status status = JSONSuccess;
+    if (writer == NULL || value == NULL || writer->failed) {
+        return JSONFailure;
+    }
+    size = json_serialize_value(writer->ctx, value, NULL, writer->is_pretty, writer->depth, num_buf);
+    if (size == SERIALIZE_FAILED || writer_begin(writer, 0) == JSONFailure) {
+        return JSONFailure;
+    }
+    if (size < WRITER_BUFFER_SIZE) { /* and its terminating \0 */
+        out = writer_reserve(writer, size + 1);
+        if (out == NULL) {
+            return JSONFailure;
+        }
+        json_serialize_value(writer->ctx, value, out, writer->is_pretty, writer->depth, NULL);
+        writer->length += size;
+    } else {
+        temp = (char*)PARSON_MALLOC(writer->ctx, JSONAllocSerializer, size + 1);
+        if (temp == NULL) {
+            return writer_fail(writer);
+        }
+        json_serialize_value(writer->ctx, value, temp, writer->is_pretty, writer->depth, NULL);
+        status = writer_put(writer, temp, size);
+        PARSON_FREE(writer->ctx, temp);
+        if (status == JSONFailure) {
+            return JSONFailure;
+        }
+    }
+    writer_end(writer);
+    return JSONSuccess;
+}
+
+JSON_Status json_writer_flush(JSON_Writer *writer) {
+    if (writer == NULL || writer->failed) {
+        return JSONFailure;
+    }
+    if (writer_flush(writer) == JSONFailure) {
+        return JSONFailure;
+    }
+    if (writer->fp != NULL && fflush(writer->fp) == EOF) {
+        return writer_fail(writer);
+    }
+    return JSONSuccess;
+}
+
+JSON_Status json_writer_finish(JSON_Writer *writer) {
+    if (json_writer_flush(writer) == JSONFailure || !writer->done) {
+        return JSONFailure;
+    }
+    return JSONSuccess;
+}
+
+void json_writer_free(JSON_Writer *writer) {
+    if (writer == NULL) {
+        return;
+    }
+    if (writer->levels != writer->inline_levels) {
+        PARSON_FREE(writer->ctx, writer->levels);
+    }
+    if (writer->fp != NULL) {
+        fclose(writer->fp);
+    }
+    PARSON_FREE(writer->ctx, writer);
+}
+
+/* Streaming reader */
+static JSON_Token reader_fail(JSON_Reader *reader) {
+    reader->failed = 1;
+    return JSONTokenError;
+}
+
+/* Returns 0 when the source has nothing more */
+static int reader_fill(JSON_Reader *reader) {
+    size_t length = 0;
+    int is_start = reader->offset == 0 && reader->length == 0;
+    if (reader->position < reader->length) {
+        return 1;
+    }
+    if (reader->at_end) {
+        return 0;
+    }
+    reader->offset += reader->length;
+    reader->position = 0;
+    reader->length = reader->read_fun(reader->source_data, reader->buffer, READER_BUFFER_SIZE);
+    if (reader->length == 0 || reader->length > READER_BUFFER_SIZE) {
+        reader->length = 0;
+        reader->at_end = 1;
+        return 0;
+    }
+    if (is_start) { /* Support for UTF-8 BOM like parse_string, the offsets still count it */
+        while (reader->length < 3 &&
+               (length = reader->read_fun(reader->source_data, reader->buffer + reader->length, READER_BUFFER_SIZE - reader->length)) > 0 &&
+               length <= READER_BUFFER_SIZE - reader->length) {
+            reader->length += length;
+        }
+        if (reader->length >= 3 && memcmp(reader->buffer, "\xEF\xBB\xBF", 3) == 0) {
+            reader->position = 3;
+        }
+    }
+    return 1;
+}
+
+/* Next character of the input, or -1 at its end */
+static int reader_peek(JSON_Reader *reader) {
+    if (reader->position >= reader->length && !reader_fill(reader)) {
+        return -1;
+    }
+    return (unsigned char)reader->buffer[reader->position];
+}
+
+static JSON_Status reader_put(JSON_Reader *reader, const char *data, size_t length) {
+    char *new_text = NULL;
+    size_t new_capacity = 0;
+    if (reader->text_length + length + 1 > reader->text_capacity) {
+        new_capacity = MAX(reader->text_capacity * 2, reader->text_length + length + 1);
+        new_text = (char*)PARSON_MALLOC(reader->ctx, JSONAllocString, new_capacity);
+        if (new_text == NULL) {
+            return JSONFailure;
+        }
+        if (reader->text_length > 0) {
+            memcpy(new_text, reader->text, reader->text_length);
+        }
+        PARSON_FREE(reader->ctx, reader->text);
+        reader->text = new_text;
+        reader->text_capacity = new_capacity;
+    }
+    memcpy(reader->text + reader->text_length, data, length);
+    reader->text_length += length;
+    reader->text[reader->text_length] = '\0';
+    return JSONSuccess;
+}
+
+/* Same decoding as process_string, in place: the decoded text is never longer */
+static JSON_Status reader_unescape(JSON_Reader *reader) {
+    const char *input = reader->text, *end = reader->text + reader->text_length;
+    char *output = reader->text;
+    while (input < end) {
+        if (*input == '\\') {
+            input++;
+            switch (*input) {
+                case '\"': *output = '\"'; break;
+                case '\\': *output = '\\'; break;
+                case '/':  *output = '/';  break;
+                case 'b':  *output = '\b'; break;
+                case 'f':  *output = '\f'; break;
+                case 'n':  *output = '\n'; break;
+                case 'r':  *output = '\r'; break;
+                case 't':  *output = '\t'; break;
+                case 'u':
+                    if (parse_utf16(&input, &output) == JSONFailure) {
+                        return JSONFailure;
+                    }
+                    break;
+                default:
+                    return JSONFailure;
+            }
+        } else if ((unsigned char)*input < 0x20) {
+            return JSONFailure;
+        } else {
+            *output = *input;
+        }
+        output++;
+        input++;
+    }
+    *output = '\0';
+    reader->text_length = (size_t)(output - reader->text);
+    return JSONSuccess;
 }
 
-JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size(value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
+/* Copies the string up to its closing quote in text, whatever the buffer boundaries, then
+   decodes it */
+static JSON_Status reader_string(JSON_Reader *reader) {
+    const char *start = NULL, *ptr = NULL, *end = NULL;
+    reader->text_length = 0;
+    reader->position++; /* opening quote */
+    if (reader_put(reader, "", 0) == JSONFailure) {
         return JSONFailure;
     }
-    written = json_serialize_to_buffer_r(value, buf, 0, 0, NULL);
-    if (written < 0) {
-        return JSONFailure;
+    for (;;) {
+        if (!reader_fill(reader)) {
+            return JSONFailure;
+        }
+        start = reader->buffer + reader->position;
+        end = reader->buffer + reader->length;
+        for (ptr = start; ptr < end && *ptr != '\"' && *ptr != '\\'; ptr++) {
+        }
+        if (reader_put(reader, start, (size_t)(ptr - start)) == JSONFailure) {
+            return JSONFailure;
+        }
+        reader->position += (size_t)(ptr - start);
+        if (ptr == end) {
+            continue;
+        }
+        reader->position++;
+        if (*ptr == '\"') {
+            break;
+        }
+        /* the backslash and the character it escapes, decoded later */
+        if (reader_put(reader, "\\", 1) == JSONFailure || !reader_fill(reader) ||
+            reader_put(reader, reader->buffer + reader->position, 1) == JSONFailure) {
+            return JSONFailure;
+        }
+        reader->position++;
     }
-    return JSONSuccess;
+    return reader_unescape(reader);
 }
 
-JSON_Status json_serialize_to_file(const JSON_Value *value, const char *filename) {
-    JSON_Status return_code = JSONSuccess;
-    FILE *fp = NULL;
-    char *serialized_string = json_serialize_to_string(value);
-    if (serialized_string == NULL) {
-        return JSONFailure;
+/* Copies a number or a literal in text, checked by the caller */
+static JSON_Status reader_word(JSON_Reader *reader, int is_number) {
+    int c = 0;
+    char ch = 0;
+    reader->text_length = 0;
+    for (;;) {
+        c = reader_peek(reader);
+        if (is_number ? !(IS_NUMBER_START(c) || c == '.' || c == '+' || c == 'e' || c == 'E')
+                      : !(c >= 'a' && c <= 'z')) {
+            break;
+        }
+        ch = (char)c;
+        if ((!is_number && reader->text_length >= SIZEOF_TOKEN("false")) ||
+            reader_put(reader, &ch, 1) == JSONFailure) {
+            return JSONFailure;
+        }
+        reader->position++;
     }
-    fp = fopen(filename, "w");
-    if (fp == NULL) {
-        json_free_serialized_string(serialized_string);
-        return JSONFailure;
+    return reader->text_length > 0 ? JSONSuccess : JSONFailure;
+}
+
+/* Reads the value that starts at the current position */
+static JSON_Token reader_value(JSON_Reader *reader) {
+    unsigned char *new_levels = NULL;
+    int c = reader_peek(reader);
+    JSON_Token token = JSONTokenError;
+    reader->token_offset = reader->offset + reader->position;
+    if (c == '{' || c == '[') {
+        if (reader->depth >= reader->ctx->max_nesting) {
+            return reader_fail(reader);
+        }
+        if (reader->depth >= reader->capacity) {
+            new_levels = (unsigned char*)PARSON_MALLOC(reader->ctx, JSONAllocStack, reader->capacity * 2);
+            if (new_levels == NULL) {
+                return reader_fail(reader);
+            }
+            memcpy(new_levels, reader->levels, reader->depth);
+            if (reader->levels != reader->inline_levels) {
+                PARSON_FREE(reader->ctx, reader->levels);
+            }
+            reader->levels = new_levels;
+            reader->capacity *= 2;
+        }
+        reader->position++;
+        reader->levels[reader->depth++] = c == '{' ? WRITER_OBJECT : 0;
+        return c == '{' ? JSONTokenBeginObject : JSONTokenBeginArray;
     }
-    if (fputs(serialized_string, fp) == EOF) {
-        return_code = JSONFailure;
+    if (c == '\"') {
+        if (reader_string(reader) == JSONFailure) {
+            return reader_fail(reader);
+        }
+        token = JSONTokenString;
+    } else if (IS_NUMBER_START(c)) {
+        if (reader_word(reader, 1) == JSONFailure || scan_number(reader->text) != reader->text_length) {
+            return reader_fail(reader);
+        }
+        token = JSONTokenNumber;
+    } else {
+        if (reader_word(reader, 0) == JSONFailure) {
+            return reader_fail(reader);
+        }
+        if (strcmp(reader->text, "true") == 0 || strcmp(reader->text, "false") == 0) {
+            reader->boolean = reader->text[0] == 't';
+            token = JSONTokenBoolean;
+        } else if (strcmp(reader->text, "null") == 0) {
+            token = JSONTokenNull;
+        } else {
+            return reader_fail(reader);
+        }
     }
-    if (fclose(fp) == EOF) {
-        return_code = JSONFailure;
+    if (reader->depth == 0) {
+        reader->done = 1;
     }
-    json_free_serialized_string(serialized_string);
-    return return_code;
+    return token;
 }
 
-char * json_serialize_to_string(const JSON_Value *value) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size(value);
-    char *buf = NULL;
-    if (buf_size_bytes == 0) {
+static size_t reader_file_read(void *source_data, char *buffer, size_t size) {
+    return fread(buffer, 1, size, (FILE*)source_data);
+}
+
+JSON_Reader * json_reader_new(JSON_Context *ctx, JSON_Reader_Function read_fun, void *source_data) {
+    JSON_Reader *reader = NULL;
+    ctx = PARSON_CONTEXT(ctx);
+    if (read_fun == NULL) {
         return NULL;
     }
-    buf = (char*)parson_malloc(buf_size_bytes);
-    if (buf == NULL) {
+    reader = (JSON_Reader*)PARSON_MALLOC(ctx, JSONAllocInput, sizeof(JSON_Reader) + READER_BUFFER_SIZE);
+    if (reader == NULL) {
         return NULL;
     }
-    serialization_result = json_serialize_to_buffer(value, buf, buf_size_bytes);
-    if (serialization_result == JSONFailure) {
-        json_free_serialized_string(buf);
+    reader->ctx = ctx;
+    reader->read_fun = read_fun;
+    reader->source_data = source_data;
+    reader->fp = NULL;
+    reader->failed = 0;
+    reader->done = 0;
+    reader->at_end = 0;
+    reader->levels = reader->inline_levels;
+    reader->depth = 0;
+    reader->capacity = WALK_STACK_INLINE;
+    reader->text = NULL;
+    reader->text_length = 0;
+    reader->text_capacity = 0;
+    reader->boolean = 0;
+    reader->buffer = (char*)(reader + 1);
+    reader->position = 0;
+    reader->length = 0;
+    reader->offset = 0;
+    reader->token_offset = 0;
+    return reader;
+}
+
+JSON_Reader * json_reader_new_file(JSON_Context *ctx, const char *filename) {
+    JSON_Reader *reader = NULL;
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
         return NULL;
     }
-    return buf;
-}
-
-size_t json_serialization_size_pretty(const JSON_Value *value) {
-    char num_buf[NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
-    int res = json_serialize_to_buffer_r(value, NULL, 0, 1, num_buf);
-    return res < 0 ? 0 : (size_t)(res) + 1;
+    reader = json_reader_new(ctx, reader_file_read, fp);
+    if (reader == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    reader->fp = fp;
+    return reader;
 }
 
-JSON_Status json_serialize_to_buffer_pretty(const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size_pretty(value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
-        return JSONFailure;
+JSON_Token json_reader_next(JSON_Reader *reader) {
+    unsigned char *level = NULL;
+    int c = 0;
+    if (reader == NULL || reader->failed) {
+        return JSONTokenError;
     }
-    written = json_serialize_to_buffer_r(value, buf, 0, 1, NULL);
-    if (written < 0) {
-        return JSONFailure;
+    while ((c = reader_peek(reader)) != -1 && isspace(c)) {
+        reader->position++;
     }
-    return JSONSuccess;
-}
-
-JSON_Status json_serialize_to_file_pretty(const JSON_Value *value, const char *filename) {
-    JSON_Status return_code = JSONSuccess;
-    FILE *fp = NULL;
-    char *serialized_string = json_serialize_to_string_pretty(value);
-    if (serialized_string == NULL) {
-        return JSONFailure;
+    if (reader->done) { /* nothing but white space after the value */
+        return c == -1 ? JSONTokenEnd : reader_fail(reader);
     }
-    fp = fopen(filename, "w");
-    if (fp == NULL) {
-        json_free_serialized_string(serialized_string);
-        return JSONFailure;
+    if (reader->depth == 0) {
+        return reader_value(reader);
     }
-    if (fputs(serialized_string, fp) == EOF) {
-        return_code = JSONFailure;
+    level = &reader->levels[reader->depth - 1];
+    if (*level & WRITER_KEY) { /* value of the key */
+        *level &= ~WRITER_KEY;
+        return reader_value(reader);
     }
-    if (fclose(fp) == EOF) {
-        return_code = JSONFailure;
+    if (c == ((*level & WRITER_OBJECT) ? '}' : ']')) {
+        reader->token_offset = reader->offset + reader->position;
+        reader->position++;
+        reader->depth--;
+        if (reader->depth == 0) {
+            reader->done = 1;
+        }
+        return c == '}' ? JSONTokenEndObject : JSONTokenEndArray;
     }
-    json_free_serialized_string(serialized_string);
-    return return_code;
-}
-
-char * json_serialize_to_string_pretty(const JSON_Value *value) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size_pretty(value);
-    char *buf = NULL;
-    if (buf_size_bytes == 0) {
-        return NULL;
+    if (*level & WRITER_MEMBERS) {
+        if (c != ',') {
+            return reader_fail(reader);
+        }
+        reader->position++;
+        while ((c = reader_peek(reader)) != -1 && isspace(c)) {
+            reader->position++;
+        }
     }
-    buf = (char*)parson_malloc(buf_size_bytes);
-    if (buf == NULL) {
-        return NULL;
+    *level |= WRITER_MEMBERS;
+    if (!(*level & WRITER_OBJECT)) {
+        return reader_value(reader);
     }
-    serialization_result = json_serialize_to_buffer_pretty(value, buf, buf_size_bytes);
-    if (serialization_result == JSONFailure) {
-        json_free_serialized_string(buf);
-        return NULL;
+    /* member name, without embedded \0 like the parser's, and its ':' */
+    reader->token_offset = reader->offset + reader->position;
+    if (c != '\"' || reader_string(reader) == JSONFailure || strlen(reader->text) != reader->text_length) {
+        return reader_fail(reader);
     }
-    return buf;
+    while ((c = reader_peek(reader)) != -1 && isspace(c)) {
+        reader->position++;
+    }
+    if (c != ':') {
+        return reader_fail(reader);
+    }
+    reader->position++;
+    *level |= WRITER_KEY;
+    return JSONTokenKey;
 }
 
-void json_free_serialized_string(char *string) {
-    parson_free(string);
+JSON_Token json_reader_skip(JSON_Reader *reader) {
+    JSON_Token token = JSONTokenError;
+    size_t depth = 0;
+    if (reader == NULL || reader->failed || reader->depth == 0) {
+        return JSONTokenError;
+    }
+    depth = reader->depth;
+    do {
+        token = json_reader_next(reader);
+    } while (token != JSONTokenError && reader->depth >= depth);
+    return token;
+}
+
+const char * json_reader_string(const JSON_Reader *reader) {
+    return reader != NULL && reader->text != NULL ? reader->text : "";
+}
+
+size_t json_reader_string_len(const JSON_Reader *reader) {
+    return reader != NULL ? reader->text_length : 0;
+}
+
+double json_reader_number(const JSON_Reader *reader) {
+    return reader != NULL && reader->text != NULL ? strtod(reader->text, NULL) : 0;
+}
+
+int json_reader_boolean(const JSON_Reader *reader) {
+    return reader != NULL ? reader->boolean : -1;
+}
+
+size_t json_reader_depth(const JSON_Reader *reader) {
+    return reader != NULL ? reader->depth : 0;
+}
+
+size_t json_reader_offset(const JSON_Reader *reader) {
+    return reader != NULL ? reader->offset + reader->position : 0;
+}
+
+size_t json_reader_token_offset(const JSON_Reader *reader) {
+    return reader != NULL ? reader->token_offset : 0;
+}
+
+void json_reader_free(JSON_Reader *reader) {
+    if (reader == NULL) {
+        return;
+    }
+    if (reader->levels != reader->inline_levels) {
+        PARSON_FREE(reader->ctx, reader->levels);
+    }
+    PARSON_FREE(reader->ctx, reader->text);
+    if (reader->fp != NULL) {
+        fclose(reader->fp);
+    }
+    PARSON_FREE(reader->ctx, reader);
 }
 
 JSON_Status json_array_remove(JSON_Array *array, size_t ix) {
     size_t to_move_bytes = 0;
-    if (array == NULL || ix >= json_array_get_count(array)) {
+    if (array == NULL || ix >= json_array_get_count(array) || json_array_detach(array) == JSONFailure) {
         return JSONFailure;
     }
-    json_value_free(json_array_get_value(array, ix));
+    json_value_invalidate(array->wrapping_value, ix);
+    json_value_memo_removed(array->wrapping_value, ix);
+    if (array->numbers != NULL) {
+        to_move_bytes = (json_array_get_count(array) - 1 - ix) * sizeof(double);
+        memmove(array->numbers + ix, array->numbers + ix + 1, to_move_bytes);
+        if (array->items == NULL) {
+            array->count -= 1;
+            return JSONSuccess;
+        }
+    }
+    json_value_free(array->items[ix]);
     to_move_bytes = (json_array_get_count(array) - 1 - ix) * sizeof(JSON_Value*);
     memmove(array->items + ix, array->items + ix + 1, to_move_bytes);
     array->count -= 1;
@@ -1673,9 +4472,14 @@ JSON_Status json_array_remove(JSON_Array *array, size_t ix) {
 }
 
 JSON_Status json_array_replace_value(JSON_Array *array, size_t ix, JSON_Value *value) {
-    if (array == NULL || value == NULL || value->parent != NULL || ix >= json_array_get_count(array)) {
+    if (array == NULL || value == NULL || value->parent != NULL || ix >= json_array_get_count(array) ||
+        json_array_detach(array) == JSONFailure) {
         return JSONFailure;
     }
+    if (array->numbers != NULL && json_array_box(array) == JSONFailure) {
+        return JSONFailure;
+    }
+    json_value_invalidate(array->wrapping_value, ix);
     json_value_free(json_array_get_value(array, ix));
     value->parent = json_array_get_wrapping_value(array);
     array->items[ix] = value;
@@ -1683,7 +4487,7 @@ JSON_Status json_array_replace_value(JSON_Array *array, size_t ix, JSON_Value *v
 }
 
 JSON_Status json_array_replace_string(JSON_Array *array, size_t i, const char* string) {
-    JSON_Value *value = json_value_init_string(string);
+    JSON_Value *value = json_value_init_string_ex(CONTAINER_CONTEXT(array), string);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1695,7 +4499,7 @@ JSON_Status json_array_replace_string(JSON_Array *array, size_t i, const char* s
 }
 
 JSON_Status json_array_replace_string_with_len(JSON_Array *array, size_t i, const char *string, size_t len) {
-    JSON_Value *value = json_value_init_string_with_len(string, len);
+    JSON_Value *value = json_value_init_string_with_len_ex(CONTAINER_CONTEXT(array), string, len);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1707,7 +4511,20 @@ JSON_Status json_array_replace_string_with_len(JSON_Array *array, size_t i, cons
 }
 
 JSON_Status json_array_replace_number(JSON_Array *array, size_t i, double number) {
-    JSON_Value *value = json_value_init_number(number);
+    JSON_Value *value = NULL;
+    if (array != NULL && array->numbers != NULL) { /* stays unboxed */
+        if (i >= array->count || IS_NUMBER_INVALID(number) || json_array_detach(array) == JSONFailure) {
+            return JSONFailure;
+        }
+        json_value_invalidate(array->wrapping_value, i);
+        if (array->items != NULL) {
+            json_value_free(array->items[i]);
+            array->items[i] = NULL;
+        }
+        array->numbers[i] = number;
+        return JSONSuccess;
+    }
+    value = json_value_init_number_ex(CONTAINER_CONTEXT(array), number);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1719,7 +4536,7 @@ JSON_Status json_array_replace_number(JSON_Array *array, size_t i, double number
 }
 
 JSON_Status json_array_replace_boolean(JSON_Array *array, size_t i, int boolean) {
-    JSON_Value *value = json_value_init_boolean(boolean);
+    JSON_Value *value = json_value_init_boolean_ex(CONTAINER_CONTEXT(array), boolean);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1731,7 +4548,7 @@ JSON_Status json_array_replace_boolean(JSON_Array *array, size_t i, int boolean)
 }
 
 JSON_Status json_array_replace_null(JSON_Array *array, size_t i) {
-    JSON_Value *value = json_value_init_null();
+    JSON_Value *value = json_value_init_null_ex(CONTAINER_CONTEXT(array));
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1744,25 +4561,33 @@ JSON_Status json_array_replace_null(JSON_Array *array, size_t i) {
 
 JSON_Status json_array_clear(JSON_Array *array) {
     size_t i = 0;
-    if (array == NULL) {
+    if (array == NULL || json_array_detach(array) == JSONFailure) {
         return JSONFailure;
     }
-    for (i = 0; i < json_array_get_count(array); i++) {
-        json_value_free(json_array_get_value(array, i));
+    json_value_invalidate(array->wrapping_value, MEMO_ALL);
+    for (i = 0; array->items != NULL && i < json_array_get_count(array); i++) {
+        json_value_free(array->items[i]);
+    }
+    if (array->numbers != NULL) {
+        PARSON_FREE(array->ctx, array->numbers);
+        array->numbers = NULL;
+        if (array->items == NULL) {
+            array->capacity = 0;
+        }
     }
     array->count = 0;
     return JSONSuccess;
 }
 
 JSON_Status json_array_append_value(JSON_Array *array, JSON_Value *value) {
-    if (array == NULL || value == NULL || value->parent != NULL) {
+    if (array == NULL || value == NULL || value->parent != NULL || json_array_detach(array) == JSONFailure) {
         return JSONFailure;
     }
     return json_array_add(array, value);
 }
 
 JSON_Status json_array_append_string(JSON_Array *array, const char *string) {
-    JSON_Value *value = json_value_init_string(string);
+    JSON_Value *value = json_value_init_string_ex(CONTAINER_CONTEXT(array), string);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1774,7 +4599,7 @@ JSON_Status json_array_append_string(JSON_Array *array, const char *string) {
 }
 
 JSON_Status json_array_append_string_with_len(JSON_Array *array, const char *string, size_t len) {
-    JSON_Value *value = json_value_init_string_with_len(string, len);
+    JSON_Value *value = json_value_init_string_with_len_ex(CONTAINER_CONTEXT(array), string, len);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1786,7 +4611,14 @@ JSON_Status json_array_append_string_with_len(JSON_Array *array, const char *str
 }
 
 JSON_Status json_array_append_number(JSON_Array *array, double number) {
-    JSON_Value *value = json_value_init_number(number);
+    if (array == NULL || json_array_detach(array) == JSONFailure) {
+        return JSONFailure;
+    }
+    return json_array_add_number(array, number);
+}
+
+JSON_Status json_array_append_boolean(JSON_Array *array, int boolean) {
+    JSON_Value *value = json_value_init_boolean_ex(CONTAINER_CONTEXT(array), boolean);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1797,8 +4629,8 @@ JSON_Status json_array_append_number(JSON_Array *array, double number) {
     return JSONSuccess;
 }
 
-JSON_Status json_array_append_boolean(JSON_Array *array, int boolean) {
-    JSON_Value *value = json_value_init_boolean(boolean);
+JSON_Status json_array_append_null(JSON_Array *array) {
+    JSON_Value *value = json_value_init_null_ex(CONTAINER_CONTEXT(array));
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1809,22 +4641,62 @@ JSON_Status json_array_append_boolean(JSON_Array *array, int boolean) {
     return JSONSuccess;
 }
 
-JSON_Status json_array_append_null(JSON_Array *array) {
-    JSON_Value *value = json_value_init_null();
-    if (value == NULL) {
+JSON_Status json_array_append_numbers(JSON_Array *array, const double *numbers, size_t count) {
+    size_t i, old_count;
+    if (array == NULL || (numbers == NULL && count > 0) || json_array_detach(array) == JSONFailure) {
         return JSONFailure;
     }
-    if (json_array_append_value(array, value) == JSONFailure) {
-        json_value_free(value);
+    for (i = 0; i < count; i++) {
+        if (IS_NUMBER_INVALID(numbers[i])) {
+            return JSONFailure;
+        }
+    }
+    if (count == 0) {
+        return JSONSuccess;
+    }
+    if (json_array_keeps_numbers(array)) {
+        json_value_invalidate(array->wrapping_value, array->count);
+        if (json_array_reserve_numbers(array, count) == JSONFailure) {
+            return JSONFailure;
+        }
+        memcpy(array->numbers + array->count, numbers, count * sizeof(double));
+        for (i = 0; array->items != NULL && i < count; i++) {
+            array->items[array->count + i] = NULL;
+        }
+        array->count += count;
+        return JSONSuccess;
+    }
+    if (array->capacity - array->count < count &&
+        json_array_resize(array, array->count + count) == JSONFailure) {
         return JSONFailure;
     }
+    old_count = array->count;
+    for (i = 0; i < count; i++) {
+        if (json_array_add_number(array, numbers[i]) == JSONFailure) {
+            while (array->count > old_count) { /* all or nothing */
+                array->count--;
+                json_value_free(array->items[array->count]);
+            }
+            return JSONFailure;
+        }
+    }
     return JSONSuccess;
 }
 
+JSON_Status json_array_reserve(JSON_Array *array, size_t capacity) {
+    if (array == NULL || json_array_detach(array) == JSONFailure) {
+        return JSONFailure;
+    }
+    if (capacity <= array->capacity) {
+        return JSONSuccess;
+    }
+    return json_array_resize(array, capacity);
+}
+
 JSON_Status json_object_set_value(JSON_Object *object, const char *name, JSON_Value *value) {
     size_t i = 0;
     JSON_Value *old_value;
-    if (object == NULL || name == NULL || value == NULL || value->parent != NULL) {
+    if (object == NULL || name == NULL || value == NULL || value->parent != NULL || json_object_detach(object) == JSONFailure) {
         return JSONFailure;
     }
     old_value = json_object_get_value(object, name);
@@ -1832,6 +4704,7 @@ JSON_Status json_object_set_value(JSON_Object *object, const char *name, JSON_Va
         json_value_free(old_value);
         for (i = 0; i < json_object_get_count(object); i++) {
             if (strcmp(object->names[i], name) == 0) {
+                json_value_invalidate(object->wrapping_value, i);
                 value->parent = json_object_get_wrapping_value(object);
                 object->values[i] = value;
                 return JSONSuccess;
@@ -1843,7 +4716,7 @@ JSON_Status json_object_set_value(JSON_Object *object, const char *name, JSON_Va
 }
 
 JSON_Status json_object_set_string(JSON_Object *object, const char *name, const char *string) {
-    JSON_Value *value = json_value_init_string(string);
+    JSON_Value *value = json_value_init_string_ex(CONTAINER_CONTEXT(object), string);
     JSON_Status status = json_object_set_value(object, name, value);
     if (status == JSONFailure) {
         json_value_free(value);
@@ -1852,7 +4725,7 @@ JSON_Status json_object_set_string(JSON_Object *object, const char *name, const
 }
 
 JSON_Status json_object_set_string_with_len(JSON_Object *object, const char *name, const char *string, size_t len) {
-    JSON_Value *value = json_value_init_string_with_len(string, len);
+    JSON_Value *value = json_value_init_string_with_len_ex(CONTAINER_CONTEXT(object), string, len);
     JSON_Status status = json_object_set_value(object, name, value);
     if (status == JSONFailure) {
         json_value_free(value);
@@ -1861,7 +4734,7 @@ JSON_Status json_object_set_string_with_len(JSON_Object *object, const char *nam
 }
 
 JSON_Status json_object_set_number(JSON_Object *object, const char *name, double number) {
-    JSON_Value *value = json_value_init_number(number);
+    JSON_Value *value = json_value_init_number_ex(CONTAINER_CONTEXT(object), number);
     JSON_Status status = json_object_set_value(object, name, value);
     if (status == JSONFailure) {
         json_value_free(value);
@@ -1870,7 +4743,7 @@ JSON_Status json_object_set_number(JSON_Object *object, const char *name, double
 }
 
 JSON_Status json_object_set_boolean(JSON_Object *object, const char *name, int boolean) {
-    JSON_Value *value = json_value_init_boolean(boolean);
+    JSON_Value *value = json_value_init_boolean_ex(CONTAINER_CONTEXT(object), boolean);
     JSON_Status status = json_object_set_value(object, name, value);
     if (status == JSONFailure) {
         json_value_free(value);
@@ -1879,7 +4752,7 @@ JSON_Status json_object_set_boolean(JSON_Object *object, const char *name, int b
 }
 
 JSON_Status json_object_set_null(JSON_Object *object, const char *name) {
-    JSON_Value *value = json_value_init_null();
+    JSON_Value *value = json_value_init_null_ex(CONTAINER_CONTEXT(object));
     JSON_Status status = json_object_set_value(object, name, value);
     if (status == JSONFailure) {
         json_value_free(value);
@@ -1893,7 +4766,7 @@ JSON_Status json_object_dotset_value(JSON_Object *object, const char *name, JSON
     JSON_Object *temp_object = NULL, *new_object = NULL;
     JSON_Status status = JSONFailure;
     size_t name_len = 0;
-    if (object == NULL || name == NULL || value == NULL) {
+    if (object == NULL || name == NULL || value == NULL || json_object_detach(object) == JSONFailure) {
         return JSONFailure;
     }
     dot_pos = strchr(name, '.');
@@ -1910,7 +4783,7 @@ JSON_Status json_object_dotset_value(JSON_Object *object, const char *name, JSON
         temp_object = json_value_get_object(temp_value);
         return json_object_dotset_value(temp_object, dot_pos + 1, value);
     }
-    new_value = json_value_init_object();
+    new_value = json_value_init_object_ex(CONTAINER_CONTEXT(object));
     if (new_value == NULL) {
         return JSONFailure;
     }
@@ -1930,7 +4803,7 @@ JSON_Status json_object_dotset_value(JSON_Object *object, const char *name, JSON
 }
 
 JSON_Status json_object_dotset_string(JSON_Object *object, const char *name, const char *string) {
-    JSON_Value *value = json_value_init_string(string);
+    JSON_Value *value = json_value_init_string_ex(CONTAINER_CONTEXT(object), string);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1942,7 +4815,7 @@ JSON_Status json_object_dotset_string(JSON_Object *object, const char *name, con
 }
 
 JSON_Status json_object_dotset_string_with_len(JSON_Object *object, const char *name, const char *string, size_t len) {
-    JSON_Value *value = json_value_init_string_with_len(string, len);
+    JSON_Value *value = json_value_init_string_with_len_ex(CONTAINER_CONTEXT(object), string, len);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1954,7 +4827,7 @@ JSON_Status json_object_dotset_string_with_len(JSON_Object *object, const char *
 }
 
 JSON_Status json_object_dotset_number(JSON_Object *object, const char *name, double number) {
-    JSON_Value *value = json_value_init_number(number);
+    JSON_Value *value = json_value_init_number_ex(CONTAINER_CONTEXT(object), number);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1966,7 +4839,7 @@ JSON_Status json_object_dotset_number(JSON_Object *object, const char *name, dou
 }
 
 JSON_Status json_object_dotset_boolean(JSON_Object *object, const char *name, int boolean) {
-    JSON_Value *value = json_value_init_boolean(boolean);
+    JSON_Value *value = json_value_init_boolean_ex(CONTAINER_CONTEXT(object), boolean);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1978,7 +4851,7 @@ JSON_Status json_object_dotset_boolean(JSON_Object *object, const char *name, in
 }
 
 JSON_Status json_object_dotset_null(JSON_Object *object, const char *name) {
-    JSON_Value *value = json_value_init_null();
+    JSON_Value *value = json_value_init_null_ex(CONTAINER_CONTEXT(object));
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1990,26 +4863,50 @@ JSON_Status json_object_dotset_null(JSON_Object *object, const char *name) {
 }
 
 JSON_Status json_object_remove(JSON_Object *object, const char *name) {
+    if (object == NULL || json_object_detach(object) == JSONFailure) {
+        return JSONFailure;
+    }
     return json_object_remove_internal(object, name, 1);
 }
 
 JSON_Status json_object_dotremove(JSON_Object *object, const char *name) {
+    if (object == NULL) {
+        return JSONFailure;
+    }
     return json_object_dotremove_internal(object, name, 1);
 }
 
 JSON_Status json_object_clear(JSON_Object *object) {
     size_t i = 0;
-    if (object == NULL) {
+    if (object == NULL || json_object_detach(object) == JSONFailure) {
         return JSONFailure;
     }
+    json_value_invalidate(object->wrapping_value, MEMO_ALL);
     for (i = 0; i < json_object_get_count(object); i++) {
-        parson_free(object->names[i]);
+        PARSON_FREE(object->ctx, object->names[i]);
         json_value_free(object->values[i]);
     }
     object->count = 0;
     return JSONSuccess;
 }
 
+JSON_Status json_object_reserve(JSON_Object *object, size_t capacity) {
+    if (object == NULL || json_object_detach(object) == JSONFailure) {
+        return JSONFailure;
+    }
+    if (capacity <= object->capacity) {
+        return JSONSuccess;
+    }
+    return json_object_resize(object, capacity);
+}
+
+JSON_Status json_object_append_value(JSON_Object *object, const char *name, JSON_Value *value) {
+    if (object == NULL || name == NULL || value == NULL || value->parent != NULL || json_object_detach(object) == JSONFailure) {
+        return JSONFailure;
+    }
+    return json_object_push(object, name, strlen(name), value);
+}
+
 JSON_Status json_validate(const JSON_Value *schema, const JSON_Value *value) {
     JSON_Value *temp_schema_value = NULL, *temp_value = NULL;
     JSON_Array *schema_array = NULL, *value_array = NULL;
@@ -2027,8 +4924,8 @@ JSON_Status json_validate(const JSON_Value *schema, const JSON_Value *value) {
     }
     switch (schema_type) {
         case JSONArray:
-            schema_array = json_value_get_array(schema);
-            value_array = json_value_get_array(value);
+            schema_array = schema->value.array;
+            value_array = value->value.array;
             count = json_array_get_count(schema_array);
             if (count == 0) {
                 return JSONSuccess; /* Empty array allows all types */
@@ -2043,8 +4940,8 @@ JSON_Status json_validate(const JSON_Value *schema, const JSON_Value *value) {
             }
             return JSONSuccess;
         case JSONObject:
-            schema_object = json_value_get_object(schema);
-            value_object = json_value_get_object(value);
+            schema_object = schema->value.object;
+            value_object = value->value.object;
             count = json_object_get_count(schema_object);
             if (count == 0) {
                 return JSONSuccess; /* Empty object allows all objects */
@@ -2084,13 +4981,24 @@ int json_value_equals(const JSON_Value *a, const JSON_Value *b) {
     }
     switch (a_type) {
         case JSONArray:
-            a_array = json_value_get_array(a);
-            b_array = json_value_get_array(b);
+            a_array = a->value.array;
+            b_array = b->value.array;
+            if (a_array == b_array) { /* shared by a deep copy */
+                return 1;
+            }
             a_count = json_array_get_count(a_array);
             b_count = json_array_get_count(b_array);
             if (a_count != b_count) {
                 return 0;
             }
+            if (a_array->numbers != NULL && b_array->numbers != NULL) {
+                for (i = 0; i < a_count; i++) {
+                    if (fabs(a_array->numbers[i] - b_array->numbers[i]) >= 0.000001) { /* EPSILON */
+                        return 0;
+                    }
+                }
+                return 1;
+            }
             for (i = 0; i < a_count; i++) {
                 if (!json_value_equals(json_array_get_value(a_array, i),
                                        json_array_get_value(b_array, i))) {
@@ -2099,8 +5007,11 @@ int json_value_equals(const JSON_Value *a, const JSON_Value *b) {
             }
             return 1;
         case JSONObject:
-            a_object = json_value_get_object(a);
-            b_object = json_value_get_object(b);
+            a_object = a->value.object;
+            b_object = b->value.object;
+            if (a_object == b_object) {
+                return 1;
+            }
             a_count = json_object_get_count(a_object);
             b_count = json_object_get_count(b_object);
             if (a_count != b_count) {
@@ -2164,10 +5075,159 @@ int json_boolean(const JSON_Value *value) {
 }
 
 void json_set_allocation_functions(JSON_Malloc_Function malloc_fun, JSON_Free_Function free_fun) {
-    parson_malloc = malloc_fun;
-    parson_free = free_fun;
+    json_context_set_allocation_functions(&parson_default_context, malloc_fun, free_fun);
 }
 
 void json_set_escape_slashes(int escape_slashes) {
-    parson_escape_slashes = escape_slashes;
+    parson_default_context.escape_slashes = escape_slashes;
+}
+
+void json_set_number_lexemes(int number_lexemes) {
+    parson_default_context.number_lexemes = number_lexemes;
+}
+
+void json_set_stats_enabled(int enabled) {
+    json_context_set_stats_enabled(&parson_default_context, enabled);
+}
+
+JSON_Status json_get_stats(JSON_Stats *stats) {
+    return json_context_get_stats(&parson_default_context, stats);
+}
+
+void json_reset_stats(void) {
+    json_context_reset_stats(&parson_default_context);
+}
+
+/* Context API */
+JSON_Context * json_context_new(void) {
+    JSON_Context *ctx = (JSON_Context*)malloc(sizeof(JSON_Context));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(JSON_Context));
+    ctx->malloc_fun = malloc;
+    ctx->free_fun = free;
+    ctx->escape_slashes = 1;
+    ctx->number_arrays = 1;
+    ctx->max_nesting = MAX_NESTING;
+    ctx->use_scratch = 1;
+    return ctx;
+}
+
+void json_context_free(JSON_Context *ctx) {
+    if (ctx == NULL || ctx == &parson_default_context) {
+        return;
+    }
+    PARSON_FREE(ctx, ctx->scratch);
+    free(ctx);
+}
+
+/* The scratch buffer came from the allocator being replaced, it is given back to it */
+static void parson_context_drop_scratch(JSON_Context *ctx) {
+    PARSON_FREE(ctx, ctx->scratch);
+    ctx->scratch = NULL;
+    ctx->scratch_capacity = 0;
+}
+
+void json_context_set_allocation_functions(JSON_Context *ctx, JSON_Malloc_Function malloc_fun, JSON_Free_Function free_fun) {
+    ctx = PARSON_CONTEXT(ctx);
+    parson_context_drop_scratch(ctx);
+    ctx->malloc_fun = malloc_fun;
+    ctx->free_fun = free_fun;
+    ctx->malloc_ex_fun = NULL;
+    ctx->free_ex_fun = NULL;
+    ctx->allocator_data = NULL;
+}
+
+void json_context_set_allocator(JSON_Context *ctx, JSON_Context_Malloc_Function malloc_fun, JSON_Context_Free_Function free_fun, void *allocator_data) {
+    ctx = PARSON_CONTEXT(ctx);
+    parson_context_drop_scratch(ctx);
+    ctx->malloc_ex_fun = malloc_fun;
+    ctx->free_ex_fun = free_fun;
+    ctx->allocator_data = allocator_data;
+}
+
+void json_context_set_escape_slashes(JSON_Context *ctx, int escape_slashes) {
+    PARSON_CONTEXT(ctx)->escape_slashes = escape_slashes;
+}
+
+void json_context_set_with_comments(JSON_Context *ctx, int with_comments) {
+    PARSON_CONTEXT(ctx)->with_comments = with_comments;
+}
+
+void json_context_set_validate_utf8(JSON_Context *ctx, int validate_utf8) {
+    PARSON_CONTEXT(ctx)->validate_utf8 = validate_utf8;
+}
+
+void json_context_set_number_lexemes(JSON_Context *ctx, int number_lexemes) {
+    PARSON_CONTEXT(ctx)->number_lexemes = number_lexemes;
+}
+
+void json_context_set_number_arrays(JSON_Context *ctx, int number_arrays) {
+    PARSON_CONTEXT(ctx)->number_arrays = number_arrays;
+}
+
+void json_context_set_prescan(JSON_Context *ctx, int prescan) {
+    PARSON_CONTEXT(ctx)->prescan = prescan;
+}
+
+void json_context_set_serialization_cache(JSON_Context *ctx, int serialization_cache) {
+    PARSON_CONTEXT(ctx)->serialization_cache = serialization_cache;
+}
+
+void json_context_set_max_nesting(JSON_Context *ctx, size_t max_nesting) {
+    PARSON_CONTEXT(ctx)->max_nesting = max_nesting;
+}
+
+void json_context_set_stats_enabled(JSON_Context *ctx, int enabled) {
+#ifdef PARSON_STATS
+    PARSON_CONTEXT(ctx)->stats_enabled = enabled;
+#else
+    (void)ctx;
+    (void)enabled;
+#endif
+}
+
+JSON_Status json_context_get_stats(const JSON_Context *ctx, JSON_Stats *stats) {
+#ifdef PARSON_STATS
+    if (stats == NULL) {
+        return JSONFailure;
+    }
+    *stats = PARSON_CONTEXT(ctx)->stats;
+    return JSONSuccess;
+#else
+    (void)ctx;
+    (void)stats;
+    return JSONFailure;
+#endif
+}
+
+void json_context_reset_stats(JSON_Context *ctx) {
+#ifdef PARSON_STATS
+    JSON_Stats *stats = &PARSON_CONTEXT(ctx)->stats;
+    size_t live_bytes = stats->live_bytes;
+    memset(stats, 0, sizeof(JSON_Stats));
+    stats->live_bytes = live_bytes;
+    stats->peak_live_bytes = live_bytes;
+#else
+    (void)ctx;
+#endif
+}
+
+JSON_Context * json_value_get_context(const JSON_Value *value) {
+    return value ? value->ctx : NULL;
+}
+
+int json_is_valid_utf8(const char *string, size_t length) {
+    return string != NULL && is_valid_utf8(string, length);
+}
+
+const char * json_stats_category_name(int category) {
+    static const char *names[JSON_ALLOC_CATEGORIES] = {
+        "value", "object", "array", "key", "string", "serializer", "input", "stack"
+    };
+    if (category < 0 || category >= JSON_ALLOC_CATEGORIES) {
+        return NULL;
+    }
+    return names[category];
 }
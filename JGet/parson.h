@@ -39,6 +39,10 @@
 typedef struct json_object_t JSON_Object;
 typedef struct json_array_t  JSON_Array;
 typedef struct json_value_t  JSON_Value;
+typedef struct json_context_t JSON_Context;
+typedef struct json_writer_t JSON_Writer;
+typedef struct json_reader_t JSON_Reader;
+typedef struct json_documents_t JSON_Documents;
 
 enum json_value_type {
     JSONError   = -1,
@@ -57,9 +61,36 @@ enum json_result_t {
 };
 typedef int JSON_Status;
 
+enum json_token_type {
+    JSONTokenError       = -1,
+    JSONTokenEnd         = 0,
+    JSONTokenBeginObject = 1,
+    JSONTokenEndObject   = 2,
+    JSONTokenBeginArray  = 3,
+    JSONTokenEndArray    = 4,
+    JSONTokenKey         = 5,
+    JSONTokenString      = 6,
+    JSONTokenNumber      = 7,
+    JSONTokenBoolean     = 8,
+    JSONTokenNull        = 9
+};
+typedef int JSON_Token;
+
 typedef void * (*JSON_Malloc_Function)(size_t);
 typedef void   (*JSON_Free_Function)(void *);
 
+/* Allocators receiving the pointer given to json_context_set_allocator, e.g. a pool or an arena.
+   Setting another allocator gives the context's own buffers back to the previous one first, so
+   that a pool may be dropped once the allocator is replaced. */
+typedef void * (*JSON_Context_Malloc_Function)(void *allocator_data, size_t);
+typedef void   (*JSON_Context_Free_Function)(void *allocator_data, void *);
+
+/* Sink of a JSON_Writer, receives the output in blocks of 4 KB or more */
+typedef JSON_Status (*JSON_Writer_Function)(void *sink_data, const char *data, size_t length);
+
+/* Source of a JSON_Reader, fills buffer with up to size bytes and returns their number, 0 at the end */
+typedef size_t (*JSON_Reader_Function)(void *source_data, char *buffer, size_t size);
+
 /* Call only once, before calling any other function from parson API. If not called, malloc and free
    from stdlib will be used for all allocations */
 void json_set_allocation_functions(JSON_Malloc_Function malloc_fun, JSON_Free_Function free_fun);
@@ -68,6 +99,76 @@ void json_set_allocation_functions(JSON_Malloc_Function malloc_fun, JSON_Free_Fu
  This function sets a global setting and is not thread safe. */
 void json_set_escape_slashes(int escape_slashes);
 
+/* Sets if numbers should keep their source text when parsed. By default they are converted to
+   double right away. With lexemes, json_value_get_number converts on each call and the serializer
+   writes the text back verbatim (no 1.1000000000000001 for 1.10, 64-bit IDs intact). Numbers out
+   of the range of a double are then accepted, json_value_get_number returns what strtod makes of
+   them. This function sets a global setting and is not thread safe. */
+void json_set_number_lexemes(int number_lexemes);
+
+/* Contexts hold the allocator and the parser/serializer settings, so that several tasks can parse
+   and serialize with different settings at the same time. A context must not be used by two tasks
+   at once, and must outlive every value created with it. Values remember their context: they are
+   freed with json_value_free and the setters create new children with the container's context.
+   Passing NULL as a context selects the default context used by the functions without _ex. */
+JSON_Context * json_context_new(void);
+void           json_context_free(JSON_Context *ctx);
+void           json_context_set_allocation_functions(JSON_Context *ctx, JSON_Malloc_Function malloc_fun, JSON_Free_Function free_fun);
+void           json_context_set_allocator(JSON_Context *ctx, JSON_Context_Malloc_Function malloc_fun, JSON_Context_Free_Function free_fun, void *allocator_data);
+void           json_context_set_escape_slashes(JSON_Context *ctx, int escape_slashes); /* default 1 */
+void           json_context_set_with_comments(JSON_Context *ctx, int with_comments);   /* default 0, used by json_parse_*_ex */
+void           json_context_set_max_nesting(JSON_Context *ctx, size_t max_nesting);    /* default 2048, walked on the heap, not the C stack */
+void           json_context_set_validate_utf8(JSON_Context *ctx, int validate_utf8);   /* default 0, rejects input that is not UTF-8 */
+void           json_context_set_number_lexemes(JSON_Context *ctx, int number_lexemes); /* default 0, see json_set_number_lexemes */
+void           json_context_set_number_arrays(JSON_Context *ctx, int number_arrays);   /* default 1, see json_array_get_numbers */
+void           json_context_set_prescan(JSON_Context *ctx, int prescan);               /* default 0, counts members first to allocate each container once */
+void           json_context_set_serialization_cache(JSON_Context *ctx, int serialization_cache); /* default 0, see below */
+JSON_Context * json_value_get_context(const JSON_Value *value);
+
+/* With serialization_cache set, the serializer keeps the text it writes and copies it again as
+   long as it does not change, so that serializing an edited document costs in proportion to
+   what was changed: a document of 128 bytes to 16 KB is kept whole, larger containers as runs
+   of about 4 KB of their members. The setters drop the text of the containers they change and
+   of those above them, and the run of the member concerned. Memory: up to one more copy of the
+   document for each of the compact and pretty forms. Serializing updates the memos, so a
+   document must not be serialized by two tasks at once while the cache is on. */
+
+/* Allocation statistics. They are only available when parson.c is compiled with PARSON_STATS
+   defined, otherwise json_get_stats returns JSONFailure. Counting starts when enabled and
+   live_bytes only accounts for blocks allocated while statistics were enabled. */
+enum json_alloc_category {
+    JSONAllocValue      = 0, /* JSON_Value nodes */
+    JSONAllocObject     = 1, /* JSON_Object and its names/values tables */
+    JSONAllocArray      = 2, /* JSON_Array, its items table and numbers */
+    JSONAllocKey        = 3, /* object member names */
+    JSONAllocString     = 4, /* string values */
+    JSONAllocSerializer = 5, /* serialized strings, serialization cache */
+    JSONAllocInput      = 6, /* file contents and comment-free copies of the input */
+    JSONAllocStack      = 7  /* walk stacks of documents nested more than 16 levels deep, prescan counts */
+};
+
+#define JSON_ALLOC_CATEGORIES 8
+#define JSON_STATS_BUCKETS    12 /* histogram of sizes: <= 8, <= 16, ... <= 8192, more */
+
+typedef struct json_stats_t {
+    size_t allocations[JSON_ALLOC_CATEGORIES];
+    size_t bytes[JSON_ALLOC_CATEGORIES];
+    size_t frees[JSON_ALLOC_CATEGORIES];
+    size_t live_bytes;
+    size_t peak_live_bytes;
+    size_t histogram[JSON_STATS_BUCKETS];
+} JSON_Stats;
+
+void         json_set_stats_enabled(int enabled);
+JSON_Status  json_get_stats(JSON_Stats *stats);
+void         json_reset_stats(void); /* peak_live_bytes restarts from live_bytes */
+const char * json_stats_category_name(int category);
+
+/* Statistics of a single context, the functions above work on the default context */
+void         json_context_set_stats_enabled(JSON_Context *ctx, int enabled);
+JSON_Status  json_context_get_stats(const JSON_Context *ctx, JSON_Stats *stats);
+void         json_context_reset_stats(JSON_Context *ctx);
+
 /* Parses first JSON value in a file, returns NULL in case of error */
 JSON_Value * json_parse_file(const char *filename);
 
@@ -82,6 +183,36 @@ JSON_Value * json_parse_string(const char *string);
     returns NULL in case of error */
 JSON_Value * json_parse_string_with_comments(const char *string);
 
+/*  Replaces comments (/ * * / and //) in a mutable string with spaces, in place.
+    json_parse_string_with_comments is json_strip_comments on a copy followed by json_parse_string. */
+void json_strip_comments(char *string);
+
+/*  Returns 1 when string is valid UTF-8 (no overlong forms, surrogates or code points above U+10FFFF) */
+int json_is_valid_utf8(const char *string, size_t length);
+
+/*  Same as json_parse_file and json_parse_string, using the allocator and settings of ctx.
+    Comments are ignored when enabled with json_context_set_with_comments. */
+JSON_Value * json_parse_file_ex(JSON_Context *ctx, const char *filename);
+JSON_Value * json_parse_string_ex(JSON_Context *ctx, const char *string);
+
+/*  Buffer for input read by the caller, length chars plus the null character, allocated and
+    counted as input by ctx. It is freed with json_free_serialized_string_ex. */
+char * json_alloc_input_ex(JSON_Context *ctx, size_t length);
+
+/*  Concatenated documents, as written by loggers: json_parse_string stops after the first value,
+    json_documents_next returns each top level value in turn, separated by whitespace or not.
+    It returns NULL at the end of the input and on the first invalid document, which stops the
+    iteration, json_documents_failed tells which and json_documents_offset gives the position of
+    the next or failing document. The string given to json_documents_new must stay valid until
+    json_documents_free, a file is read once as a whole. The parser's stack and the scratch buffer
+    of ctx are kept from one document to the next. */
+JSON_Documents * json_documents_new(JSON_Context *ctx, const char *string);
+JSON_Documents * json_documents_new_file(JSON_Context *ctx, const char *filename);
+JSON_Value *     json_documents_next(JSON_Documents *documents);
+int              json_documents_failed(const JSON_Documents *documents);
+size_t           json_documents_offset(const JSON_Documents *documents);
+void             json_documents_free(JSON_Documents *documents);
+
 /* Serialization */
 size_t      json_serialization_size(const JSON_Value *value); /* returns 0 on fail */
 JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes);
@@ -96,6 +227,79 @@ char *      json_serialize_to_string_pretty(const JSON_Value *value);
 
 void        json_free_serialized_string(char *string); /* frees string from json_serialize_to_string and json_serialize_to_string_pretty */
 
+/* Serialization with the allocator and settings of ctx, is_pretty selects the pretty variant */
+size_t      json_serialization_size_ex(const JSON_Context *ctx, const JSON_Value *value, int is_pretty);
+JSON_Status json_serialize_to_buffer_ex(const JSON_Context *ctx, const JSON_Value *value, char *buf, size_t buf_size_in_bytes, int is_pretty);
+JSON_Status json_serialize_to_file_ex(JSON_Context *ctx, const JSON_Value *value, const char *filename, int is_pretty);
+char *      json_serialize_to_string_ex(JSON_Context *ctx, const JSON_Value *value, int is_pretty);
+void        json_free_serialized_string_ex(JSON_Context *ctx, char *string);
+
+/* Parallel serialization, for documents made of a large top level array or object. Its members
+   are shared out between 'jobs' jobs, each one writing its members at their place in the output.
+   run_fun is called twice, once to measure and once to write, and returns once job_fun has been
+   called on every job; it may run them at the same time on as many tasks, the jobs share nothing
+   but the document, which must not change meanwhile. With NULL, the jobs run one after the other
+   in the calling task. The allocator of ctx must then be callable from these tasks. The output is
+   byte for byte that of json_serialize_to_string_ex, and is freed with
+   json_free_serialized_string_ex. The serialization cache is neither read nor updated below the
+   top level. */
+typedef void (*JSON_Job_Function)(void *job);
+typedef void (*JSON_Job_Runner)(void *runner_data, JSON_Job_Function job_fun, void **jobs, size_t count);
+char *      json_serialize_to_string_parallel_ex(JSON_Context *ctx, const JSON_Value *value, int is_pretty,
+                                                 size_t jobs, JSON_Job_Runner run_fun, void *runner_data);
+
+/* Streaming writer, writes a document through a sink without building it as JSON_Values first,
+   so that its memory does not grow with the output (4 KB of buffer, one byte per open container).
+   Escaping and number formatting are those of the serializer, with the settings of ctx.
+   Calls that would not make valid JSON (a value without a key in an object, end_array closing an
+   object, a second top level value...) fail and write nothing. A failing sink is final: the
+   following calls and json_writer_finish fail. json_writer_value writes a JSON_Value as a member,
+   those serializing to more than 4 KB go through a temporary string.
+   json_writer_finish flushes the buffer and fails unless one complete document was written,
+   json_writer_free does not flush and closes the file of json_writer_new_file. */
+JSON_Writer * json_writer_new(JSON_Context *ctx, JSON_Writer_Function write_fun, void *sink_data, int is_pretty);
+JSON_Writer * json_writer_new_file(JSON_Context *ctx, const char *filename, int is_pretty);
+JSON_Status   json_writer_begin_object(JSON_Writer *writer);
+JSON_Status   json_writer_end_object(JSON_Writer *writer);
+JSON_Status   json_writer_begin_array(JSON_Writer *writer);
+JSON_Status   json_writer_end_array(JSON_Writer *writer);
+JSON_Status   json_writer_key(JSON_Writer *writer, const char *name);
+JSON_Status   json_writer_string(JSON_Writer *writer, const char *string);
+JSON_Status   json_writer_string_with_len(JSON_Writer *writer, const char *string, size_t len);
+JSON_Status   json_writer_number(JSON_Writer *writer, double number);
+JSON_Status   json_writer_number_text(JSON_Writer *writer, const char *text, size_t len); /* as written, e.g. a lexeme */
+JSON_Status   json_writer_boolean(JSON_Writer *writer, int boolean);
+JSON_Status   json_writer_null(JSON_Writer *writer);
+JSON_Status   json_writer_value(JSON_Writer *writer, const JSON_Value *value);
+JSON_Status   json_writer_flush(JSON_Writer *writer);
+JSON_Status   json_writer_finish(JSON_Writer *writer);
+void          json_writer_free(JSON_Writer *writer);
+
+/* Streaming reader, the other way round: returns the tokens of a document one at a time without
+   building it as JSON_Values, reading its source 4 KB at a time, so that its memory does not grow
+   with the input (the buffer, one byte per open container, the longest string).
+   json_reader_next returns JSONTokenEnd once the top level value is complete and followed by white
+   space only, and JSONTokenError on invalid input or when the source or an allocation fails, which
+   is final. The input accepted is the parser's, without comments nor anything after the value. A
+   UTF-8 BOM is skipped, the offsets counting it. After a key, a string or a
+   number, json_reader_string gives its decoded text, numbers as written, valid until the next
+   call. json_reader_skip reads up to the end of the innermost open container and returns the
+   token that closes it, e.g. to drop a value right after its JSONTokenBeginObject.
+   json_reader_token_offset gives where the last token starts in the input and json_reader_offset
+   where it ends, the end of the whole container after json_reader_skip. */
+JSON_Reader * json_reader_new(JSON_Context *ctx, JSON_Reader_Function read_fun, void *source_data);
+JSON_Reader * json_reader_new_file(JSON_Context *ctx, const char *filename);
+JSON_Token    json_reader_next(JSON_Reader *reader);
+JSON_Token    json_reader_skip(JSON_Reader *reader);
+const char *  json_reader_string(const JSON_Reader *reader);
+size_t        json_reader_string_len(const JSON_Reader *reader);
+double        json_reader_number(const JSON_Reader *reader);
+int           json_reader_boolean(const JSON_Reader *reader);
+size_t        json_reader_depth(const JSON_Reader *reader); /* open containers */
+size_t        json_reader_offset(const JSON_Reader *reader); /* of the next byte to read */
+size_t        json_reader_token_offset(const JSON_Reader *reader); /* where the last token starts */
+void          json_reader_free(JSON_Reader *reader);
+
 /* Comparing */
 int  json_value_equals(const JSON_Value *a, const JSON_Value *b);
 
@@ -188,6 +392,15 @@ int           json_array_get_boolean(const JSON_Array *array, size_t index); /*
 size_t        json_array_get_count  (const JSON_Array *array);
 JSON_Value  * json_array_get_wrapping_value(const JSON_Array *array);
 
+/* Arrays holding only numbers, parsed or built with the append functions, store them as an array
+   of doubles rather than one JSON_Value each (unless disabled with json_context_set_number_arrays,
+   or when number lexemes are kept). json_array_get_value creates the value of a member when first
+   asked for it; anything else than a number added to the array converts it back.
+   json_array_get_numbers copies count numbers starting at index into numbers, and fails if they
+   are not all numbers. json_array_append_numbers appends count numbers, all of them or none. */
+JSON_Status   json_array_get_numbers(const JSON_Array *array, size_t index, double *numbers, size_t count);
+JSON_Status   json_array_append_numbers(JSON_Array *array, const double *numbers, size_t count);
+
 /* Frees and removes value at given index, does nothing and returns JSONFailure if index doesn't exist.
  * Order of values in array may change during execution.  */
 JSON_Status json_array_remove(JSON_Array *array, size_t i);
@@ -214,6 +427,20 @@ JSON_Status json_array_append_number(JSON_Array *array, double number);
 JSON_Status json_array_append_boolean(JSON_Array *array, int boolean);
 JSON_Status json_array_append_null(JSON_Array *array);
 
+/* Building large documents. json_object_reserve and json_array_reserve make room for capacity
+ * members in total, so that appending them does not grow the tables again.
+ * json_object_append_value adds a member without looking for one with the same name first: the
+ * caller guarantees names are unique, a duplicate makes an invalid document.
+ * json_alloc_string_ex returns a buffer for a string of length chars plus the null character. Once
+ * filled it is given to json_value_init_string_no_copy_ex with the same context, which takes it
+ * over as it is, without copying or validating it: it must hold valid UTF-8. On failure the buffer
+ * still belongs to the caller, it is freed with json_free_serialized_string_ex. */
+JSON_Status  json_object_reserve(JSON_Object *object, size_t capacity);
+JSON_Status  json_array_reserve(JSON_Array *array, size_t capacity);
+JSON_Status  json_object_append_value(JSON_Object *object, const char *name, JSON_Value *value);
+char       * json_alloc_string_ex(JSON_Context *ctx, size_t length);
+JSON_Value * json_value_init_string_no_copy_ex(JSON_Context *ctx, char *string, size_t length);
+
 /*
  *JSON Value
  */
@@ -227,12 +454,31 @@ JSON_Value * json_value_init_null   (void);
 JSON_Value * json_value_deep_copy   (const JSON_Value *value);
 void         json_value_free        (JSON_Value *value);
 
+/* Deep copies are copy-on-write: the object or array of the copy reads the members of the
+   original in place, reading never allocates on either side. Changing it, by name, index or
+   dotted path, gives the copy its own members one level at a time. A container is changed for
+   the value it belongs to: those read through the copy below its top level are the original's,
+   and changing one changes the original, the copy keeping what it had. Modifying the original
+   first gives the copies still sharing the modified container, or one above it, theirs. Copies
+   made with a different context than the original are full copies. */
+
+/* Same as above, allocating from ctx */
+JSON_Value * json_value_init_object_ex (JSON_Context *ctx);
+JSON_Value * json_value_init_array_ex  (JSON_Context *ctx);
+JSON_Value * json_value_init_string_ex (JSON_Context *ctx, const char *string);
+JSON_Value * json_value_init_string_with_len_ex(JSON_Context *ctx, const char *string, size_t length);
+JSON_Value * json_value_init_number_ex (JSON_Context *ctx, double number);
+JSON_Value * json_value_init_boolean_ex(JSON_Context *ctx, int boolean);
+JSON_Value * json_value_init_null_ex   (JSON_Context *ctx);
+JSON_Value * json_value_deep_copy_ex   (JSON_Context *ctx, const JSON_Value *value);
+
 JSON_Value_Type json_value_get_type   (const JSON_Value *value);
 JSON_Object *   json_value_get_object (const JSON_Value *value);
 JSON_Array  *   json_value_get_array  (const JSON_Value *value);
 const char  *   json_value_get_string (const JSON_Value *value);
 size_t          json_value_get_string_len(const JSON_Value *value); /* doesn't account for last null character */
 double          json_value_get_number (const JSON_Value *value);
+const char  *   json_value_get_number_lexeme(const JSON_Value *value); /* source text, NULL unless parsed with number lexemes and written as RFC 8259 has it, "1." is not */
 int             json_value_get_boolean(const JSON_Value *value);
 JSON_Value  *   json_value_get_parent (const JSON_Value *value);
 